@@ -4,7 +4,8 @@
 #pragma once
 
 /// Create the API functions that are substituted for memory loads from within a
-/// transaction
+/// transaction.  The _DESC versions are for clones, which have the descriptor
+/// at hand, and thus can skip get_self()
 #define API_TM_LOADFUNCS                                                       \
   extern "C" {                                                                 \
   uint8_t TM_LOAD_U1(uint8_t *ptr) { return get_self()->read<>(ptr); }         \
@@ -15,10 +16,35 @@
   double TM_LOAD_D(double *ptr) { return get_self()->read<>(ptr); }            \
   long double TM_LOAD_LD(long double *ptr) { return get_self()->read<>(ptr); } \
   void *TM_LOAD_P(void **ptr) { return get_self()->read<>(ptr); }              \
+  uint8_t TM_LOAD_U1_DESC(TM_OPAQUE *desc, uint8_t *ptr) {                     \
+    return ((TxThread *)desc)->read<>(ptr);                                    \
+  }                                                                            \
+  uint16_t TM_LOAD_U2_DESC(TM_OPAQUE *desc, uint16_t *ptr) {                   \
+    return ((TxThread *)desc)->read<>(ptr);                                    \
+  }                                                                            \
+  uint32_t TM_LOAD_U4_DESC(TM_OPAQUE *desc, uint32_t *ptr) {                   \
+    return ((TxThread *)desc)->read<>(ptr);                                    \
+  }                                                                            \
+  uint64_t TM_LOAD_U8_DESC(TM_OPAQUE *desc, uint64_t *ptr) {                   \
+    return ((TxThread *)desc)->read<>(ptr);                                    \
+  }                                                                            \
+  float TM_LOAD_F_DESC(TM_OPAQUE *desc, float *ptr) {                          \
+    return ((TxThread *)desc)->read<>(ptr);                                    \
+  }                                                                            \
+  double TM_LOAD_D_DESC(TM_OPAQUE *desc, double *ptr) {                        \
+    return ((TxThread *)desc)->read<>(ptr);                                    \
+  }                                                                            \
+  long double TM_LOAD_LD_DESC(TM_OPAQUE *desc, long double *ptr) {             \
+    return ((TxThread *)desc)->read<>(ptr);                                    \
+  }                                                                            \
+  void *TM_LOAD_P_DESC(TM_OPAQUE *desc, void **ptr) {                          \
+    return ((TxThread *)desc)->read<>(ptr);                                    \
+  }                                                                            \
   }
 
 /// Create the API functions that are substituted for memory stores  from within
-/// a transaction
+/// a transaction.  The _DESC versions are for clones, which have the descriptor
+/// at hand, and thus can skip get_self()
 #define API_TM_STOREFUNCS                                                      \
   extern "C" {                                                                 \
   void TM_STORE_U1(uint8_t val, uint8_t *ptr) { get_self()->write(ptr, val); } \
@@ -37,4 +63,28 @@
     get_self()->write(ptr, val);                                               \
   }                                                                            \
   void TM_STORE_P(void *val, void **ptr) { get_self()->write(ptr, val); }      \
+  void TM_STORE_U1_DESC(TM_OPAQUE *desc, uint8_t val, uint8_t *ptr) {          \
+    ((TxThread *)desc)->write(ptr, val);                                       \
+  }                                                                            \
+  void TM_STORE_U2_DESC(TM_OPAQUE *desc, uint16_t val, uint16_t *ptr) {        \
+    ((TxThread *)desc)->write(ptr, val);                                       \
+  }                                                                            \
+  void TM_STORE_U4_DESC(TM_OPAQUE *desc, uint32_t val, uint32_t *ptr) {        \
+    ((TxThread *)desc)->write(ptr, val);                                       \
+  }                                                                            \
+  void TM_STORE_U8_DESC(TM_OPAQUE *desc, uint64_t val, uint64_t *ptr) {        \
+    ((TxThread *)desc)->write(ptr, val);                                       \
+  }                                                                            \
+  void TM_STORE_F_DESC(TM_OPAQUE *desc, float val, float *ptr) {               \
+    ((TxThread *)desc)->write(ptr, val);                                       \
+  }                                                                            \
+  void TM_STORE_D_DESC(TM_OPAQUE *desc, double val, double *ptr) {             \
+    ((TxThread *)desc)->write(ptr, val);                                       \
+  }                                                                            \
+  void TM_STORE_LD_DESC(TM_OPAQUE *desc, long double val, long double *ptr) {  \
+    ((TxThread *)desc)->write(ptr, val);                                       \
+  }                                                                            \
+  void TM_STORE_P_DESC(TM_OPAQUE *desc, void *val, void **ptr) {               \
+    ((TxThread *)desc)->write(ptr, val);                                       \
+  }                                                                            \
   }
\ No newline at end of file
@@ -34,4 +34,20 @@
   void *TM_MEMMOVE(void *dest, const void *src, size_t count) {                \
     return tx_basic_memmove(dest, src, count, *get_self());                    \
   }                                                                            \
-  }
\ No newline at end of file
+  }
+
+/// Create the API functions that are substituted for transactional calls to
+/// memcpy, memset, and memmove.  These are the bulk versions, which require the
+/// TM algorithm to provide readRange and writeRange.
+#define API_TM_MEMFUNCS_BULK                                                   \
+  extern "C" {                                                                 \
+  void *TM_MEMCPY(void *dest, const void *src, size_t count, size_t align) {   \
+    return tx_bulk_memcpy(dest, src, count, align, *get_self());               \
+  }                                                                            \
+  void *TM_MEMSET(void *dest, int ch, size_t count) {                          \
+    return tx_bulk_memset(dest, ch, count, *get_self());                       \
+  }                                                                            \
+  void *TM_MEMMOVE(void *dest, const void *src, size_t count) {                \
+    return tx_bulk_memmove(dest, src, count, *get_self());                     \
+  }                                                                            \
+  }
@@ -9,4 +9,14 @@
 #define API_TM_STATS_NOP                                                       \
   extern "C" {                                                                 \
   void TM_REPORT_ALL_STATS() {}                                                \
-  }
\ No newline at end of file
+  }
+
+/// Create the API functions that can be explicitly called from a program in
+/// order to report stats.  This version is for TM implementations that keep
+/// per-thread counters via a StatsManager, and expose them through a static
+/// TxThread::reportStats() method.  When the StatsManager is NoopStats, the
+/// report is empty.
+#define API_TM_STATS_REPORT                                                    \
+  extern "C" {                                                                 \
+  void TM_REPORT_ALL_STATS() { TxThread::reportStats(); }                      \
+  }
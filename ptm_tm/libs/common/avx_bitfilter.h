@@ -0,0 +1,228 @@
+#pragma once
+
+#include <immintrin.h>
+#include <stdint.h>
+
+#include "sse_bitfilter.h"
+
+/// AVX2BitFilter and AVX512BitFilter are versions of BitFilter that process
+/// 256 and 512 bits per instruction in unionwith, clear, fastcopy, and
+/// intersect.  See bitfilter.h for additional details.
+///
+/// RingSTM intersects its read filter with every ring entry that is newer than
+/// its start time, so the cost of intersect grows with the size of the filter.
+/// Wider vectors let a ring use bigger filters, which have fewer false
+/// conflicts, for about the intersection cost of a smaller SSE filter (e.g., a
+/// 4096-bit AVX-512 filter takes as many instructions as a 1024-bit SSE one).
+///
+/// Each class is only available when the compiler targets the corresponding
+/// instruction set (e.g., via -march=native).  WideBitFilter names the widest
+/// one that is available, and falls back to SSEBitFilter.
+
+#ifdef __AVX2__
+/// AVX2BitFilter is an AVX2-accelerated version of BitFilter
+template <uint32_t BITS, int GRAIN> class AVX2BitFilter {
+  /// The number of bits in an AVX2 register
+  static const uint32_t VEC_SIZE = 8 * sizeof(__m256i);
+
+  /// The number of AVX2 registers needed to get the desired number of bits
+  static const uint32_t VEC_BLOCKS = BITS / VEC_SIZE;
+
+  /// The number of bits in a word
+  static const uint32_t WORD_SIZE = 8 * sizeof(uintptr_t);
+
+  /// The number of words needed to get the desired number of bits
+  static const uint32_t WORD_BLOCKS = BITS / WORD_SIZE;
+
+  static_assert(BITS % VEC_SIZE == 0, "BITS must be a multiple of 256");
+
+  /// The contiguous region of bits that represents the set
+  union {
+    mutable __m256i vec_filter[VEC_BLOCKS];
+    uintptr_t word_filter[WORD_BLOCKS];
+  } __attribute__((aligned(32)));
+
+  /// Given a pointer, compute the corresponding bit position in word_filter
+  static uint32_t hash(const void *const key) {
+    return (((uintptr_t)key) >> GRAIN) % BITS;
+  }
+
+public:
+  /// Allocate a filter that is aligned properly for use with AVX2
+  static void *filter_alloc(size_t s) { return _mm_malloc(s, 32); }
+
+  /// Construct an AVX2BitFilter by ensuring that it is clear
+  AVX2BitFilter() { clear(); }
+
+  /// Set a bit in the filter, based on a provided pointer
+  void add(const void *const val) volatile {
+    const uint32_t index = hash(val);
+    const uint32_t block = index / WORD_SIZE;
+    const uint32_t offset = index % WORD_SIZE;
+    word_filter[block] |= ((uintptr_t)1 << offset);
+  }
+
+  /// Set a bit in the filter, based on a provided pointer, but do so with
+  /// strong memory ordering.
+  void atomic_add(const void *const val) volatile {
+    const uint32_t index = hash(val);
+    const uint32_t block = index / WORD_SIZE;
+    const uint32_t offset = index % WORD_SIZE;
+    __atomic_fetch_or(&word_filter[block], (uintptr_t)1 << offset,
+                      __ATOMIC_SEQ_CST);
+  }
+
+  /// Test if the bit corresponding to a pointer is set
+  bool lookup(const void *const val) const volatile {
+    const uint32_t index = hash(val);
+    const uint32_t block = index / WORD_SIZE;
+    const uint32_t offset = index % WORD_SIZE;
+    return word_filter[block] & ((uintptr_t)1 << offset);
+  }
+
+  /// Modify the AVX2BitFilter by unioning it with the provided AVX2BitFilter
+  void unionwith(const AVX2BitFilter<BITS, GRAIN> &rhs) {
+    for (uint32_t i = 0; i < VEC_BLOCKS; ++i) {
+      vec_filter[i] = _mm256_or_si256(vec_filter[i], rhs.vec_filter[i]);
+    }
+  }
+
+  /// Clear an AVX2BitFilter
+  void clear() volatile {
+    const __m256i zero = _mm256_setzero_si256();
+    for (uint32_t i = 0; i < VEC_BLOCKS; ++i) {
+      vec_filter[i] = zero;
+    }
+  }
+
+  /// Set this AVX2BitFilter to have the same contents as the provided
+  /// AVX2BitFilter
+  void fastcopy(const AVX2BitFilter<BITS, GRAIN> *rhs) volatile {
+    for (uint32_t i = 0; i < VEC_BLOCKS; ++i) {
+      vec_filter[i] = rhs->vec_filter[i];
+    }
+  }
+
+  /// Intersect the current AVX2BitFilter with the provided AVX2BitFilter.
+  /// Return true if the result is nonzero.
+  bool intersect(const AVX2BitFilter<BITS, GRAIN> *rhs) const volatile {
+    __m256i acc = _mm256_setzero_si256();
+    for (uint32_t i = 0; i < VEC_BLOCKS; ++i) {
+      acc = _mm256_or_si256(
+          acc, _mm256_and_si256(vec_filter[i], rhs->vec_filter[i]));
+    }
+    return !_mm256_testz_si256(acc, acc);
+  }
+};
+#endif
+
+#ifdef __AVX512F__
+/// AVX512BitFilter is an AVX-512-accelerated version of BitFilter
+template <uint32_t BITS, int GRAIN> class AVX512BitFilter {
+  /// The number of bits in an AVX-512 register
+  static const uint32_t VEC_SIZE = 8 * sizeof(__m512i);
+
+  /// The number of AVX-512 registers needed to get the desired number of bits
+  static const uint32_t VEC_BLOCKS = BITS / VEC_SIZE;
+
+  /// The number of bits in a word
+  static const uint32_t WORD_SIZE = 8 * sizeof(uintptr_t);
+
+  /// The number of words needed to get the desired number of bits
+  static const uint32_t WORD_BLOCKS = BITS / WORD_SIZE;
+
+  static_assert(BITS % VEC_SIZE == 0, "BITS must be a multiple of 512");
+
+  /// The contiguous region of bits that represents the set.  Each vector is a
+  /// whole cache line.
+  union {
+    mutable __m512i vec_filter[VEC_BLOCKS];
+    uintptr_t word_filter[WORD_BLOCKS];
+  } __attribute__((aligned(64)));
+
+  /// Given a pointer, compute the corresponding bit position in word_filter
+  static uint32_t hash(const void *const key) {
+    return (((uintptr_t)key) >> GRAIN) % BITS;
+  }
+
+public:
+  /// Allocate a filter that is aligned properly for use with AVX-512
+  static void *filter_alloc(size_t s) { return _mm_malloc(s, 64); }
+
+  /// Construct an AVX512BitFilter by ensuring that it is clear
+  AVX512BitFilter() { clear(); }
+
+  /// Set a bit in the filter, based on a provided pointer
+  void add(const void *const val) volatile {
+    const uint32_t index = hash(val);
+    const uint32_t block = index / WORD_SIZE;
+    const uint32_t offset = index % WORD_SIZE;
+    word_filter[block] |= ((uintptr_t)1 << offset);
+  }
+
+  /// Set a bit in the filter, based on a provided pointer, but do so with
+  /// strong memory ordering.
+  void atomic_add(const void *const val) volatile {
+    const uint32_t index = hash(val);
+    const uint32_t block = index / WORD_SIZE;
+    const uint32_t offset = index % WORD_SIZE;
+    __atomic_fetch_or(&word_filter[block], (uintptr_t)1 << offset,
+                      __ATOMIC_SEQ_CST);
+  }
+
+  /// Test if the bit corresponding to a pointer is set
+  bool lookup(const void *const val) const volatile {
+    const uint32_t index = hash(val);
+    const uint32_t block = index / WORD_SIZE;
+    const uint32_t offset = index % WORD_SIZE;
+    return word_filter[block] & ((uintptr_t)1 << offset);
+  }
+
+  /// Modify the AVX512BitFilter by unioning it with the provided
+  /// AVX512BitFilter
+  void unionwith(const AVX512BitFilter<BITS, GRAIN> &rhs) {
+    for (uint32_t i = 0; i < VEC_BLOCKS; ++i) {
+      vec_filter[i] = _mm512_or_si512(vec_filter[i], rhs.vec_filter[i]);
+    }
+  }
+
+  /// Clear an AVX512BitFilter
+  void clear() volatile {
+    const __m512i zero = _mm512_setzero_si512();
+    for (uint32_t i = 0; i < VEC_BLOCKS; ++i) {
+      vec_filter[i] = zero;
+    }
+  }
+
+  /// Set this AVX512BitFilter to have the same contents as the provided
+  /// AVX512BitFilter
+  void fastcopy(const AVX512BitFilter<BITS, GRAIN> *rhs) volatile {
+    for (uint32_t i = 0; i < VEC_BLOCKS; ++i) {
+      vec_filter[i] = rhs->vec_filter[i];
+    }
+  }
+
+  /// Intersect the current AVX512BitFilter with the provided AVX512BitFilter.
+  /// Return true if the result is nonzero.
+  bool intersect(const AVX512BitFilter<BITS, GRAIN> *rhs) const volatile {
+    __m512i acc = _mm512_setzero_si512();
+    for (uint32_t i = 0; i < VEC_BLOCKS; ++i) {
+      acc = _mm512_or_si512(
+          acc, _mm512_and_si512(vec_filter[i], rhs->vec_filter[i]));
+    }
+    return _mm512_test_epi64_mask(acc, acc) != 0;
+  }
+};
+#endif
+
+/// WideBitFilter is the widest bit filter that the target supports
+#if defined(__AVX512F__)
+template <uint32_t BITS, int GRAIN>
+using WideBitFilter = AVX512BitFilter<BITS, GRAIN>;
+#elif defined(__AVX2__)
+template <uint32_t BITS, int GRAIN>
+using WideBitFilter = AVX2BitFilter<BITS, GRAIN>;
+#else
+template <uint32_t BITS, int GRAIN>
+using WideBitFilter = SSEBitFilter<BITS, GRAIN>;
+#endif
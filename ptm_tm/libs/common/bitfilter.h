@@ -43,7 +43,7 @@ public:
     const uint32_t index = hash(val);
     const uint32_t block = index / WORD_SIZE;
     const uint32_t offset = index % WORD_SIZE;
-    word_filter[block] |= (1u << offset);
+    word_filter[block] |= ((uintptr_t)1 << offset);
   }
 
   /// Set a bit in the filter, based on a provided pointer, but do so with
@@ -52,7 +52,8 @@ public:
     const uint32_t index = hash(val);
     const uint32_t block = index / WORD_SIZE;
     const uint32_t offset = index % WORD_SIZE;
-    atomicswapptr(&word_filter[block], word_filter[block] | (1u << offset));
+    __atomic_fetch_or(&word_filter[block], (uintptr_t)1 << offset,
+                      __ATOMIC_SEQ_CST);
   }
 
   /// Test if the bit corresponding to a pointer is set
@@ -60,7 +61,7 @@ public:
     const uint32_t index = hash(val);
     const uint32_t block = index / WORD_SIZE;
     const uint32_t offset = index % WORD_SIZE;
-    return word_filter[block] & (1u << offset);
+    return word_filter[block] & ((uintptr_t)1 << offset);
   }
 
   /// Modify the BitFilter by unioning it with the provided BitFilter
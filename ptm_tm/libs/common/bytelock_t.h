@@ -1,14 +1,22 @@
 #pragma once
 
 #include <atomic>
+#include <cstdint>
+#include <exception>
+
+#include "platform.h"
 
 /// BytelockTable is a table of bytelocks, for TLRW-style algorithms.  Unlike
 /// the published TLRW, our BytelockTable does not allow an unlimited number of
 /// threads (albeit via two classes of readers), but instead enforces a fixed
 /// maximum number of threads, based on the number of dedicated slots in each
-/// bytelock.
+/// bytelock.  See OverflowBytelockTable for a table that supports any number of
+/// threads.
 template <int NUM_BYTELOCKS, int COVERAGE, int THREADS> class BytelockTable {
 public:
+  /// The type of the owner field of a bytelock
+  typedef uintptr_t owner_t;
+
   /// bytelock_t is a simplified version of the TLRW bytelock.  It consists of a
   /// word for storing the ID of the writer (if any) and a byte per visible
   /// reader, which stores a 1 or 0 depending on whether the corresponding
@@ -19,8 +27,9 @@ public:
   /// implementation, every reader is slotted, and a template instantiation
   /// decides on the maximum number of readers.
   ///
-  /// Note that we leave low-level use of the bytelock up to the TM algorithm.
-  /// There is no "acquire_for_read" or "release" function in this file.
+  /// Note that we leave most low-level use of the bytelock up to the TM
+  /// algorithm.  The table only provides functions for managing readers, so
+  /// that algorithms can be written against either kind of bytelock table.
   struct bytelock_t {
     /// The thread who owns the bytelock
     std::atomic<uintptr_t> owner;
@@ -46,4 +55,113 @@ public:
     if (id >= THREADS)
       std::terminate();
   }
-};
\ No newline at end of file
+
+  /// Return true if thread `id` has a read lock on the bytelock
+  static bool isReader(bytelock_t *bl, uintptr_t id) {
+    return bl->readers[id] != 0;
+  }
+
+  /// Announce thread `id` as a reader of the bytelock.  This involves a fence,
+  /// so that a subsequent read of the owner is ordered after it.
+  static void addReader(bytelock_t *bl, uintptr_t id) { bl->readers[id] = 1; }
+
+  /// Remove thread `id` as a reader of the bytelock
+  static void removeReader(bytelock_t *bl, uintptr_t id) {
+    bl->readers[id].store(0, std::memory_order_relaxed);
+  }
+
+  /// Return true if the bytelock has any readers among the first `threads`
+  /// threads.  Readers that aren't slotted cannot be told apart, so the caller
+  /// says how many of them are its own (here, there are none).
+  static bool hasReaders(bytelock_t *bl, uintptr_t threads, uintptr_t) {
+    unsigned char conflicts = 0;
+    for (uintptr_t i = 0; i < threads; ++i) {
+      conflicts |= bl->readers[i];
+    }
+    return conflicts;
+  }
+};
+
+/// OverflowBytelockTable is a table of bytelocks in the style of the published
+/// TLRW.  Threads whose IDs are less than SLOTS are "slotted" readers, and each
+/// has a byte in every bytelock.  All other threads are "unslotted" readers,
+/// which share a counter in each bytelock.  This supports any number of
+/// threads, but unslotted readers are more expensive: they contend on the
+/// counter, and since they cannot tell whether they already hold a read lock,
+/// they re-acquire (and log) it on every read.
+///
+/// Note that the owner and counter are 32 bits, so that with SLOTS == 56, a
+/// bytelock fits in a single cache line.
+template <int NUM_BYTELOCKS, int COVERAGE, int SLOTS>
+class OverflowBytelockTable {
+public:
+  /// The type of the owner field of a bytelock
+  typedef uint32_t owner_t;
+
+  /// bytelock_t is the TLRW bytelock.  It consists of a word for storing the
+  /// ID of the writer (if any), a count of unslotted readers, and a byte per
+  /// slotted reader.
+  struct alignas(CACHELINE_BYTES) bytelock_t {
+    /// The thread who owns the bytelock
+    std::atomic<owner_t> owner;
+
+    /// The number of unslotted readers
+    std::atomic<uint32_t> overflow;
+
+    /// The slots for readers
+    std::atomic<char> readers[SLOTS];
+  };
+
+private:
+  /// The bytelock table
+  bytelock_t bytelocks[NUM_BYTELOCKS];
+
+public:
+  /// Given an address, return a pointer to the corresponding bytelock table
+  /// entry
+  bytelock_t *get(void *addr) {
+    return &bytelocks[(reinterpret_cast<uintptr_t>(addr) >> COVERAGE) %
+                      NUM_BYTELOCKS];
+  }
+
+  /// Every thread ID is valid: threads beyond the slots use the counter
+  void validate_id(int) {}
+
+  /// Return true if thread `id` has a read lock on the bytelock.  This is
+  /// always false for unslotted threads.
+  static bool isReader(bytelock_t *bl, uintptr_t id) {
+    return id < SLOTS && bl->readers[id] != 0;
+  }
+
+  /// Announce thread `id` as a reader of the bytelock.  This involves a fence,
+  /// so that a subsequent read of the owner is ordered after it.
+  static void addReader(bytelock_t *bl, uintptr_t id) {
+    if (id < SLOTS) {
+      bl->readers[id] = 1;
+    } else {
+      bl->overflow++;
+    }
+  }
+
+  /// Remove thread `id` as a reader of the bytelock
+  static void removeReader(bytelock_t *bl, uintptr_t id) {
+    if (id < SLOTS) {
+      bl->readers[id].store(0, std::memory_order_relaxed);
+    } else {
+      bl->overflow--;
+    }
+  }
+
+  /// Return true if the bytelock has any readers among the first `threads`
+  /// threads, other than the `mine` unslotted read locks held by the caller
+  static bool hasReaders(bytelock_t *bl, uintptr_t threads, uintptr_t mine) {
+    if (bl->overflow != mine) {
+      return true;
+    }
+    unsigned char conflicts = 0;
+    for (uintptr_t i = 0; i < threads && i < SLOTS; ++i) {
+      conflicts |= bl->readers[i];
+    }
+    return conflicts;
+  }
+};
@@ -0,0 +1,76 @@
+/// captured.h provides a set of address ranges that a transaction allocated,
+/// so that allocation managers can tell the TM not to instrument accesses to
+/// them.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/// CapturedRanges remembers the ranges returned by the N most recent
+/// allocations of a transaction.  Tracking more than the last allocation lets
+/// a transaction that allocates an object and then its buffers (e.g., a node
+/// and its key) initialize all of them without instrumentation.
+///
+/// contains() is on the path of every accessDirectly() check, so it first
+/// rejects addresses outside of the smallest interval that covers every range,
+/// which is the common case for accesses to shared memory.  Only then does it
+/// scan the ranges, newest first.  When more than N ranges are added, the
+/// oldest are forgotten.  That is safe: accesses to them are simply
+/// instrumented.  The covering interval is not shrunk when a range is
+/// forgotten, so it is conservative.
+template <int N> class CapturedRanges {
+  /// The start of each range
+  uintptr_t starts[N];
+
+  /// The size of each range
+  uintptr_t sizes[N];
+
+  /// The number of valid ranges
+  int count = 0;
+
+  /// The slot that the next range will occupy
+  int next = 0;
+
+  /// The lowest address in any range
+  uintptr_t lo = UINTPTR_MAX;
+
+  /// One past the highest address in any range
+  uintptr_t hi = 0;
+
+public:
+  /// Forget all ranges
+  void clear() {
+    count = 0;
+    next = 0;
+    lo = UINTPTR_MAX;
+    hi = 0;
+  }
+
+  /// Remember a range, possibly forgetting the oldest one
+  void add(void *addr, size_t size) {
+    uintptr_t s = (uintptr_t)addr;
+    starts[next] = s;
+    sizes[next] = size;
+    next = (next + 1) % N;
+    count = count < N ? count + 1 : N;
+    lo = s < lo ? s : lo;
+    hi = s + size > hi ? s + size : hi;
+  }
+
+  /// Return true if the address is within one of the ranges
+  bool contains(void *addr) {
+    uintptr_t a = (uintptr_t)addr;
+    if (a < lo || a >= hi) {
+      return false;
+    }
+    for (int i = 0, j = next; i < count; ++i) {
+      j = (j == 0 ? N : j) - 1;
+      // unsigned arithmetic makes this a test of starts[j] <= a < end
+      if (a - starts[j] < sizes[j]) {
+        return true;
+      }
+    }
+    return false;
+  }
+};
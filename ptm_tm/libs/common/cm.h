@@ -246,4 +246,130 @@ public:
       g.owner.val = -1;
     }
   }
-};
\ No newline at end of file
+};
+
+/// TwoPhaseCM is the two-phase contention manager of SwissTM.  A transaction
+/// starts out "timid": on a write/write conflict, it aborts itself.  Once it
+/// has performed WRITES writes, it takes a timestamp from a global counter, and
+/// becomes "greedy": on a conflict with a younger (or timid) transaction, it
+/// asks that transaction to abort and waits for it, and on a conflict with an
+/// older transaction, it aborts itself.  Short transactions thus stay cheap,
+/// while long transactions, which have the most work to lose, are guaranteed to
+/// make progress.  A transaction keeps its timestamp when it aborts, so that it
+/// gets older until it commits.  Aborts are followed by randomized exponential
+/// backoff, tuned via MIN and MAX as in ExpBackoffCM.
+///
+/// Unlike the other contention managers, TwoPhaseCM must be told about writes
+/// (onWrite) and conflicts (resolve), and the TM must poll abortRequested().
+/// THREADS is the maximum number of threads.
+///
+/// NB: A request can reach a transaction after it committed, in which case the
+///     thread's next transaction aborts spuriously.  This is rare and harmless.
+template <int THREADS, int WRITES, int MIN, int MAX> class TwoPhaseCM {
+  /// The value of a timid transaction's timestamp, which loses to everyone
+  static const uint64_t TIMID = UINT64_MAX;
+
+  /// The contention management state of one thread, padded to a cache line
+  struct alignas(CACHELINE_BYTES) slot_t {
+    /// The thread's greedy timestamp, or TIMID
+    std::atomic<uint64_t> ts;
+
+    /// Set by another thread to ask this thread to abort
+    std::atomic<bool> abort_req;
+
+    /// Construct a slot for a timid thread with no pending abort request
+    slot_t() : ts(TIMID), abort_req(false) {}
+  };
+
+public:
+  /// TwoPhaseCM::Globals holds the counter for greedy timestamps, and the
+  /// state of every thread
+  class Globals {
+  public:
+    /// The source of greedy timestamps
+    pad_dword_t counter;
+
+    /// Each thread's timestamp and abort request flag
+    slot_t slots[THREADS];
+  };
+
+private:
+  /// The number of writes by the current transaction
+  int writes;
+
+  /// The number of consecutive aborts by the current thread
+  int consecAborts;
+
+  /// A seed to use for random number generation
+  unsigned seed;
+
+  /// This thread's slot, while the current transaction is greedy
+  slot_t *mine;
+
+  /// This thread's slot, once the thread has written.  Only threads that have
+  /// written can own locations, and thus be asked to abort.
+  slot_t *me;
+
+public:
+  /// Construct a two-phase contention manager
+  TwoPhaseCM()
+      : writes(0), consecAborts(0), seed((uintptr_t)(&consecAborts)),
+        mine(nullptr), me(nullptr) {}
+
+  /// CM code to run before beginning a transaction
+  /// @returns true if the transaction should become irrevocable
+  bool beforeBegin(Globals &) { return false; }
+
+  /// CM code to run when a transaction acquires a location for writing.  After
+  /// WRITES writes, the transaction becomes greedy.
+  void onWrite(Globals &g, uint64_t id) {
+    me = &g.slots[id];
+    if (++writes == WRITES) {
+      mine = me;
+      if (mine->ts == TIMID) {
+        mine->ts = ++g.counter.val;
+      }
+    }
+  }
+
+  /// Decide the outcome of a write/write conflict between thread `id` and the
+  /// owner of a location.
+  /// @returns true if the caller should wait for the owner to release the
+  ///          location (the owner has been asked to abort), false if the caller
+  ///          should abort itself.
+  bool resolve(Globals &g, uint64_t id, uint64_t owner) {
+    uint64_t my_ts = g.slots[id].ts;
+    if (my_ts == TIMID || g.slots[owner].ts < my_ts) {
+      return false;
+    }
+    g.slots[owner].abort_req = true;
+    return true;
+  }
+
+  /// Return true if another thread has asked thread `id` to abort
+  bool abortRequested(Globals &g, uint64_t id) {
+    return g.slots[id].abort_req.load(std::memory_order_relaxed);
+  }
+
+  /// CM code to run after a transaction finishes cleaning up from an abort
+  void afterAbort(Globals &g, uint64_t id) {
+    writes = 0;
+    g.slots[id].abort_req = false;
+    exp_backoff(++consecAborts, seed, MIN, MAX);
+  }
+
+  /// CM code to run after a transaction finishes cleaning up from a commit.  A
+  /// request to abort may have arrived too late to matter, or while the
+  /// transaction was still timid, so it is cleared either way.
+  void afterCommit(Globals &) {
+    writes = 0;
+    consecAborts = 0;
+    if (mine) {
+      mine->ts = TIMID;
+      mine = nullptr;
+    }
+    if (me) {
+      me->abort_req = false;
+    }
+  }
+};
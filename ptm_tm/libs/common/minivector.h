@@ -54,6 +54,9 @@ public:
       expand();
   }
 
+  /// Remove and return the last item.  The MiniVector must not be empty.
+  T pop_back() { return items[--count]; }
+
   /// Getter to report the array size (to test for empty)
   unsigned long size() const { return count; }
 
@@ -1,8 +1,15 @@
 #pragma once
 
 #include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
 
 #include "pad_word.h"
+#include "platform.h"
 #include "timesource.h"
 
 /// local_orec_t is a way of looking at a 64-bit int and telling if it indicates
@@ -38,6 +45,9 @@ template <int NUM_ORECS, int COVERAGE, class TIMESOURCE> class OrecTable {
 public:
   typedef typename TIMESOURCE::time_snapshot_t time_snapshot_t;
 
+  /// The number of bytes (aligned) that map to the same orec
+  static const uintptr_t GRANULE = (uintptr_t)1 << COVERAGE;
+
   /// The global timestamp, for assigning commit orders and reducing
   /// validation
   TIMESOURCE timestamp;
@@ -47,6 +57,12 @@ public:
     return &orecs[(reinterpret_cast<uintptr_t>(addr) >> COVERAGE) % NUM_ORECS];
   }
 
+  /// Map an orec back to its position in the table (e.g., for statistics)
+  size_t index_of(orec_t *o) { return o - orecs; }
+
+  /// Return the number of orecs in the table
+  size_t size() { return NUM_ORECS; }
+
   /// Get the current value of the clock
   uintptr_t get_time() { return timestamp.get_time(); }
 
@@ -71,4 +87,151 @@ public:
     tmp.fields.lock = 1;
     return tmp.all;
   }
-};
\ No newline at end of file
+};
+
+/// DynamicOrecTable is an OrecTable whose size and address hash are chosen when
+/// the program starts, rather than when the TM library is compiled, so that
+/// false conflicts can be tuned for a workload without rebuilding every
+/// instance.  The table is allocated on huge pages, since a table of 2^20 orecs
+/// spans 16MB, and would otherwise thrash the TLB.
+///
+/// Two environment variables configure the table:
+/// - TM_OREC_TABLE_SIZE: the number of orecs, from 1 to 2^31 (rounded up to a
+///   power of 2, and to at least 2).  The default is DEFAULT_ORECS.  Other
+///   values are rejected with an error.
+/// - TM_OREC_HASH: how to map an address to an orec.  "mod" (the default)
+///   keeps the low bits of the address, like OrecTable.  "mult" uses Fibonacci
+///   (multiplicative) hashing, which scatters strided accesses across the
+///   table.  "xorfold" xors the high bits of the address into the low bits,
+///   which also breaks up strides, but keeps nearby addresses in nearby orecs.
+template <int DEFAULT_ORECS, int COVERAGE, class TIMESOURCE>
+class DynamicOrecTable {
+  static_assert((DEFAULT_ORECS & (DEFAULT_ORECS - 1)) == 0,
+                "DEFAULT_ORECS must be a power of 2");
+
+  /// The ways that an address can be mapped to an orec
+  enum hash_t { HASH_MOD, HASH_MULT, HASH_XORFOLD };
+
+  /// The orec table
+  orec_t *orecs;
+
+  /// log_2 of the number of orecs
+  int bits;
+
+  /// The number of orecs, minus one
+  uintptr_t mask;
+
+  /// log_2 of the largest table that TM_OREC_TABLE_SIZE may request.  The
+  /// second fold of HASH_XORFOLD shifts by 2 * bits, which must be less than
+  /// 64.
+  static const int MAX_BITS = 31;
+  static_assert(2 * MAX_BITS < 64, "a >> (2 * bits) must not overflow");
+
+  /// Parse the value of TM_OREC_TABLE_SIZE.  If it is not a number between 1
+  /// and 2^MAX_BITS, print an error and terminate, rather than silently running
+  /// with a table of some other size.
+  static uintptr_t parseSize(const char *str) {
+    const char *p = str;
+    while (isspace((unsigned char)*p)) {
+      ++p;
+    }
+    char *end = nullptr;
+    errno = 0;
+    unsigned long long num = strtoull(p, &end, 0);
+    if (*p == '-' || *p == '+' || end == p || *end != '\0' || errno == ERANGE ||
+        num == 0 || num > (1ull << MAX_BITS)) {
+      fprintf(stderr,
+              "TM_OREC_TABLE_SIZE must be a number between 1 and %llu, not "
+              "\"%s\"\n",
+              1ull << MAX_BITS, str);
+      std::terminate();
+    }
+    return num;
+  }
+
+  /// The hash function in use
+  hash_t hash;
+
+public:
+  typedef typename TIMESOURCE::time_snapshot_t time_snapshot_t;
+
+  /// The number of bytes (aligned) that map to the same orec
+  static const uintptr_t GRANULE = (uintptr_t)1 << COVERAGE;
+
+  /// The global timestamp, for assigning commit orders and reducing
+  /// validation
+  TIMESOURCE timestamp;
+
+  /// Size the table and pick its hash function according to the environment,
+  /// and then allocate it.  Note that we never free the table: the orec table
+  /// is part of a TM's globals, and threads may still be using it while static
+  /// objects are destructed.
+  DynamicOrecTable() {
+    uintptr_t num = DEFAULT_ORECS;
+    const char *size = getenv("TM_OREC_TABLE_SIZE");
+    if (size != nullptr) {
+      num = parseSize(size);
+    }
+    // Round up to a power of 2, but use at least 2 orecs, so that the shift in
+    // HASH_MULT is less than 64
+    bits = (num <= 2) ? 1 : 64 - __builtin_clzll(num - 1);
+    mask = (1ull << bits) - 1;
+
+    hash = HASH_MOD;
+    const char *name = getenv("TM_OREC_HASH");
+    if (name != nullptr && strcmp(name, "mult") == 0) {
+      hash = HASH_MULT;
+    } else if (name != nullptr && strcmp(name, "xorfold") == 0) {
+      hash = HASH_XORFOLD;
+    }
+
+    orecs = static_cast<orec_t *>(allocHugePages(sizeof(orec_t) << bits));
+    if (orecs == nullptr) {
+      fprintf(stderr, "Unable to allocate an orec table of %llu orecs\n",
+              1ull << bits);
+      std::terminate();
+    }
+  }
+
+  /// Map addresses to orec table entries.  The hash function does not change
+  /// after startup, so the branch is well predicted.
+  orec_t *get(void *addr) {
+    uintptr_t a = reinterpret_cast<uintptr_t>(addr) >> COVERAGE;
+    switch (hash) {
+    case HASH_MULT:
+      return &orecs[(a * 0x9E3779B97F4A7C15ULL) >> (64 - bits)];
+    case HASH_XORFOLD:
+      return &orecs[(a ^ (a >> bits) ^ (a >> (2 * bits))) & mask];
+    default:
+      return &orecs[a & mask];
+    }
+  }
+
+  /// Map an orec back to its position in the table (e.g., for statistics)
+  size_t index_of(orec_t *o) { return o - orecs; }
+
+  /// Return the number of orecs in the table
+  size_t size() { return mask + 1; }
+
+  /// Get the current value of the clock
+  uintptr_t get_time() { return timestamp.get_time(); }
+
+  /// Get the current value of the clock.  This version implies some stronger
+  /// fencing behavior than the regular get_time.
+  uintptr_t get_time_strong_ordering() {
+    return timestamp.get_time_strong_ordering();
+  }
+
+  /// Increment the clock, and return the value it was incremented *to*
+  uint64_t increment_get() { return timestamp.increment_get(); }
+
+  /// Increment the clock, and ignore the new value.  This is useful when doing
+  /// abort-time bumping in undo-based STM.
+  void increment() { timestamp.increment(); }
+
+  /// Create a locked orec from an id, so that a thread knows what value to use
+  /// as its lock word
+  static uintptr_t make_lockword(int id) {
+    return OrecTable<DEFAULT_ORECS, COVERAGE, TIMESOURCE>::make_lockword(id);
+  }
+};
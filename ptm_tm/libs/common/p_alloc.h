@@ -42,6 +42,7 @@
 
 #include <cstdlib>
 
+#include "captured.h"
 #include "minivector.h"
 #include "p_minivector.h"
 #include "platform.h"
@@ -132,8 +133,8 @@ public:
 
 /// The EnhancedPersistentAllocationManager does everything that
 /// BasicPersistentAllocationManager does, and adds the dynamic captured memory
-/// optimization. This optimization tracks the most recent allocation and
-/// suggests to the TM that accesses in that allocation shouldn't be
+/// optimization. This optimization tracks the transaction's recent allocations
+/// and suggests to the TM that accesses in those allocations shouldn't be
 /// instrumented.  Note that more work is needed than in the STM case, because
 /// at commit time we must flush all updates to all malloc'd regions, in case
 /// they were treated as captured.
@@ -150,11 +151,8 @@ protected:
   /// Track if allocation management is active or not
   bool active = false;
 
-  /// Address of last allocation
-  void *lastAlloc;
-
-  /// Size of last allocation
-  size_t lastSize;
+  /// The ranges of the transaction's most recent allocations
+  CapturedRanges<16> captured;
 
 public:
   /// Indicate that logging should begin
@@ -172,8 +170,7 @@ public:
     }
     frees.clear();
     active = false;
-    lastAlloc = nullptr;
-    lastSize = 0;
+    captured.clear();
   }
 
   /// When a transaction aborts, drop its frees and reclaim its mallocs
@@ -184,8 +181,7 @@ public:
     }
     mallocs.p_clear();
     active = false;
-    lastAlloc = nullptr;
-    lastSize = 0;
+    captured.clear();
   }
 
   /// To allocate memory, we must also log it, so we can reclaim it if the
@@ -196,8 +192,7 @@ public:
     void *res = malloc(size);
     if (active) {
       mallocs.push_back({res, size});
-      lastAlloc = res;
-      lastSize = size;
+      captured.add(res, size);
     }
     return res;
   }
@@ -209,8 +204,7 @@ public:
     void *res = aligned_alloc(A, size);
     if (active) {
       mallocs.push_back({res, size});
-      lastAlloc = res;
-      lastSize = size;
+      captured.add(res, size);
     }
     return res;
   }
@@ -225,13 +219,10 @@ public:
     }
   }
 
-  /// Return true if the given address is within the range returned by the most
-  /// recent allocation
+  /// Return true if the given address is within the range returned by one of the
+  /// recent allocations
   bool checkCaptured(void *addr) {
-    uintptr_t lstart = (uintptr_t)lastAlloc;
-    uintptr_t lend = lstart + lastSize;
-    uintptr_t a = (uintptr_t)addr;
-    return a >= lstart && a < lend;
+    return captured.contains(addr);
   }
 
   /// Since we use p_precommit, captured memory does not need a flush at the
@@ -272,11 +263,8 @@ protected:
   /// Track if allocation management is active or not
   bool active = false;
 
-  /// Address of last allocation
-  void *lastAlloc;
-
-  /// Size of last allocation
-  size_t lastSize;
+  /// The ranges of the transaction's most recent allocations
+  CapturedRanges<16> captured;
 
 public:
   /// Indicate that logging should begin
@@ -294,8 +282,7 @@ public:
     }
     frees.clear();
     active = false;
-    lastAlloc = nullptr;
-    lastSize = 0;
+    captured.clear();
   }
 
   /// When a transaction aborts, drop its frees and reclaim its mallocs
@@ -306,8 +293,7 @@ public:
     }
     mallocs.p_clear();
     active = false;
-    lastAlloc = nullptr;
-    lastSize = 0;
+    captured.clear();
   }
 
   /// To allocate memory, we must also log it, so we can reclaim it if the
@@ -318,8 +304,7 @@ public:
     void *res = malloc(size);
     if (active) {
       mallocs.push_back(res);
-      lastAlloc = res;
-      lastSize = size;
+      captured.add(res, size);
     }
     return res;
   }
@@ -331,8 +316,7 @@ public:
     void *res = aligned_alloc(A, size);
     if (active) {
       mallocs.push_back(res);
-      lastAlloc = res;
-      lastSize = size;
+      captured.add(res, size);
     }
     return res;
   }
@@ -347,13 +331,10 @@ public:
     }
   }
 
-  /// Return true if the given address is within the range returned by the most
-  /// recent allocation
+  /// Return true if the given address is within the range returned by one of the
+  /// recent allocations
   bool checkCaptured(void *addr) {
-    uintptr_t lstart = (uintptr_t)lastAlloc;
-    uintptr_t lend = lstart + lastSize;
-    uintptr_t a = (uintptr_t)addr;
-    return a >= lstart && a < lend;
+    return captured.contains(addr);
   }
 
   /// This allocator does not use deferred flushing of captured memory, so after
@@ -281,6 +281,9 @@ public:
   /// Fast check if the RedoLog is empty
   bool isEmpty() const { return vector_size == 0; }
 
+  /// Return the number of chunks in the RedoLog
+  size_t size() const { return vector_size; }
+
   /// fast-clear the hash by bumping the version number
   void clear() {
     vector_size = 0;
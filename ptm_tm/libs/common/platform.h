@@ -4,8 +4,13 @@
 
 #pragma once
 
+#include <cstdint>
+#include <cstdio>
 #include <ctime>
 #include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 /// A constant to help us with padding things to a cache line.
 const int CACHELINE_BYTES = 64;
@@ -20,6 +25,72 @@ inline uint64_t getElapsedTime() {
   return (((long long)t.tv_sec) * 1000000000L) + ((long long)t.tv_nsec);
 }
 
+/// Return the socket (physical package) of a CPU, or 0 if it is unknown
+inline int getSocketOf(int cpu) {
+  char path[96];
+  snprintf(path, sizeof(path),
+           "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+  int socket = 0;
+  FILE *f = fopen(path, "r");
+  if (f != nullptr) {
+    if (fscanf(f, "%d", &socket) != 1 || socket < 0) {
+      socket = 0;
+    }
+    fclose(f);
+  }
+  return socket;
+}
+
+/// Return the socket on which the calling thread is currently running
+inline int getSocket() {
+  int cpu = sched_getcpu();
+  return (cpu < 0) ? 0 : getSocketOf(cpu);
+}
+
+/// Return the number of sockets in the machine
+inline int getNumSockets() {
+  int sockets = 1;
+  long cpus = sysconf(_SC_NPROCESSORS_CONF);
+  for (long i = 0; i < cpus; ++i) {
+    int s = getSocketOf(i) + 1;
+    sockets = (s > sockets) ? s : sockets;
+  }
+  return sockets;
+}
+
+/// The size of a huge page on x86
+const size_t HUGE_PAGE_BYTES = 2 * 1024 * 1024;
+
+/// Allocate a zeroed, huge-page aligned region of memory for a large table that
+/// lives for the rest of the program.  We first try to get explicit huge pages,
+/// and if none are reserved, we fall back to regular pages and ask the kernel
+/// to back them with transparent huge pages.  Returns nullptr on failure.
+inline void *allocHugePages(size_t bytes) {
+  bytes = (bytes + HUGE_PAGE_BYTES - 1) & ~(HUGE_PAGE_BYTES - 1);
+  void *mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (mem != MAP_FAILED) {
+    return mem;
+  }
+  // Transparent huge pages are only used for aligned 2MB chunks, so
+  // over-allocate and then trim the region to a huge page boundary
+  size_t padded = bytes + HUGE_PAGE_BYTES;
+  mem = mmap(nullptr, padded, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED) {
+    return nullptr;
+  }
+  uintptr_t start = reinterpret_cast<uintptr_t>(mem);
+  uintptr_t aligned = (start + HUGE_PAGE_BYTES - 1) & ~(HUGE_PAGE_BYTES - 1);
+  if (aligned != start) {
+    munmap(mem, aligned - start);
+  }
+  munmap(reinterpret_cast<void *>(aligned + bytes),
+         start + padded - (aligned + bytes));
+  madvise(reinterpret_cast<void *>(aligned), bytes, MADV_HUGEPAGE);
+  return reinterpret_cast<void *>(aligned);
+}
+
 /// Spin briefly
 void spin64() {
   for (int i = 0; i < 64; ++i)
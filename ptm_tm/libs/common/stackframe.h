@@ -41,6 +41,9 @@ public:
 
   /// No-op
   void onCommit() {}
+
+  /// When a descriptor is pooled, reset nesting
+  void reset() { nesting = 0; }
 };
 
 /// OptimizedStackFrameManager is a stack frame manager that is able to change
@@ -99,4 +102,12 @@ public:
   /// necessary, so that setBottom can be called correctly from outside of a
   /// transaction.
   void onCommit() { stackBottom = 0; }
+
+  /// When a descriptor is pooled, clear its nesting and stack bottom, since
+  /// the bottom may have been set outside of a transaction, and it points into
+  /// the stack of a thread that has exited.
+  void reset() {
+    stackBottom = 0;
+    nesting = 0;
+  }
 };
\ No newline at end of file
@@ -0,0 +1,307 @@
+/// stats.h provides a set of StatsManagers, which let a TM algorithm count the
+/// events that happen on its transaction boundaries (begin, commit, abort, and
+/// transitions to irrevocability).  Each thread has its own counters, so that
+/// counting never causes coherence traffic.  The counters of all threads are
+/// aggregated only when the program asks for a report.
+///
+/// The TM algorithm is expected to invoke the StatsManager at the following
+/// points:
+/// - onBegin: each time a top-level transaction (re)starts
+/// - onCommit: when a speculative transaction commits, with the sizes of its
+///   read and write sets, in whatever units the algorithm tracks them (orecs,
+///   values, bytelocks, ...)
+/// - onCommitIrrevoc: when an irrevocable transaction commits
+/// - onAbort: each time a transaction aborts.  Algorithms that use orecs can
+///   also pass the cause of the abort, and the index of the orec on which the
+///   conflict happened (if any)
+/// - onIrrevoc: when an in-flight transaction becomes irrevocable
+/// - onUpgrade: when a read-only transaction writes, and restarts as a writer.
+///   This is not a conflict, so it is not counted as an abort.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <unordered_map>
+#include <vector>
+
+/// The reasons for which an orec-based TM may abort a transaction
+enum abort_cause_t {
+  /// The orec was locked by another transaction
+  ABORT_LOCKED,
+  /// The orec was newer than the transaction's start time, and the algorithm
+  /// could not extend its start time
+  ABORT_TOO_NEW,
+  /// An orec in the read set changed, so validation failed
+  ABORT_VALIDATION,
+  /// The compare-and-swap to acquire an orec failed
+  ABORT_LOCK_CAS,
+  /// The transaction could not become irrevocable
+  ABORT_IRREVOC,
+  /// The number of causes.  This must be the last entry.
+  ABORT_NUM_CAUSES
+};
+
+/// Index to pass to onAbort when an abort cannot be attributed to an orec
+const size_t NO_OREC = SIZE_MAX;
+
+/// NoopStats is a StatsManager that does not count anything.  All of its
+/// methods are empty, so that when it is used, statistics are compiled out of
+/// the TM algorithm entirely.
+class NoopStats {
+public:
+  /// NoopStats has no shared data, but to simplify the use of this class as a
+  /// template parameter to TM algorithms, we need to define a Globals class
+  /// anyway.
+  struct Globals {
+    /// Reporting is a no-op
+    void report() {}
+  };
+
+  /// Construct a thread's NoopStats.  There is nothing to register.
+  NoopStats(Globals &, size_t) {}
+
+  /// Beginning a transaction is not counted
+  void onBegin() {}
+
+  /// Committing a transaction is not counted
+  void onCommit(uint64_t, uint64_t) {}
+
+  /// Committing an irrevocable transaction is not counted
+  void onCommitIrrevoc() {}
+
+  /// Aborting a transaction is not counted
+  void onAbort() {}
+
+  /// Aborting a transaction is not counted, nor is its cause
+  void onAbort(abort_cause_t, size_t) {}
+
+  /// Becoming irrevocable is not counted
+  void onIrrevoc() {}
+
+  /// Upgrading a read-only transaction is not counted
+  void onUpgrade() {}
+};
+
+/// CountingStats is a StatsManager that keeps a block of counters in each
+/// thread's descriptor.  The block is registered in a global table, indexed by
+/// the thread's Id, so that report() can sum the counters of all threads.
+///
+/// In addition to the basic counters, CountingStats tracks the cause of each
+/// abort, and keeps an approximate histogram of the orecs that caused the most
+/// aborts.  The histogram is a direct-mapped table with HOTSLOTS entries per
+/// thread.  When two orecs map to the same slot, the resident orec's count is
+/// decremented, and the newcomer only takes over the slot when that count
+/// reaches zero, so that frequently conflicting orecs tend to stay resident.
+/// At report time, the TOPN orecs with the highest counts are printed.
+///
+/// Descriptors are never destroyed: API_TM_DESCRIPTOR pools the descriptors of
+/// exited threads, and a thread that takes one keeps adding to its counters.
+/// Thus the thread count in the report is the number of descriptors.
+///
+/// NB: the counters are not atomic.  report() is meant to be called when no
+///     transactions are running (e.g., at the end of a benchmark), otherwise
+///     the totals it prints may be slightly stale.
+template <int MAXTHREADS, int HOTSLOTS, int TOPN> class CountingStats {
+  /// An entry in the histogram of conflicting orecs
+  struct hot_orec_t {
+    /// The index of the orec
+    size_t orec = NO_OREC;
+
+    /// The number of aborts attributed to the orec
+    uint64_t count = 0;
+  };
+
+  /// The counters kept by each thread
+  struct counters_t {
+    /// Number of times a transaction started (including restarts)
+    uint64_t begins = 0;
+
+    /// Number of speculative transactions that committed with writes
+    uint64_t commits = 0;
+
+    /// Number of speculative transactions that committed without writes
+    uint64_t ro_commits = 0;
+
+    /// Number of transactions that committed while irrevocable
+    uint64_t irrevoc_commits = 0;
+
+    /// Number of aborts
+    uint64_t aborts = 0;
+
+    /// Number of in-flight transitions to irrevocability
+    uint64_t irrevocs = 0;
+
+    /// Number of read-only transactions that restarted as writers
+    uint64_t upgrades = 0;
+
+    /// Sum of the read set sizes of all committed transactions
+    uint64_t reads = 0;
+
+    /// Sum of the write set sizes of all committed transactions
+    uint64_t writes = 0;
+
+    /// Largest read set of any committed transaction
+    uint64_t max_reads = 0;
+
+    /// Largest write set of any committed transaction
+    uint64_t max_writes = 0;
+
+    /// Number of aborts with each cause
+    uint64_t causes[ABORT_NUM_CAUSES] = {0};
+
+    /// Orecs that caused aborts
+    hot_orec_t hot[HOTSLOTS];
+  };
+
+  /// Add one thread's counters to a total, and its orecs to a histogram
+  static void fold(counters_t &total, std::unordered_map<size_t, uint64_t> &hot,
+                   const counters_t &c) {
+    total.begins += c.begins;
+    total.commits += c.commits;
+    total.ro_commits += c.ro_commits;
+    total.irrevoc_commits += c.irrevoc_commits;
+    total.aborts += c.aborts;
+    total.irrevocs += c.irrevocs;
+    total.upgrades += c.upgrades;
+    total.reads += c.reads;
+    total.writes += c.writes;
+    total.max_reads = std::max(total.max_reads, c.max_reads);
+    total.max_writes = std::max(total.max_writes, c.max_writes);
+    for (int j = 0; j < ABORT_NUM_CAUSES; ++j) {
+      total.causes[j] += c.causes[j];
+    }
+    for (int j = 0; j < HOTSLOTS; ++j) {
+      if (c.hot[j].count > 0) {
+        hot[c.hot[j].orec] += c.hot[j].count;
+      }
+    }
+  }
+
+public:
+  /// Globals holds a pointer to each thread's counters, so that they can be
+  /// aggregated at report time.
+  class Globals {
+    /// The counters of each thread, indexed by thread Id
+    std::atomic<counters_t *> threads[MAXTHREADS];
+
+  public:
+    /// Construct a CountingStats::Globals by clearing the table
+    Globals() {
+      for (int i = 0; i < MAXTHREADS; ++i) {
+        threads[i] = nullptr;
+      }
+    }
+
+    /// Register a thread's counters
+    void enroll(size_t id, counters_t *c) { threads[id] = c; }
+
+    /// Sum the counters of all threads, and print the totals
+    void report() {
+      counters_t total;
+      std::unordered_map<size_t, uint64_t> hot;
+      uint64_t count = 0;
+      for (int i = 0; i < MAXTHREADS; ++i) {
+        counters_t *c = threads[i];
+        if (c == nullptr) {
+          continue;
+        }
+        ++count;
+        fold(total, hot, *c);
+      }
+      uint64_t spec = total.commits + total.ro_commits;
+      printf("[TM STATS] threads: %lu\n", count);
+      printf("[TM STATS] begins: %lu\n", total.begins);
+      printf("[TM STATS] commits (rw / ro / irrevocable): %lu / %lu / %lu\n",
+             total.commits, total.ro_commits, total.irrevoc_commits);
+      printf("[TM STATS] aborts: %lu\n", total.aborts);
+      printf("[TM STATS] irrevocable transitions: %lu\n", total.irrevocs);
+      printf("[TM STATS] read-only upgrades: %lu\n", total.upgrades);
+      printf("[TM STATS] read set (avg / max): %.2f / %lu\n",
+             spec ? (double)total.reads / spec : 0.0, total.max_reads);
+      printf("[TM STATS] write set (avg / max): %.2f / %lu\n",
+             spec ? (double)total.writes / spec : 0.0, total.max_writes);
+
+      // Only orec-based algorithms report causes
+      uint64_t attributed = 0;
+      for (int j = 0; j < ABORT_NUM_CAUSES; ++j) {
+        attributed += total.causes[j];
+      }
+      if (attributed == 0) {
+        return;
+      }
+      const char *names[ABORT_NUM_CAUSES] = {"locked", "too new", "validation",
+                                             "lock cas", "irrevocability"};
+      for (int j = 0; j < ABORT_NUM_CAUSES; ++j) {
+        printf("[TM STATS] aborts (%s): %lu\n", names[j], total.causes[j]);
+      }
+
+      // Print the hottest orecs, most conflicted first
+      std::vector<std::pair<size_t, uint64_t>> sorted(hot.begin(), hot.end());
+      size_t n = std::min(sorted.size(), (size_t)TOPN);
+      std::partial_sort(sorted.begin(), sorted.begin() + n, sorted.end(),
+                        [](auto &a, auto &b) { return a.second > b.second; });
+      for (size_t j = 0; j < n; ++j) {
+        printf("[TM STATS] hot orec #%lu: index %lu, %lu aborts\n", j + 1,
+               sorted[j].first, sorted[j].second);
+      }
+    }
+  };
+
+private:
+  /// This thread's counters
+  counters_t counters;
+
+public:
+  /// Construct a thread's CountingStats by registering its counters
+  CountingStats(Globals &g, size_t id) { g.enroll(id, &counters); }
+
+  /// Count the (re)start of a transaction
+  void onBegin() { ++counters.begins; }
+
+  /// Count the commit of a speculative transaction, and track the sizes of its
+  /// read and write sets
+  void onCommit(uint64_t reads, uint64_t writes) {
+    if (writes == 0) {
+      ++counters.ro_commits;
+    } else {
+      ++counters.commits;
+    }
+    counters.reads += reads;
+    counters.writes += writes;
+    counters.max_reads = std::max(counters.max_reads, reads);
+    counters.max_writes = std::max(counters.max_writes, writes);
+  }
+
+  /// Count the commit of an irrevocable transaction
+  void onCommitIrrevoc() { ++counters.irrevoc_commits; }
+
+  /// Count an abort
+  void onAbort() { ++counters.aborts; }
+
+  /// Count an abort, along with its cause and the orec that caused it
+  void onAbort(abort_cause_t cause, size_t orec) {
+    ++counters.aborts;
+    ++counters.causes[cause];
+    if (orec == NO_OREC) {
+      return;
+    }
+    hot_orec_t &h = counters.hot[orec % HOTSLOTS];
+    if (h.orec == orec) {
+      ++h.count;
+    } else if (h.count == 0) {
+      h.orec = orec;
+      h.count = 1;
+    } else {
+      --h.count;
+    }
+  }
+
+  /// Count a transition to irrevocability
+  void onIrrevoc() { ++counters.irrevocs; }
+
+  /// Count a read-only transaction that restarted as a writer
+  void onUpgrade() { ++counters.upgrades; }
+};
@@ -5,6 +5,7 @@
 #include <x86intrin.h>
 
 #include "../common/orec_t.h"
+#include "../common/platform.h"
 
 /// CounterTimesource uses a monotonically increasing shared memory counter as
 /// the timesource
@@ -52,4 +53,128 @@ public:
 
   /// No-op for RdtscpTimesource
   void increment() {}
-};
\ No newline at end of file
+};
+
+/// SharedCounterTimesource is a GV4-style shared memory counter: when several
+/// writers try to get a commit time at the same moment, only one of them
+/// advances the counter, and the rest share the value it installed, instead of
+/// each taking a turn at incrementing the counter.
+///
+/// Sharing is only safe if the writers that share a time do not skip
+/// validation.  Algorithms skip validation when their commit time is one more
+/// than their start time, so the counter only holds even values, and advances
+/// by two:
+/// - The writer whose CAS succeeds gets old + 1.  That is odd, and is start + 1
+///   only if the counter did not change (and nobody shared a time) during the
+///   writer's transaction, exactly as with CounterTimesource.
+/// - A writer whose CAS fails gets the (even) value that the winner installed,
+///   which can never be start + 1, so it validates.  The winner installed that
+///   value after the writer read the counter, and thus after the writer locked
+///   its orecs, so any transaction whose start time is at least that value
+///   will see the writer's locks or the writer's new values.
+///
+/// NB: like CounterTimesource, this assumes that a writer holds its locks
+///     before it gets its commit time.
+class SharedCounterTimesource {
+  /// The global clock.  It is always even
+  pad_dword_t timestamp;
+
+public:
+  typedef uint64_t time_snapshot_t;
+
+  /// Read the counter
+  uint64_t get_time() { return timestamp.val; }
+
+  /// get_time_strong_ordering is the same for SharedCounterTimesource
+  uint64_t get_time_strong_ordering() { return timestamp.val; }
+
+  /// Try once to advance the counter, and share the winner's time on failure
+  uint64_t increment_get() {
+    uint64_t old = timestamp.val;
+    if (timestamp.val.compare_exchange_strong(old, old + 2)) {
+      return old + 1;
+    }
+    return old; // the failed CAS loaded the winner's value into old
+  }
+
+  /// Increment the clock, and ignore the new value.  This is useful when doing
+  /// abort-time bumping in undo-based STM.
+  void increment() { timestamp.val += 2; }
+};
+
+/// SocketTimesource distributes the clock across sockets: each socket has its
+/// own counter, on its own lines, and the time is the largest of them.  Reading
+/// the time only reads the counters, which can be shared by all caches, and a
+/// commit only writes the counter of the committer's socket, so the clock does
+/// not bounce between sockets on every commit.
+///
+/// A commit time is two more than the largest counter, and it is published to
+/// the committer's socket's counter.  The counters are read one at a time, so
+/// two writers on different sockets may get the same time, and a writer may
+/// miss a time that another socket published while it was reading.  Both are
+/// safe as long as writers validate, so times are always even, and hence never
+/// one more than a start time: with this timesource, writers always validate.
+///
+/// NB: A thread uses the counter of the socket on which it first committed.  If
+///     it migrates, it still works correctly, but causes more coherence misses.
+///
+/// NB: like CounterTimesource, this assumes that a writer holds its locks
+///     before it gets its commit time.
+template <int MAXSOCKETS> class SocketTimesource {
+  /// The counter of each socket.  They are always even
+  pad_dword_t clocks[MAXSOCKETS];
+
+  /// The number of counters in use
+  int sockets;
+
+  /// Return the index of the calling thread's counter
+  int mySocket() {
+    static thread_local int socket = -1;
+    if (__builtin_expect(socket < 0, false)) {
+      socket = getSocket() % sockets;
+    }
+    return socket;
+  }
+
+  /// Raise the calling thread's counter to at least the given time
+  void publish(uint64_t time) {
+    std::atomic<uintptr_t> &c = clocks[mySocket()].val;
+    uintptr_t curr = c;
+    while (curr < time && !c.compare_exchange_weak(curr, time))
+      ;
+  }
+
+public:
+  typedef uint64_t time_snapshot_t;
+
+  /// Construct a SocketTimesource with one counter per socket
+  SocketTimesource() {
+    int n = getNumSockets();
+    sockets = (n < MAXSOCKETS) ? n : MAXSOCKETS;
+  }
+
+  /// The time is the largest of the counters
+  uint64_t get_time() {
+    uint64_t max = 0;
+    for (int i = 0; i < sockets; ++i) {
+      uint64_t c = clocks[i].val;
+      max = (c > max) ? c : max;
+    }
+    return max;
+  }
+
+  /// get_time_strong_ordering is the same for SocketTimesource
+  uint64_t get_time_strong_ordering() { return get_time(); }
+
+  /// Get a time that is newer than every counter, and publish it to the
+  /// calling thread's socket
+  uint64_t increment_get() {
+    uint64_t time = get_time() + 2;
+    publish(time);
+    return time;
+  }
+
+  /// Advance the clock, and ignore the new value.  This is useful when doing
+  /// abort-time bumping in undo-based STM.
+  void increment() { publish(get_time() + 2); }
+};
@@ -53,6 +53,12 @@ public:
   /// Set the current bottom of the transactional part of the stack
   void adjustStackBottom(void *addr) { frame.setBottom(addr); }
 
+  /// Prepare the descriptor to wait in the pool when its thread exits
+  void park() { frame.reset(); }
+
+  /// Prepare a pooled descriptor for use by a new thread
+  void unpark() {}
+
   /// construct a thread's transaction context
   P_CGL_Eager() : p_status(nullptr, &p_undolog, &allocator) {}
 
@@ -1,8 +1,8 @@
 #pragma once
 
 #include <atomic>
-#include <setjmp.h>
 
+#include "../common/checkpoint.h"
 #include "../common/deferred.h"
 #include "../common/minivector.h"
 #include "../common/p_status_t.h"
@@ -20,6 +20,7 @@
 /// - Contention manager
 /// - Stack Frame (to bring some of the caller frame into tx scope)
 /// - Allocator (to become irrevocable on too many allocations)
+/// - Statistics (per-thread counters, or nothing)
 /// - PMEM durability domain (ADR or eADR)
 ///
 /// Note that it is possible to produce an incorrect STM.  For example, no
@@ -28,7 +29,7 @@
 /// safety, but does require Quiescence if it uses an allocator that can return
 /// memory to the operating system.
 template <class REDOLOG, class EPOCH, class CM, class STACKFRAME,
-          class ALLOCATOR, class PMEM>
+          class ALLOCATOR, class PMEM, class STATS>
 class P_NOrec {
   /// Globals is a wrapper around all of the global variables used by NOrec
   struct Globals {
@@ -40,6 +41,9 @@ class P_NOrec {
 
     /// Quiescence support
     typename EPOCH::Globals epoch;
+
+    /// Statistics aggregation
+    typename STATS::Globals stats;
   };
 
   /// All metadata shared among threads
@@ -50,7 +54,7 @@ class P_NOrec {
 
   /// Checkpoint lets us reset registers and the instruction pointer in the
   /// event of an abort
-  jmp_buf *checkpoint;
+  checkpoint_t *checkpoint;
 
   /// For managing thread IDs, Quiescence, and Irrevocability
   EPOCH epoch;
@@ -77,6 +81,9 @@ class P_NOrec {
   /// commit.
   DeferredActionHandler deferredActions;
 
+  /// Per-thread statistics counters
+  STATS stats;
+
 public:
   /// Return the irrevocability state of the thread
   bool isIrrevoc() { return epoch.isIrrevoc(); }
@@ -84,13 +91,23 @@ public:
   /// Set the current bottom of the transactional part of the stack
   void adjustStackBottom(void *addr) { frame.setBottom(addr); }
 
+  /// Prepare the descriptor to wait in the pool when its thread exits
+  void park() {
+    epoch.park();
+    frame.reset();
+  }
+
+  /// Prepare a pooled descriptor for use by a new thread
+  void unpark() { epoch.unpark(); }
+
   /// construct a thread's transaction context by zeroing its nesting depth and
   /// giving it an ID.
   P_NOrec()
-      : p_status(nullptr, &p_redolog, &allocator), epoch(globals.epoch), cm() {}
+      : p_status(nullptr, &p_redolog, &allocator), epoch(globals.epoch), cm(),
+        stats(globals.stats, epoch.id) {}
 
   /// Instrumentation to run at the beginning of a transaction boundary.
-  void beginTx(jmp_buf *b) {
+  void beginTx(checkpoint_t *b) {
     // onBegin == false -> flat nesting
     if (frame.onBegin()) {
       // Save the checkpoint and set the stack bottom
@@ -99,6 +116,7 @@ public:
 
       // Start logging allocations
       allocator.onBegin();
+      stats.onBegin();
 
       // Get the start time, and put it into the epoch.  epoch.onBegin will wait
       // until there are no irrevocable transactions.
@@ -127,6 +145,7 @@ public:
         }
         allocator.commitMallocs();
         epoch.clearEpoch(globals.epoch);
+        stats.onCommit(valuelog.size(), 0);
         valuelog.clear();
         cm.afterCommit(globals.cm);
         epoch.quiesce(globals.epoch, lock_snapshot);
@@ -180,6 +199,7 @@ public:
 
       // clear lists.  Quiesce before freeing, noting that we need threads to be
       // > lock_snapshot
+      stats.onCommit(valuelog.size(), p_redolog.size());
       p_redolog.clear();
       valuelog.clear();
       cm.afterCommit(globals.cm);
@@ -291,6 +311,9 @@ public:
     deferredActions.registerHandler(func, args);
   }
 
+  /// Print the statistics of all threads
+  static void reportStats() { globals.stats.report(); }
+
 private:
   /// Validation.  We need to make sure the lock is even and does not change
   /// while we check values
@@ -322,6 +345,7 @@ private:
     // wait on this thread.
     epoch.clearEpoch(globals.epoch);
     cm.afterAbort(globals.cm, epoch.id);
+    stats.onAbort();
 
     // reset all lists
     p_redolog.clear();
@@ -329,7 +353,7 @@ private:
     allocator.onAbort(); // this reclaims all mallocs
     deferredActions.onAbort();
     frame.onAbort();
-    longjmp(*checkpoint, 1); // Takes us back to calling beginTx()
+    restore_checkpoint(checkpoint); // Takes us back to calling beginTx()
   }
 
   /// Check if the given address is on the thread's stack, and hence does not
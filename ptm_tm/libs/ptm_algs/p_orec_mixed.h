@@ -1,8 +1,8 @@
 #pragma once
 
 #include <atomic>
-#include <setjmp.h>
 
+#include "../common/checkpoint.h"
 #include "../common/deferred.h"
 #include "../common/minivector.h"
 #include "../common/orec_t.h"
@@ -23,8 +23,9 @@
 /// - Stack Frame (to bring some of the caller frame into tx scope)
 /// - Allocator (captured memory)
 /// - PMEM durability domain (ADR or eADR)
+/// - Statistics (per-thread counters, or nothing)
 template <class ORECTABLE, class REDOLOG, class EPOCH, class CM,
-          class STACKFRAME, class ALLOCATOR, class PMEM>
+          class STACKFRAME, class ALLOCATOR, class PMEM, class STATS>
 class P_OrecMixed {
   /// Globals is a wrapper around all of the global variables used by OrecMixed
   struct Globals {
@@ -36,6 +37,9 @@ class P_OrecMixed {
 
     /// Quiescence support
     typename EPOCH::Globals epoch;
+
+    /// Statistics aggregation
+    typename STATS::Globals stats;
   };
 
   /// All metadata shared among threads
@@ -46,7 +50,7 @@ class P_OrecMixed {
 
   /// Checkpoint lets us reset registers and the instruction pointer in the
   /// event of an abort
-  jmp_buf *checkpoint = nullptr;
+  checkpoint_t *checkpoint = nullptr;
 
   /// For managing thread IDs, Quiescence, and Irrevocability
   EPOCH epoch;
@@ -79,6 +83,9 @@ class P_OrecMixed {
   /// commit.
   DeferredActionHandler deferredActions;
 
+  /// Per-thread statistics counters
+  STATS stats;
+
 public:
   /// Return the irrevocability state of the thread
   bool isIrrevoc() { return epoch.isIrrevoc(); }
@@ -86,15 +93,25 @@ public:
   /// Set the current bottom of the transactional part of the stack
   void adjustStackBottom(void *addr) { frame.setBottom(addr); }
 
+  /// Prepare the descriptor to wait in the pool when its thread exits
+  void park() {
+    epoch.park();
+    frame.reset();
+  }
+
+  /// Prepare a pooled descriptor for use by a new thread
+  void unpark() { epoch.unpark(); }
+
   /// construct a thread's transaction context by zeroing its nesting depth and
   /// giving it an ID.  We also cache its lock token.
   P_OrecMixed()
-      : p_status(nullptr, &p_redolog, &allocator), epoch(globals.epoch), cm() {
+      : p_status(nullptr, &p_redolog, &allocator), epoch(globals.epoch), cm(),
+        stats(globals.stats, epoch.id) {
     my_lock = ORECTABLE::make_lockword(epoch.id);
   }
 
   /// Instrumentation to run at the beginning of a transaction boundary.
-  void beginTx(jmp_buf *b) {
+  void beginTx(checkpoint_t *b) {
     // onBegin == false -> flat nesting
     if (frame.onBegin()) {
       // Save the checkpoint and set the stack bottom
@@ -103,6 +120,7 @@ public:
 
       // Start logging allocations
       allocator.onBegin();
+      stats.onBegin();
 
       // Get the start time, and put it into the epoch.  epoch.onBegin will wait
       // until there are no irrevocable transactions.
@@ -128,6 +146,7 @@ public:
         }
         allocator.commitMallocs();
         epoch.clearEpoch(globals.epoch);
+        stats.onCommit(readset.size(), 0);
         readset.clear();
         cm.afterCommit(globals.cm);
         epoch.quiesce(globals.epoch, start_time);
@@ -187,6 +206,7 @@ public:
       }
 
       // clear lists.  Quiesce before freeing
+      stats.onCommit(readset.size(), lockset.size());
       p_redolog.clear();
       lockset.clear();
       readset.clear();
@@ -335,6 +355,9 @@ public:
     deferredActions.registerHandler(func, args);
   }
 
+  /// Print the statistics of all threads
+  static void reportStats() { globals.stats.report(); }
+
 private:
   /// Validation.  We need to make sure that all orecs that we've read
   /// have timestamps older than our start time, unless we locked those orecs.
@@ -363,6 +386,7 @@ private:
     // wait on this thread.
     epoch.clearEpoch(globals.epoch);
     cm.afterAbort(globals.cm, epoch.id);
+    stats.onAbort();
 
     // release any locks held by this thread
     // NB: possible extra fences
@@ -379,7 +403,7 @@ private:
     allocator.onAbort(); // this reclaims all mallocs
     deferredActions.onAbort();
     frame.onAbort();
-    longjmp(*checkpoint, 1); // Takes us back to calling beginTx()
+    restore_checkpoint(checkpoint); // Takes us back to calling beginTx()
   }
 
   /// Check if the given address is on the thread's stack, and hence does not
@@ -3,8 +3,8 @@
 #include <atomic>
 #include <cstring>
 #include <exception>
-#include <setjmp.h>
 
+#include "../common/checkpoint.h"
 #include "../common/deferred.h"
 #include "../common/p_status_t.h"
 #include "../common/p_vlog_t.h"
@@ -27,8 +27,9 @@
 /// - Stack Frame (to bring some of the caller frame into tx scope)
 /// - Allocator (capture optimizations)
 /// - PMEM durability domain (ADR or eADR)
+/// - Statistics (per-thread counters, or nothing)
 template <int RING_ELEMENTS, class BITFILTER, class REDOLOG, class EPOCH,
-          class CM, class STACKFRAME, class ALLOCATOR, class PMEM>
+          class CM, class STACKFRAME, class ALLOCATOR, class PMEM, class STATS>
 class P_RingMW {
   /// Globals is a wrapper around all of the global variables used by RingMW
   struct Globals {
@@ -51,6 +52,9 @@ class P_RingMW {
 
     /// Quiescence support
     typename EPOCH::Globals epoch;
+
+    /// Statistics aggregation
+    typename STATS::Globals stats;
   };
 
   /// All metadata shared among threads
@@ -61,7 +65,7 @@ class P_RingMW {
 
   /// Checkpoint lets us reset registers and the instruction pointer in the
   /// event of an abort
-  jmp_buf *checkpoint;
+  checkpoint_t *checkpoint;
 
   /// For managing thread IDs, Quiescence, and Irrevocability
   EPOCH epoch;
@@ -91,6 +95,9 @@ class P_RingMW {
   /// commit.
   DeferredActionHandler deferredActions;
 
+  /// Per-thread statistics counters
+  STATS stats;
+
 public:
   /// Return the irrevocability state of the thread
   bool isIrrevoc() { return epoch.isIrrevoc(); }
@@ -98,10 +105,20 @@ public:
   /// Set the current bottom of the transactional part of the stack
   void adjustStackBottom(void *addr) { frame.setBottom(addr); }
 
+  /// Prepare the descriptor to wait in the pool when its thread exits
+  void park() {
+    epoch.park();
+    frame.reset();
+  }
+
+  /// Prepare a pooled descriptor for use by a new thread
+  void unpark() { epoch.unpark(); }
+
   /// construct a thread's transaction context by zeroing its nesting depth and
   /// giving it an ID.
   P_RingMW()
-      : p_status(nullptr, &p_redolog, &allocator), epoch(globals.epoch), cm() {
+      : p_status(nullptr, &p_redolog, &allocator), epoch(globals.epoch), cm(),
+        stats(globals.stats, epoch.id) {
     // NB: this allocation strategy is necessary since (optional) SSE introduces
     // alignment requirements
     wf = (BITFILTER *)BITFILTER::filter_alloc(sizeof(BITFILTER));
@@ -111,7 +128,7 @@ public:
   }
 
   /// Instrumentation to run at the beginning of a transaction boundary.
-  void beginTx(jmp_buf *b) {
+  void beginTx(checkpoint_t *b) {
     // onBegin == false -> flat nesting
     if (frame.onBegin()) {
       // Save the checkpoint and set the stack bottom
@@ -120,6 +137,7 @@ public:
 
       // Start logging allocations
       allocator.onBegin();
+      stats.onBegin();
 
       // Start time is when the last txn completed
       start_time = globals.last_complete.val;
@@ -143,6 +161,8 @@ public:
           PMEM::sfence();
         }
         allocator.commitMallocs();
+        // NB: the read set is a filter, so we cannot report its size
+        stats.onCommit(0, 0);
         rf->clear();
         epoch.clearEpoch(globals.epoch);
         cm.afterCommit(globals.cm);
@@ -236,6 +256,7 @@ public:
       }
 
       // clear lists.  Quiesce before freeing
+      stats.onCommit(0, p_redolog.size());
       p_redolog.clear();
       rf->clear();
       wf->clear();
@@ -343,6 +364,9 @@ public:
     deferredActions.registerHandler(func, args);
   }
 
+  /// Print the statistics of all threads
+  static void reportStats() { globals.stats.report(); }
+
 private:
   /// Check the validity of a transaction by doing bitfilter intersections
   bool check_valid(uint64_t my_index) {
@@ -377,6 +401,7 @@ private:
     // wait on this thread.
     epoch.clearEpoch(globals.epoch);
     cm.afterAbort(globals.cm, epoch.id);
+    stats.onAbort();
 
     // reset all lists
     p_redolog.clear();
@@ -385,7 +410,7 @@ private:
     allocator.onAbort(); // this reclaims all mallocs
     deferredActions.onAbort();
     frame.onAbort();
-    longjmp(*checkpoint, 1); // Takes us back to calling beginTx()
+    restore_checkpoint(checkpoint); // Takes us back to calling beginTx()
   }
 
   /// Check if the given address is on the thread's stack, and hence does not
@@ -3,8 +3,8 @@
 #include <atomic>
 #include <cstring>
 #include <exception>
-#include <setjmp.h>
 
+#include "../common/checkpoint.h"
 #include "../common/deferred.h"
 #include "../common/p_status_t.h"
 #include "../common/p_vlog_t.h"
@@ -26,8 +26,9 @@
 /// - Stack Frame (to bring some of the caller frame into tx scope)
 /// - Allocator (capture optimizations)
 /// - PMEM durability domain (ADR or eADR)
+/// - Statistics (per-thread counters, or nothing)
 template <int RING_ELEMENTS, class BITFILTER, class REDOLOG, class EPOCH,
-          class CM, class STACKFRAME, class ALLOCATOR, class PMEM>
+          class CM, class STACKFRAME, class ALLOCATOR, class PMEM, class STATS>
 class P_RingSW {
   /// Globals is a wrapper around all of the global variables used by RingSW
   struct Globals {
@@ -50,6 +51,9 @@ class P_RingSW {
 
     /// Quiescence support
     typename EPOCH::Globals epoch;
+
+    /// Statistics aggregation
+    typename STATS::Globals stats;
   };
 
   /// All metadata shared among threads
@@ -60,7 +64,7 @@ class P_RingSW {
 
   /// Checkpoint lets us reset registers and the instruction pointer in the
   /// event of an abort
-  jmp_buf *checkpoint;
+  checkpoint_t *checkpoint;
 
   /// For managing thread IDs, Quiescence, and Irrevocability
   EPOCH epoch;
@@ -90,6 +94,9 @@ class P_RingSW {
   /// commit.
   DeferredActionHandler deferredActions;
 
+  /// Per-thread statistics counters
+  STATS stats;
+
 public:
   /// Return the irrevocability state of the thread
   bool isIrrevoc() { return epoch.isIrrevoc(); }
@@ -97,10 +104,20 @@ public:
   /// Set the current bottom of the transactional part of the stack
   void adjustStackBottom(void *addr) { frame.setBottom(addr); }
 
+  /// Prepare the descriptor to wait in the pool when its thread exits
+  void park() {
+    epoch.park();
+    frame.reset();
+  }
+
+  /// Prepare a pooled descriptor for use by a new thread
+  void unpark() { epoch.unpark(); }
+
   /// construct a thread's transaction context by zeroing its nesting depth and
   /// giving it an ID.
   P_RingSW()
-      : p_status(nullptr, &p_redolog, &allocator), epoch(globals.epoch), cm() {
+      : p_status(nullptr, &p_redolog, &allocator), epoch(globals.epoch), cm(),
+        stats(globals.stats, epoch.id) {
     // NB: this allocation strategy is necessary since (optional) SSE introduces
     // alignment requirements
     wf = (BITFILTER *)BITFILTER::filter_alloc(sizeof(BITFILTER));
@@ -110,7 +127,7 @@ public:
   }
 
   /// Instrumentation to run at the beginning of a transaction boundary.
-  void beginTx(jmp_buf *b) {
+  void beginTx(checkpoint_t *b) {
     // onBegin == false -> flat nesting
     if (frame.onBegin()) {
       // Save the checkpoint and set the stack bottom
@@ -119,6 +136,7 @@ public:
 
       // Start logging allocations
       allocator.onBegin();
+      stats.onBegin();
 
       // Start time is when the last txn completed
       start_time = globals.last_complete.val;
@@ -142,6 +160,8 @@ public:
           PMEM::sfence();
         }
         allocator.commitMallocs();
+        // NB: the read set is a filter, so we cannot report its size
+        stats.onCommit(0, 0);
         rf->clear();
         epoch.clearEpoch(globals.epoch);
         cm.afterCommit(globals.cm);
@@ -227,6 +247,7 @@ public:
       }
 
       // clear lists.  Quiesce before freeing
+      stats.onCommit(0, p_redolog.size());
       p_redolog.clear();
       rf->clear();
       wf->clear();
@@ -334,6 +355,9 @@ public:
     deferredActions.registerHandler(func, args);
   }
 
+  /// Print the statistics of all threads
+  static void reportStats() { globals.stats.report(); }
+
 private:
   /// Check the validity of a transaction by doing bitfilter intersections
   bool check_valid(uint64_t my_index) {
@@ -367,6 +391,7 @@ private:
     // wait on this thread.
     epoch.clearEpoch(globals.epoch);
     cm.afterAbort(globals.cm, epoch.id);
+    stats.onAbort();
 
     // reset all lists
     p_redolog.clear();
@@ -375,7 +400,7 @@ private:
     allocator.onAbort(); // this reclaims all mallocs
     deferredActions.onAbort();
     frame.onAbort();
-    longjmp(*checkpoint, 1); // Takes us back to calling beginTx()
+    restore_checkpoint(checkpoint); // Takes us back to calling beginTx()
   }
 
   /// Check if the given address is on the thread's stack, and hence does not
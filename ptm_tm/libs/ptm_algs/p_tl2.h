@@ -1,8 +1,8 @@
 #pragma once
 
 #include <atomic>
-#include <setjmp.h>
 
+#include "../common/checkpoint.h"
 #include "../common/deferred.h"
 #include "../common/minivector.h"
 #include "../common/orec_t.h"
@@ -26,10 +26,12 @@
 /// - Stack Frame (to bring some of the caller frame into tx scope)
 /// - Allocator (captured memory)
 /// - Choice of single-check or double-check orecs
+/// - Statistics (per-thread counters, or nothing)
 ///
 /// Please see additional notes in the stm_algs/tl2.h file
 template <class ORECTABLE, class REDOLOG, class EPOCH, class CM,
-          class STACKFRAME, class ALLOCATOR, bool SINGLEFENCEOPT, class PMEM>
+          class STACKFRAME, class ALLOCATOR, bool SINGLEFENCEOPT, class PMEM,
+          class STATS>
 class P_TL2 {
   /// Globals is a wrapper around all of the global variables used by TL2
   struct Globals {
@@ -41,6 +43,9 @@ class P_TL2 {
 
     /// Quiescence support
     typename EPOCH::Globals epoch;
+
+    /// Statistics aggregation
+    typename STATS::Globals stats;
   };
 
   /// All metadata shared among threads
@@ -51,7 +56,7 @@ class P_TL2 {
 
   /// Checkpoint lets us reset registers and the instruction pointer in the
   /// event of an abort
-  jmp_buf *checkpoint = nullptr;
+  checkpoint_t *checkpoint = nullptr;
 
   /// For managing thread IDs, Quiescence, and Irrevocability
   EPOCH epoch;
@@ -84,6 +89,9 @@ class P_TL2 {
   /// commit.
   DeferredActionHandler deferredActions;
 
+  /// Per-thread statistics counters
+  STATS stats;
+
 public:
   /// Return the irrevocability state of the thread
   bool isIrrevoc() { return epoch.isIrrevoc(); }
@@ -91,15 +99,25 @@ public:
   /// Set the current bottom of the transactional part of the stack
   void adjustStackBottom(void *addr) { frame.setBottom(addr); }
 
+  /// Prepare the descriptor to wait in the pool when its thread exits
+  void park() {
+    epoch.park();
+    frame.reset();
+  }
+
+  /// Prepare a pooled descriptor for use by a new thread
+  void unpark() { epoch.unpark(); }
+
   /// construct a thread's transaction context by zeroing its nesting depth and
   /// giving it an ID.  We also cache its lock token.
   P_TL2()
-      : p_status(nullptr, &p_redolog, &allocator), epoch(globals.epoch), cm() {
+      : p_status(nullptr, &p_redolog, &allocator), epoch(globals.epoch), cm(),
+        stats(globals.stats, epoch.id) {
     my_lock = ORECTABLE::make_lockword(epoch.id);
   }
 
   /// Instrumentation to run at the beginning of a transaction boundary.
-  void beginTx(jmp_buf *b) {
+  void beginTx(checkpoint_t *b) {
     // onBegin == false -> flat nesting
     if (frame.onBegin()) {
       // Save the checkpoint and set the stack bottom
@@ -108,6 +126,7 @@ public:
 
       // Start logging allocations
       allocator.onBegin();
+      stats.onBegin();
 
       // Get the start time, and put it into the epoch.  epoch.onBegin will wait
       // until there are no irrevocable transactions.
@@ -133,6 +152,7 @@ public:
         }
         allocator.commitMallocs();
         epoch.clearEpoch(globals.epoch);
+        stats.onCommit(readset.size(), 0);
         readset.clear();
         cm.afterCommit(globals.cm);
         epoch.quiesce(globals.epoch, start_time);
@@ -211,6 +231,7 @@ public:
       }
 
       // clear lists.  Quiesce before freeing
+      stats.onCommit(readset.size(), lockset.size());
       p_redolog.clear();
       lockset.clear();
       readset.clear();
@@ -358,6 +379,9 @@ public:
     deferredActions.registerHandler(func, args);
   }
 
+  /// Print the statistics of all threads
+  static void reportStats() { globals.stats.report(); }
+
 private:
   /// Abort the transaction.  We must handle mallocs and frees, and we need to
   /// ensure that the TL2 object is in an appropriate state for starting a
@@ -367,6 +391,7 @@ private:
     // wait on this thread.
     epoch.clearEpoch(globals.epoch);
     cm.afterAbort(globals.cm, epoch.id);
+    stats.onAbort();
 
     // release any locks held by this thread
     for (auto o : lockset) {
@@ -382,7 +407,7 @@ private:
     allocator.onAbort(); // this reclaims all mallocs
     deferredActions.onAbort();
     frame.onAbort();
-    longjmp(*checkpoint, 1); // Takes us back to calling beginTx()
+    restore_checkpoint(checkpoint); // Takes us back to calling beginTx()
   }
 
   /// Check if the given address is on the thread's stack, and hence does not
@@ -2,9 +2,9 @@
 
 #include <atomic>
 #include <exception>
-#include <setjmp.h>
 
 #include "../common/bytelock_t.h"
+#include "../common/checkpoint.h"
 #include "../common/deferred.h"
 #include "../common/minivector.h"
 #include "../common/p_pipeline_log.h"
@@ -31,12 +31,14 @@
 /// - Pipelining of stores, so that a store does not reach memory until the next
 ///   API call.  This saves a fence for PTM.
 /// - PMEM durability domain (ADR or eADR)
+/// - Statistics (per-thread counters, or nothing)
 ///
 /// Please see the STM TLRWEager implementation for more details, particularly
 /// with regard to tuning contention management
 template <class BYTELOCKTABLE, class UNDOLOG, class EPOCH, class CM,
           class STACKFRAME, class ALLOCATOR, int READ_TRIES, int READ_SPINS,
-          int WRITE_TRIES, int WRITE_SPINS, bool PIPELINE_STORES, class PMEM>
+          int WRITE_TRIES, int WRITE_SPINS, bool PIPELINE_STORES, class PMEM,
+          class STATS>
 class P_TLRWEager {
   /// Globals is a wrapper around all of the global variables used by TLRWEager
   struct Globals {
@@ -48,6 +50,9 @@ class P_TLRWEager {
 
     /// Quiescence support
     typename EPOCH::Globals epoch;
+
+    /// Statistics aggregation
+    typename STATS::Globals stats;
   };
 
   /// All metadata shared among threads
@@ -58,7 +63,7 @@ class P_TLRWEager {
 
   /// Checkpoint lets us reset registers and the instruction pointer in the
   /// event of an abort
-  jmp_buf *checkpoint = nullptr;
+  checkpoint_t *checkpoint = nullptr;
 
   /// For managing thread Ids, Quiescence, and Irrevocability
   EPOCH epoch;
@@ -92,6 +97,9 @@ class P_TLRWEager {
   /// commit.
   DeferredActionHandler deferredActions;
 
+  /// Per-thread statistics counters
+  STATS stats;
+
 public:
   /// Return the irrevocability state of the thread
   bool isIrrevoc() { return epoch.isIrrevoc(); }
@@ -99,10 +107,20 @@ public:
   /// Set the current bottom of the transactional part of the stack
   void adjustStackBottom(void *addr) { frame.setBottom(addr); }
 
+  /// Prepare the descriptor to wait in the pool when its thread exits
+  void park() {
+    epoch.park();
+    frame.reset();
+  }
+
+  /// Prepare a pooled descriptor for use by a new thread
+  void unpark() { epoch.unpark(); }
+
   /// construct a thread's transaction context by zeroing its nesting depth and
   /// giving it an ID.  We also cache its lock token.
   P_TLRWEager()
-      : p_status(nullptr, &p_undolog, &allocator), epoch(globals.epoch), cm() {
+      : p_status(nullptr, &p_undolog, &allocator), epoch(globals.epoch), cm(),
+        stats(globals.stats, epoch.id) {
     my_slot = epoch.id;
     // crash immediately if we have an invalid bytelock
     globals.bytelocks.validate_id(my_slot);
@@ -111,7 +129,7 @@ public:
   }
 
   /// Instrumentation to run at the beginning of a transaction boundary.
-  void beginTx(jmp_buf *b) {
+  void beginTx(checkpoint_t *b) {
     // onBegin == false -> flat nesting
     if (frame.onBegin()) {
       // Save the checkpoint and set the stack bottom
@@ -120,6 +138,7 @@ public:
 
       // Start logging allocations
       allocator.onBegin();
+      stats.onBegin();
 
       // Wait until there are no irrevocable transactions.
       epoch.onBegin(globals.epoch, 1);
@@ -180,6 +199,7 @@ public:
         bl->readers[my_slot].store(0, std::memory_order_relaxed);
       }
       // clear lists
+      stats.onCommit(readset.size(), lockset.size());
       p_undolog.p_clear();
       lockset.clear();
       readset.clear();
@@ -350,6 +370,9 @@ public:
     deferredActions.registerHandler(func, args);
   }
 
+  /// Print the statistics of all threads
+  static void reportStats() { globals.stats.report(); }
+
 private:
   /// Abort the transaction. We must handle mallocs and frees, and we need to
   /// ensure that the TLRWEager object is in an appropriate state for starting a
@@ -370,6 +393,7 @@ private:
     // wait on this thread
     epoch.clearEpoch(globals.epoch);
     cm.afterAbort(globals.cm, epoch.id);
+    stats.onAbort();
 
     // Drop all read locks
     for (auto bl : readset) {
@@ -392,7 +416,7 @@ private:
     allocator.onAbort();
     deferredActions.onAbort();
     frame.onAbort();
-    longjmp(*checkpoint, 1);
+    restore_checkpoint(checkpoint);
   }
 
   /// Check if the given address is on the thread's stack, and hence does not
@@ -39,14 +39,16 @@ typedef P_RingSW<
     RING_SIZE, SSEBitFilter<RING_FILTER_SIZE, 5>,
     P_RedoLog<32, false, false, ADR>, QuiesceEpochManager<MAX_THREADS>,
     HourglassBackoffCM<ABORTS_THRESHOLD, BACKOFF_MIN, BACKOFF_MAX>,
-    OptimizedStackFrameManager, EnhancedPersistentAllocationManager<ADR>, ADR>
+    OptimizedStackFrameManager, EnhancedPersistentAllocationManager<ADR>, ADR,
+    DefaultStats>
     TxThread;
 
 /// Define TxThread::Globals.  Note that defining it this way ensures it is
 /// initialized before any threads are created.
-template <int Z, class F, class R, class E, class C, class S, class A, class P>
-typename P_RingSW<Z, F, R, E, C, S, A, P>::Globals
-    P_RingSW<Z, F, R, E, C, S, A, P>::globals;
+template <int Z, class F, class R, class E, class C, class S, class A, class P,
+          class T>
+typename P_RingSW<Z, F, R, E, C, S, A, P, T>::Globals
+    P_RingSW<Z, F, R, E, C, S, A, P, T>::globals;
 
 /// Initialize the API
 API_TM_DESCRIPTOR;
@@ -54,7 +56,7 @@ API_TM_MALLOC_FREE;
 API_TM_MEMFUNCS_GENERIC;
 API_TM_LOADFUNCS;
 API_TM_STOREFUNCS;
-API_TM_STATS_NOP;
+API_TM_STATS_REPORT;
 API_TM_EXECUTE_NOEXCEPT_PTM;
-API_TM_CLONES_THREAD_UNSAFE;
+API_TM_CLONES_CONCURRENT;
 API_TM_STACKFRAME_OPT;
@@ -40,15 +40,16 @@ typedef P_TL2<OrecTable<NUM_STRIPES, 5, CounterTimesource>,
               BasicEpochManager<MAX_THREADS>,
               HourglassBackoffCM<ABORTS_THRESHOLD, BACKOFF_MIN, BACKOFF_MAX>,
               OptimizedStackFrameManager,
-              EnhancedPersistentAllocationManager<pmem_adr>, true, pmem_adr>
+              EnhancedPersistentAllocationManager<pmem_adr>, true, pmem_adr,
+              DefaultStats>
     TxThread;
 
 /// Define TxThread::Globals.  Note that defining it this way ensures it is
 /// initialized before any threads are created.
 template <class O, class R, class E, class C, class S, class A, bool SFO,
-          class P>
-typename P_TL2<O, R, E, C, S, A, SFO, P>::Globals
-    P_TL2<O, R, E, C, S, A, SFO, P>::globals;
+          class P, class T>
+typename P_TL2<O, R, E, C, S, A, SFO, P, T>::Globals
+    P_TL2<O, R, E, C, S, A, SFO, P, T>::globals;
 
 /// Initialize the API
 API_TM_DESCRIPTOR;
@@ -56,7 +57,7 @@ API_TM_MALLOC_FREE;
 API_TM_MEMFUNCS_GENERIC;
 API_TM_LOADFUNCS;
 API_TM_STOREFUNCS;
-API_TM_STATS_NOP;
+API_TM_STATS_REPORT;
 API_TM_EXECUTE_NOEXCEPT_PTM;
-API_TM_CLONES_THREAD_UNSAFE;
+API_TM_CLONES_CONCURRENT;
 API_TM_STACKFRAME_OPT;
\ No newline at end of file
@@ -52,15 +52,15 @@ typedef P_TLRWEager<
     HourglassBackoffCM<ABORTS_THRESHOLD, BACKOFF_MIN, BACKOFF_MAX>,
     OptimizedStackFrameManager, EnhancedPersistentAllocationManager<ADR>,
     TLRW_READ_TRIES, TLRW_READ_SPINS, TLRW_WRITE_TRIES, TLRW_WRITE_SPINS, true,
-    ADR>
+    ADR, DefaultStats>
     TxThread;
 
 /// Define TxThread::Globals.  Note that defining it this way ensures it is
 /// initialized before any threads are created.
 template <class O, class U, class E, class C, class S, class A, int RT, int RS,
-          int WT, int WS, bool PS, class P>
-typename P_TLRWEager<O, U, E, C, S, A, RT, RS, WT, WS, PS, P>::Globals
-    P_TLRWEager<O, U, E, C, S, A, RT, RS, WT, WS, PS, P>::globals;
+          int WT, int WS, bool PS, class P, class T>
+typename P_TLRWEager<O, U, E, C, S, A, RT, RS, WT, WS, PS, P, T>::Globals
+    P_TLRWEager<O, U, E, C, S, A, RT, RS, WT, WS, PS, P, T>::globals;
 
 /// Initialize the API
 API_TM_DESCRIPTOR;
@@ -68,7 +68,7 @@ API_TM_MALLOC_FREE;
 API_TM_MEMFUNCS_GENERIC;
 API_TM_LOADFUNCS;
 API_TM_STOREFUNCS;
-API_TM_STATS_NOP;
+API_TM_STATS_REPORT;
 API_TM_EXECUTE_NOEXCEPT_PTM;
-API_TM_CLONES_THREAD_UNSAFE;
+API_TM_CLONES_CONCURRENT;
 API_TM_STACKFRAME_OPT;
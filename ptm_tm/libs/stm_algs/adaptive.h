@@ -0,0 +1,351 @@
+#pragma once
+
+#include <cstdio>
+
+#include "../common/checkpoint.h"
+#include "../common/pad_word.h"
+#include "../common/platform.h"
+
+/// Adaptive is a meta-algorithm that contains three TM algorithms, and switches
+/// the whole system among them at run time:
+/// - Each thread has a descriptor for every algorithm, and all transactional
+///   operations are forwarded to the descriptor of the current mode
+/// - A mode switch only happens at a quiescent point, when no thread is in a
+///   transaction.  We get that point from an EpochManager's irrevocability
+///   token: the switching thread takes the token (which waits for all threads
+///   to leave their transactions, and blocks new ones), changes the mode, and
+///   releases the token.  Since transactions in different modes never overlap,
+///   each algorithm's metadata is consistent whenever it is in use.
+/// - Threads count their commits and aborts, and periodically publish them.
+///   Every INTERVAL commits, one thread measures the system's commit
+///   throughput in the current mode, and picks the next mode.  It explores
+///   every mode once, then uses the fastest one for EXPLOIT intervals (or until
+///   its throughput drops by half), and then explores again.
+///
+/// Adaptive can be customized in the following ways:
+/// - The three algorithms (typically a low-latency one, a scalable one, and
+///   one that serializes transactions)
+/// - EpochManager (must support irrevocability, for mode switches)
+/// - INTERVAL, BATCH and EXPLOIT, to tune the switching policy
+///
+/// NB: the algorithms must have disjoint Globals, and should have their own
+///     irrevocability and quiescence, since Adaptive does not provide them.
+template <class ALG0, class ALG1, class ALG2, class EPOCH, int INTERVAL,
+          int BATCH, int EXPLOIT>
+class Adaptive {
+  /// The number of modes among which Adaptive can choose
+  static const int NUM_MODES = 3;
+
+  /// Globals is a wrapper around all of the global variables used by Adaptive
+  struct Globals {
+    /// The index of the algorithm that transactions currently use
+    pad_dword_t mode;
+
+    /// Commits published by threads during the current interval
+    pad_dword_t commits;
+
+    /// Aborts published by threads during the current interval
+    pad_dword_t aborts;
+
+    /// Mode switches, and quiescence before them
+    typename EPOCH::Globals epoch;
+
+    /// The time when the current interval started
+    uint64_t interval_start;
+
+    /// The commit throughput most recently measured for each mode
+    double score[NUM_MODES];
+
+    /// The fraction of transactions that aborted, most recently measured for
+    /// each mode
+    double abort_rate[NUM_MODES];
+
+    /// The modes that have not been measured in this round of exploration
+    int unexplored;
+
+    /// The number of intervals to keep using the best mode before exploring
+    int exploit_left;
+
+    /// The number of intervals during which each mode was in use
+    uint64_t intervals[NUM_MODES];
+
+    /// The number of mode switches
+    uint64_t switches;
+
+    /// Construct Adaptive::Globals by starting in mode 0, and exploring
+    Globals() {
+      mode.val = 0;
+      interval_start = getElapsedTime();
+      unexplored = (1 << NUM_MODES) - 1;
+      exploit_left = 0;
+      switches = 0;
+      for (int i = 0; i < NUM_MODES; ++i) {
+        score[i] = 0;
+        abort_rate[i] = 0;
+        intervals[i] = 0;
+      }
+    }
+  };
+
+  /// All metadata shared among threads
+  static Globals globals;
+
+  /// For managing thread IDs and mode switches
+  EPOCH epoch;
+
+  /// The descriptors for each of the algorithms
+  ALG0 alg0;
+  ALG1 alg1;
+  ALG2 alg2;
+
+  /// The mode of the current transaction
+  int mode = 0;
+
+  /// The nesting depth of the current transaction
+  int depth = 0;
+
+  /// The checkpoint of the outermost transaction, so that we can tell a
+  /// restart after abort from the beginning of a nested transaction
+  checkpoint_t *checkpoint = nullptr;
+
+  /// Commits that have not been published yet
+  uint64_t local_commits = 0;
+
+  /// Aborts that have not been published yet
+  uint64_t local_aborts = 0;
+
+  /// Run a function on the descriptor of the current mode
+  template <class F> auto dispatch(F f) {
+    switch (mode) {
+    case 0:
+      return f(alg0);
+    case 1:
+      return f(alg1);
+    default:
+      return f(alg2);
+    }
+  }
+
+  /// Begin a transaction in an algorithm that can abort
+  template <class A>
+  static auto beginIn(A &a, checkpoint_t *b) -> decltype(a.beginTx(b)) {
+    a.beginTx(b);
+  }
+
+  /// Begin a transaction in an algorithm that never aborts (e.g., CGL)
+  template <class A>
+  static auto beginIn(A &a, checkpoint_t *) -> decltype(a.beginTx()) {
+    a.beginTx();
+  }
+
+  /// Report the statistics of an algorithm that keeps them
+  template <class A>
+  static auto reportIn(int) -> decltype(A::reportStats()) {
+    A::reportStats();
+  }
+
+  /// Algorithms without statistics have nothing to report
+  template <class A> static void reportIn(long) {}
+
+public:
+  /// Return the irrevocability state of the thread
+  bool isIrrevoc() {
+    return dispatch([&](auto &a) { return a.isIrrevoc(); });
+  }
+
+  /// Set the current bottom of the transactional part of the stack.  Every
+  /// algorithm gets the new bottom, since it may be set outside of a
+  /// transaction.
+  void adjustStackBottom(void *addr) {
+    alg0.adjustStackBottom(addr);
+    alg1.adjustStackBottom(addr);
+    alg2.adjustStackBottom(addr);
+  }
+
+  /// Prepare the descriptor, and those of the algorithms, to wait in the pool
+  /// when the thread exits
+  void park() {
+    epoch.park();
+    alg0.park();
+    alg1.park();
+    alg2.park();
+    depth = 0;
+  }
+
+  /// Prepare a pooled descriptor, and those of the algorithms, for use by a
+  /// new thread
+  void unpark() {
+    epoch.unpark();
+    alg0.unpark();
+    alg1.unpark();
+    alg2.unpark();
+  }
+
+  /// construct a thread's transaction context by giving it an ID.  The
+  /// algorithms' descriptors are constructed (and registered) here too.
+  Adaptive() : epoch(globals.epoch) {}
+
+  /// Instrumentation to run at the beginning of a transaction boundary.
+  void beginTx(checkpoint_t *b) {
+    // A nested transaction runs in the mode of its parent
+    if (depth > 0 && b != checkpoint) {
+      ++depth;
+      dispatch([&](auto &a) { beginIn(a, b); });
+      return;
+    }
+    // If we are restarting after an abort, count it, and leave the epoch so
+    // that a mode switch can happen before we retry
+    if (depth > 0) {
+      ++local_aborts;
+      epoch.clearEpoch(globals.epoch);
+    }
+    depth = 1;
+    checkpoint = b;
+
+    // Wait until no mode switch is in progress, then pick up the mode.  It
+    // cannot change until we leave the epoch.
+    epoch.onBegin(globals.epoch, 0);
+    mode = globals.mode.val;
+    dispatch([&](auto &a) { beginIn(a, b); });
+  }
+
+  /// Instrumentation to run at the end of a transaction boundary.
+  void commitTx() {
+    // NB: the algorithm may abort during commit, so depth must not change
+    //     until it returns
+    dispatch([&](auto &a) { a.commitTx(); });
+    if (--depth > 0) {
+      return;
+    }
+    epoch.clearEpoch(globals.epoch);
+
+    // Publish counts in batches, to avoid contention on the counters
+    if (++local_commits < BATCH) {
+      return;
+    }
+    globals.aborts.val += local_aborts;
+    uint64_t total = (globals.commits.val += local_commits);
+    local_commits = 0;
+    local_aborts = 0;
+    if (total >= INTERVAL) {
+      adapt();
+    }
+  }
+
+  /// To allocate memory, we must also log it, so we can reclaim it if the
+  /// transaction aborts
+  void *txAlloc(size_t size) {
+    return dispatch([&](auto &a) { return a.txAlloc(size); });
+  }
+
+  /// To allocate aligned memory, we must also log it, so we can reclaim it if
+  /// the transaction aborts
+  void *txAAlloc(size_t A, size_t size) {
+    return dispatch([&](auto &a) { return a.txAAlloc(A, size); });
+  }
+
+  /// To free memory, we simply wait until the transaction has committed, and
+  /// then we free.
+  void txFree(void *addr) {
+    dispatch([&](auto &a) { a.txFree(addr); });
+  }
+
+  /// Transactional read
+  template <typename T> T read(T *addr) {
+    return dispatch([&](auto &a) { return a.read(addr); });
+  }
+
+  /// Transactional write
+  template <typename T> void write(T *addr, T val) {
+    dispatch([&](auto &a) { a.write(addr, val); });
+  }
+
+  /// Instrumentation to become irrevocable in-flight
+  void becomeIrrevocable() {
+    dispatch([&](auto &a) { a.becomeIrrevocable(); });
+  }
+
+  /// Register an action to run after transaction commit
+  void registerCommitHandler(void (*func)(void *), void *args) {
+    dispatch([&](auto &a) { a.registerCommitHandler(func, args); });
+  }
+
+  /// Print the mode switching history, and the statistics of all algorithms
+  static void reportStats() {
+    printf("[TM STATS] adaptive mode switches: %lu\n", globals.switches);
+    for (int i = 0; i < NUM_MODES; ++i) {
+      printf("[TM STATS] adaptive mode %d: %lu intervals, %.0f commits/s, "
+             "%.2f%% aborts\n",
+             i, globals.intervals[i], globals.score[i],
+             100 * globals.abort_rate[i]);
+    }
+    reportIn<ALG0>(0);
+    reportIn<ALG1>(0);
+    reportIn<ALG2>(0);
+  }
+
+private:
+  /// At the end of an interval, measure the throughput of the current mode,
+  /// and switch to another mode if the policy says so.  This must be called
+  /// outside of a transaction.
+  void adapt() {
+    // Take the token, which waits for all transactions to finish.  If another
+    // thread has it, then that thread is already adapting.
+    if (!epoch.tryIrrevoc(globals.epoch)) {
+      return;
+    }
+    // Another thread may have finished the interval while we waited
+    uint64_t commits = globals.commits.val;
+    if (commits < INTERVAL) {
+      epoch.onCommitIrrevoc(globals.epoch);
+      return;
+    }
+
+    // Measure the throughput of the current mode
+    int curr = globals.mode.val;
+    uint64_t now = getElapsedTime();
+    uint64_t elapsed = now - globals.interval_start;
+    double rate = elapsed ? (1e9 * commits) / elapsed : 0;
+    double prev = globals.score[curr];
+    globals.score[curr] = rate;
+    globals.abort_rate[curr] =
+        (double)globals.aborts.val / (commits + globals.aborts.val);
+    ++globals.intervals[curr];
+
+    // Pick the next mode: explore the modes we have not measured yet, then
+    // exploit the best one until its time is up or it degrades
+    int next = curr;
+    globals.unexplored &= ~(1 << curr);
+    if (globals.unexplored == 0 && globals.exploit_left == 0) {
+      for (int i = 0; i < NUM_MODES; ++i) {
+        if (globals.score[i] > globals.score[next]) {
+          next = i;
+        }
+      }
+      globals.exploit_left = EXPLOIT;
+    } else if (globals.unexplored == 0) {
+      if (--globals.exploit_left == 0 || rate < prev / 2) {
+        globals.exploit_left = 0;
+        globals.unexplored = ((1 << NUM_MODES) - 1) & ~(1 << curr);
+      }
+    }
+    if (globals.unexplored != 0 && globals.exploit_left == 0) {
+      for (int i = 0; i < NUM_MODES; ++i) {
+        if (globals.unexplored & (1 << i)) {
+          next = i;
+          break;
+        }
+      }
+    }
+    if (next != curr) {
+      ++globals.switches;
+      globals.mode.val = next;
+    }
+
+    // Start a new interval, and let transactions run again
+    globals.commits.val = 0;
+    globals.aborts.val = 0;
+    globals.interval_start = getElapsedTime();
+    epoch.onCommitIrrevoc(globals.epoch);
+  }
+};
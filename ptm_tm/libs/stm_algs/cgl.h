@@ -43,6 +43,12 @@ public:
   /// Set the current bottom of the transactional part of the stack
   void adjustStackBottom(void *) {}
 
+  /// Prepare the descriptor to wait in the pool when its thread exits
+  void park() { frame.reset(); }
+
+  /// Prepare a pooled descriptor for use by a new thread
+  void unpark() {}
+
   /// construct a thread's transaction context by zeroing its nesting depth
   CGL() {}
 
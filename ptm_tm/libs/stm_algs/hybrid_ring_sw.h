@@ -1,9 +1,9 @@
 #pragma once
 
 #include <atomic>
-#include <setjmp.h>
 #include <x86intrin.h>
 
+#include "../common/checkpoint.h"
 #include "../common/deferred.h"
 #include "../common/pad_word.h"
 #include "../common/platform.h"
@@ -73,7 +73,7 @@ class HybridRingSW {
 
   /// Checkpoint lets us reset registers and the instruction pointer in the
   /// event of an abort
-  jmp_buf *checkpoint;
+  checkpoint_t *checkpoint;
 
   /// For managing thread IDs, Quiescence, and Irrevocability
   EPOCH epoch;
@@ -116,6 +116,15 @@ public:
   /// Set the current bottom of the transactional part of the stack
   void adjustStackBottom(void *addr) { frame.setBottom(addr); }
 
+  /// Prepare the descriptor to wait in the pool when its thread exits
+  void park() {
+    epoch.park();
+    frame.reset();
+  }
+
+  /// Prepare a pooled descriptor for use by a new thread
+  void unpark() { epoch.unpark(); }
+
   /// Construct a thread's transaction context by zeroing its nesting depth and
   /// giving it an ID
   HybridRingSW() : epoch(globals.epoch), cm(), instrumented_htm_path(false),
@@ -222,7 +231,7 @@ private:
 
 public:
   /// Instrumentation to run at the beginning of an STM transaction.
-  void beginSTM(jmp_buf *b) {
+  void beginSTM(checkpoint_t *b) {
     if (instrumented_htm_path || uninstrumented_htm_path)
       return;
 
@@ -590,7 +599,7 @@ private:
     allocator.onAbort(); // This reclaims all mallocs
     deferredActions.onAbort();
     frame.onAbort();
-    longjmp(*checkpoint, 1); // Takes us back to calling beginTx()
+    restore_checkpoint(checkpoint); // Takes us back to calling beginTx()
   }
 
   /// Check if the given address is on the thread's stack, and hence does not
@@ -1,8 +1,8 @@
 #pragma once
 
 #include <atomic>
-#include <setjmp.h>
 
+#include "../common/checkpoint.h"
 #include "../common/deferred.h"
 #include "../common/pad_word.h"
 #include "../common/platform.h"
@@ -19,6 +19,7 @@
 /// - Contention manager
 /// - Stack Frame (to bring some of the caller frame into tx scope)
 /// - Allocator (to become irrevocable on too many allocations)
+/// - Statistics (per-thread counters, or nothing)
 ///
 /// Note that it is possible to produce an incorrect STM.  For example, no
 /// irrevocability + irrevocable CM can lead to transactions spinning forever.
@@ -26,7 +27,7 @@
 /// safety, but does require Quiescence if it uses an allocator that can return
 /// memory to the operating system.
 template <class REDOLOG, class VALUELOG, class EPOCH, class CM,
-          class STACKFRAME, class ALLOCATOR>
+          class STACKFRAME, class ALLOCATOR, class STATS>
 class NOrec {
   /// Globals is a wrapper around all of the global variables used by NOrec
   struct Globals {
@@ -38,6 +39,9 @@ class NOrec {
 
     /// Quiescence support
     typename EPOCH::Globals epoch;
+
+    /// Statistics aggregation
+    typename STATS::Globals stats;
   };
 
   /// All metadata shared among threads
@@ -45,7 +49,7 @@ class NOrec {
 
   /// Checkpoint lets us reset registers and the instruction pointer in the
   /// event of an abort
-  jmp_buf *checkpoint;
+  checkpoint_t *checkpoint;
 
   /// For managing thread IDs, Quiescence, and Irrevocability
   EPOCH epoch;
@@ -62,6 +66,23 @@ class NOrec {
   // a redolog, since this is a lazy TM
   REDOLOG redolog;
 
+  /// True when the transaction began read-only, in which case it has no redo
+  /// log to search, and a write upgrades it to a writer and restarts it
+  bool read_only = false;
+
+  /// The number of upcoming read-only transactions that run as writers.  When
+  /// a read-only transaction upgrades, the next RW_FALLBACK transactions that
+  /// begin read-only (starting with the restart) run as writers, so that a call
+  /// site that was wrongly launched as read-only pays for one restart every
+  /// RW_FALLBACK executions, rather than every time.  beginTx() does not know
+  /// the call site, so the fallback is per thread: read-only call sites that
+  /// run in the window merely lose the read-only fast path.
+  int rw_fallback = 0;
+
+  /// The length of the window in which read-only transactions run as writers
+  /// after an upgrade
+  static const int RW_FALLBACK = 64;
+
   /// A read set for this transaction
   VALUELOG valuelog;
 
@@ -72,6 +93,9 @@ class NOrec {
   /// commit.
   DeferredActionHandler deferredActions;
 
+  /// Per-thread statistics counters
+  STATS stats;
+
 public:
   /// Return the irrevocability state of the thread
   bool isIrrevoc() { return epoch.isIrrevoc(); }
@@ -79,20 +103,36 @@ public:
   /// Set the current bottom of the transactional part of the stack
   void adjustStackBottom(void *addr) { frame.setBottom(addr); }
 
+  /// Prepare the descriptor to wait in the pool when its thread exits
+  void park() {
+    epoch.park();
+    frame.reset();
+  }
+
+  /// Prepare a pooled descriptor for use by a new thread
+  void unpark() { epoch.unpark(); }
+
   /// construct a thread's transaction context by zeroing its nesting depth and
   /// giving it an ID.
-  NOrec() : epoch(globals.epoch), cm() {}
+  NOrec() : epoch(globals.epoch), cm(), stats(globals.stats, epoch.id) {}
 
-  /// Instrumentation to run at the beginning of a transaction boundary.
-  void beginTx(jmp_buf *b) {
+  /// Instrumentation to run at the beginning of a transaction boundary.  A
+  /// read-only transaction runs as a writer if a recent read-only transaction
+  /// had to upgrade.
+  void beginTx(checkpoint_t *b, bool ro = false) {
     // onBegin == false -> flat nesting
     if (frame.onBegin()) {
       // Save the checkpoint and set the stack bottom
       checkpoint = b;
       frame.setBottom(b);
+      read_only = ro && rw_fallback == 0;
+      if (ro && rw_fallback > 0) {
+        --rw_fallback;
+      }
 
       // Start logging allocations
       allocator.onBegin();
+      stats.onBegin();
 
       // Get the start time, and put it into the epoch.  epoch.onBegin will wait
       // until there are no irrevocable transactions.
@@ -120,6 +160,7 @@ public:
       if (epoch.isIrrevoc()) {
         epoch.onCommitIrrevoc(globals.epoch);
         cm.afterCommit(globals.cm);
+        stats.onCommitIrrevoc();
         deferredActions.onCommit();
         frame.onCommit();
         return;
@@ -127,6 +168,7 @@ public:
       // fast-path for read-only transactions must still quiesce before freeing
       if (redolog.isEmpty()) {
         epoch.clearEpoch(globals.epoch);
+        stats.onCommit(valuelog.size(), 0);
         valuelog.clear();
         cm.afterCommit(globals.cm);
         epoch.quiesce(globals.epoch, lock_snapshot);
@@ -153,6 +195,7 @@ public:
 
       // clear lists.  Quiesce before freeing, noting that we need threads to be
       // > lock_snapshot
+      stats.onCommit(valuelog.size(), redolog.size());
       redolog.reset();
       valuelog.clear();
       cm.afterCommit(globals.cm);
@@ -189,7 +232,7 @@ public:
     // Lookup in redo log to populate ret.  Note that prior casting can lead to
     // ret having only some bytes properly set
     T ret;
-    int found_mask = redolog.find(ptr, ret);
+    int found_mask = read_only ? 0 : redolog.find(ptr, ret);
     // If we found all the bytes in the redo log, then it's easy
     int desired_mask = (1UL << sizeof(T)) - 1;
     if (desired_mask == found_mask) {
@@ -222,6 +265,9 @@ public:
     if (accessDirectly(ptr)) {
       *ptr = val;
     } else {
+      if (read_only) {
+        upgrade();
+      }
       redolog.insert(ptr, val);
     }
   }
@@ -247,6 +293,7 @@ public:
 
     // replay redo log
     redolog.writeback_nonatomic();
+    stats.onIrrevoc();
 
     // clear lists
     allocator.onCommit();
@@ -259,6 +306,9 @@ public:
     deferredActions.registerHandler(func, args);
   }
 
+  /// Print the statistics of all threads
+  static void reportStats() { globals.stats.report(); }
+
 private:
   /// Validation.  We need to make sure the lock is even and does not change
   /// while we check values
@@ -287,14 +337,30 @@ private:
     // wait on this thread.
     epoch.clearEpoch(globals.epoch);
     cm.afterAbort(globals.cm, epoch.id);
+    stats.onAbort();
+    rollback();
+  }
+
+  /// A read-only transaction tried to write: restart it as a writer.  This is
+  /// not a conflict, so unlike abortTx(), it does not notify the contention
+  /// manager (which would back off), and it is counted as an upgrade rather
+  /// than as an abort.
+  void upgrade() {
+    rw_fallback = RW_FALLBACK;
+    epoch.clearEpoch(globals.epoch);
+    stats.onUpgrade();
+    rollback();
+  }
 
+  /// Undo the effects of the current attempt, and go back to beginTx()
+  void rollback() {
     // reset all lists
     redolog.reset();
     valuelog.clear();
     allocator.onAbort(); // this reclaims all mallocs
     deferredActions.onAbort();
     frame.onAbort();
-    longjmp(*checkpoint, 1); // Takes us back to calling beginTx()
+    restore_checkpoint(checkpoint); // Takes us back to calling beginTx()
   }
 
   /// Check if the given address is on the thread's stack, and hence does not
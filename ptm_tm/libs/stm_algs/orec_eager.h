@@ -1,13 +1,14 @@
 #pragma once
 
 #include <atomic>
-#include <setjmp.h>
 
+#include "../common/checkpoint.h"
 #include "../common/deferred.h"
 #include "../common/minivector.h"
 #include "../common/orec_t.h"
 #include "../common/pad_word.h"
 #include "../common/platform.h"
+#include "../common/stats.h"
 
 /// OrecEager is an STM algorithm with the following characteristics:
 /// - Uses orecs for encounter-time write locking, optimistic read locking
@@ -20,13 +21,14 @@
 /// - Contention manager
 /// - Stack Frame (to bring some of the caller frame into tx scope)
 /// - Allocator (to become irrevocable on too many allocations)
+/// - Statistics (per-thread counters, or nothing)
 ///
 /// By using Irrevocability, Quiescence, and a CM with Exponential backoff +
 /// Irrevocability, it is possible to generate an STM that is equivalent to the
 /// "ml_wt" algorithm in GCC, except for the lack of read-for-write
 /// optimizations.
 template <class ORECTABLE, class UNDOLOG, class EPOCH, class CM,
-          class STACKFRAME, class ALLOCATOR>
+          class STACKFRAME, class ALLOCATOR, class STATS>
 class OrecEager {
   /// Globals is a wrapper around all of the global variables used by OrecEager
   struct Globals {
@@ -38,6 +40,9 @@ class OrecEager {
 
     /// Quiescence support
     typename EPOCH::Globals epoch;
+
+    /// Statistics aggregation
+    typename STATS::Globals stats;
   };
 
   /// All metadata shared among threads
@@ -45,7 +50,7 @@ class OrecEager {
 
   /// Checkpoint lets us reset registers and the instruction pointer in the
   /// event of an abort
-  jmp_buf *checkpoint = nullptr;
+  checkpoint_t *checkpoint = nullptr;
 
   /// For managing thread Ids, Quiescence, and Irrevocability
   EPOCH epoch;
@@ -78,6 +83,9 @@ class OrecEager {
   /// commit.
   DeferredActionHandler deferredActions;
 
+  /// Per-thread statistics counters
+  STATS stats;
+
 public:
   /// Return the irrevocability state of the thread
   bool isIrrevoc() { return epoch.isIrrevoc(); }
@@ -85,13 +93,22 @@ public:
   /// Set the current bottom of the transactional part of the stack
   void adjustStackBottom(void *addr) { frame.setBottom(addr); }
 
+  /// Prepare the descriptor to wait in the pool when its thread exits
+  void park() {
+    epoch.park();
+    frame.reset();
+  }
+
+  /// Prepare a pooled descriptor for use by a new thread
+  void unpark() { epoch.unpark(); }
+
   /// construct a thread's transaction context
-  OrecEager() : epoch(globals.epoch), cm() {
+  OrecEager() : epoch(globals.epoch), cm(), stats(globals.stats, epoch.id) {
     my_lock = ORECTABLE::make_lockword(epoch.id);
   }
 
   /// Instrumentation to run at the beginning of a transaction boundary.
-  void beginTx(jmp_buf *b) {
+  void beginTx(checkpoint_t *b) {
     // onBegin == false -> flat nesting
     if (frame.onBegin()) {
       // Save the checkpoint and set the stack bottom
@@ -100,6 +117,7 @@ public:
 
       // Start logging allocations
       allocator.onBegin();
+      stats.onBegin();
 
       // Get the start time, and put it into the epoch.  epoch.onBegin will wait
       // until there are no irrevocable transactions.
@@ -122,6 +140,7 @@ public:
       if (epoch.isIrrevoc()) {
         epoch.onCommitIrrevoc(globals.epoch);
         cm.afterCommit(globals.cm);
+        stats.onCommitIrrevoc();
         deferredActions.onCommit();
         frame.onCommit();
         return;
@@ -129,6 +148,7 @@ public:
       // fast-path for read-only transactions must still quiesce before freeing
       if (lockset.empty()) {
         epoch.clearEpoch(globals.epoch);
+        stats.onCommit(readset.size(), 0);
         readset.clear();
         cm.afterCommit(globals.cm);
         epoch.quiesce(globals.epoch, start_time);
@@ -148,7 +168,7 @@ public:
         for (auto o : readset) {
           uint64_t v = o->curr;
           if (v > start_time && v != my_lock) {
-            abortTx();
+            abortTx(ABORT_VALIDATION, o);
           }
         }
       }
@@ -161,6 +181,7 @@ public:
       }
 
       // clear lists.  Quiesce before freeing
+      stats.onCommit(readset.size(), lockset.size());
       undolog.clear();
       lockset.clear();
       readset.clear();
@@ -214,7 +235,7 @@ public:
 
       // abort if locked
       if (post.fields.lock) {
-        abortTx();
+        abortTx(ABORT_LOCKED, o);
       }
 
       // validate and then update start time, because orec is unlocked but too
@@ -243,7 +264,7 @@ public:
       // If lock unheld and not too new, acquire; abort on fail to acquire
       if (pre.all <= start_time) {
         if (!o->curr.compare_exchange_strong(pre.all, my_lock)) {
-          abortTx();
+          abortTx(ABORT_LOCK_CAS, o);
         }
         lockset.push_back(o);
         o->prev = pre.all; // for easy undo on abort... Cf. incarnation numbers
@@ -255,7 +276,7 @@ public:
 
       // If lock held by other, abort
       else if (pre.fields.lock) {
-        abortTx();
+        abortTx(ABORT_LOCKED, o);
       }
 
       // Lock unheld, but too new... validate and then go to top
@@ -286,7 +307,7 @@ public:
 
     // try_irrevoc will return true only if we got the token and quiesced
     if (!epoch.tryIrrevoc(globals.epoch)) {
-      abortTx();
+      abortTx(ABORT_IRREVOC);
     }
 
     // now validate.  If it fails, release irrevocability so other transactions
@@ -298,7 +319,7 @@ public:
         epoch.onCommitIrrevoc(globals.epoch);
         // NB: this specific abort *could* use nonatomic undo logging, but we'll
         //     just use the existing undo logging
-        abortTx();
+        abortTx(ABORT_VALIDATION, o);
       }
     }
 
@@ -307,6 +328,8 @@ public:
     for (auto o : lockset) {
       o->curr = end_time;
     }
+    stats.onIrrevoc();
+
     // clear lists
     allocator.onCommit();
     readset.clear();
@@ -319,6 +342,9 @@ public:
     deferredActions.registerHandler(func, args);
   }
 
+  /// Print the statistics of all threads
+  static void reportStats() { globals.stats.report(); }
+
 private:
   /// Validation.  We need to make sure that all orecs that we've read
   /// have timestamps older than our start time, unless we locked those orecs.
@@ -330,7 +356,7 @@ private:
       local_orec_t lo;
       lo.all = o->curr;
       if (lo.all > start_time && lo.all != my_lock) {
-        abortTx();
+        abortTx(ABORT_VALIDATION, o);
       }
     }
   }
@@ -338,7 +364,10 @@ private:
   /// Abort the transaction. We must handle mallocs and frees, and we need to
   /// ensure that the OrecEager object is in an appropriate state for starting a
   /// new transaction.  Note that we *will* call beginTx again, unlike libITM.
-  void abortTx() {
+  ///
+  /// The cause of the abort, and the orec that caused it, are reported to the
+  /// StatsManager.
+  void abortTx(abort_cause_t cause, orec_t *o = nullptr) {
     // undo any writes
     undolog.undo_writes_atomic();
 
@@ -346,6 +375,7 @@ private:
     // wait on this thread
     epoch.clearEpoch(globals.epoch);
     cm.afterAbort(globals.cm, epoch.id);
+    stats.onAbort(cause, o ? globals.orecs.index_of(o) : NO_OREC);
 
     // release the locks and bump version numbers by one... track the highest
     // version number we write, in case it is greater than timestamp.val
@@ -369,7 +399,7 @@ private:
     allocator.onAbort(); // this reclaims all mallocs
     deferredActions.onAbort();
     frame.onAbort();
-    longjmp(*checkpoint, 1); // Takes us back to calling beginTx()
+    restore_checkpoint(checkpoint); // Takes us back to calling beginTx()
   }
 
   /// Check if the given address is on the thread's stack, and hence does not
@@ -33,13 +33,14 @@
 typedef NOrec<RedoLog_Nonatomic<32>, ValueLog_Nonatomic,
               IrrevocQuiesceEpochManager<MAX_THREADS>, NoopCM,
               OptimizedStackFrameManager,
-              BoundedAllocationManager<MALLOC_THRESHOLD, true>>
+              BoundedAllocationManager<MALLOC_THRESHOLD, true>, DefaultStats>
     TxThread;
 
 /// Define TxThread::Globals.  Note that defining it this way ensures it is
 /// initialized before any threads are created.
-template <class R, class V, class E, class C, class S, class A>
-typename NOrec<R, V, E, C, S, A>::Globals NOrec<R, V, E, C, S, A>::globals;
+template <class R, class V, class E, class C, class S, class A, class T>
+typename NOrec<R, V, E, C, S, A, T>::Globals
+    NOrec<R, V, E, C, S, A, T>::globals;
 
 /// Initialize the API
 API_TM_DESCRIPTOR;
@@ -47,7 +48,7 @@ API_TM_MALLOC_FREE;
 API_TM_MEMFUNCS_GENERIC;
 API_TM_LOADFUNCS;
 API_TM_STOREFUNCS;
-API_TM_STATS_NOP;
+API_TM_STATS_REPORT;
 API_TM_EXECUTE_NOEXCEPT;
-API_TM_CLONES_THREAD_UNSAFE;
+API_TM_CLONES_CONCURRENT;
 API_TM_STACKFRAME_OPT;
\ No newline at end of file
@@ -1,5 +1,6 @@
 /// Instantiate the OrecEager algorithm with the following configuration:
-/// - An orec table with 2^20 entries and a coverage of 16 bytes
+/// - A huge-page orec table with 2^20 entries (by default, see
+///   DynamicOrecTable) and a coverage of 16 bytes
 /// - Irrevocability and Quiescence
 /// - Hourglass contention management, since we don't have irrevocability
 /// - Support for dynamic stack frame optimizations
@@ -29,17 +30,20 @@
 
 /// TxThread is a shorthand for the instantiated version of the TM algorithm, so
 /// that we can use common macros to define the API:
-typedef OrecEager<OrecTable<NUM_STRIPES, OREC_COVERAGE, CounterTimesource>, UndoLog_Atomic,
-                  IrrevocQuiesceEpochManager<MAX_THREADS>,
-                  HourglassCM<ABORTS_THRESHOLD>, OptimizedStackFrameManager,
-                  BoundedAllocationManager<MALLOC_THRESHOLD, true>>
+typedef OrecEager<
+    DynamicOrecTable<NUM_STRIPES, OREC_COVERAGE, CounterTimesource>,
+    UndoLog_Atomic,
+    IrrevocQuiesceEpochManager<MAX_THREADS>,
+    HourglassCM<ABORTS_THRESHOLD>, OptimizedStackFrameManager,
+    BoundedAllocationManager<MALLOC_THRESHOLD, true>,
+    DefaultStats>
     TxThread;
 
 /// Define TxThread::Globals.  Note that defining it this way ensures it is
 /// initialized before any threads are created.
-template <class O, class U, class E, class C, class S, class A>
-typename OrecEager<O, U, E, C, S, A>::Globals
-    OrecEager<O, U, E, C, S, A>::globals;
+template <class O, class U, class E, class C, class S, class A, class T>
+typename OrecEager<O, U, E, C, S, A, T>::Globals
+    OrecEager<O, U, E, C, S, A, T>::globals;
 
 /// Initialize the API
 API_TM_DESCRIPTOR;
@@ -47,7 +51,7 @@ API_TM_MALLOC_FREE;
 API_TM_MEMFUNCS_GENERIC;
 API_TM_LOADFUNCS;
 API_TM_STOREFUNCS;
-API_TM_STATS_NOP;
+API_TM_STATS_REPORT;
 API_TM_EXECUTE_NOEXCEPT;
-API_TM_CLONES_THREAD_UNSAFE;
+API_TM_CLONES_CONCURRENT;
 API_TM_STACKFRAME_OPT;
@@ -51,5 +51,5 @@ API_TM_LOADFUNCS;
 API_TM_STOREFUNCS;
 API_TM_STATS_NOP;
 API_TM_EXECUTE_HYBRID;
-API_TM_CLONES_THREAD_UNSAFE;
+API_TM_CLONES_CONCURRENT;
 API_TM_STACKFRAME_OPT;
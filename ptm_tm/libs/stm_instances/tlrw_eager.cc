@@ -42,15 +42,15 @@ typedef TLRWEager<
     IrrevocEpochManager<MAX_THREADS>, IrrevocCM<ABORTS_THRESHOLD>,
     OptimizedStackFrameManager,
     BoundedAllocationManager<MALLOC_THRESHOLD, true>, TLRW_READ_TRIES,
-    TLRW_READ_SPINS, TLRW_WRITE_TRIES, TLRW_WRITE_SPINS>
+    TLRW_READ_SPINS, TLRW_WRITE_TRIES, TLRW_WRITE_SPINS, DefaultStats>
     TxThread;
 
 /// Define TxThread::Globals.  Note that defining it this way ensures it is
 /// initialized before any threads are created.
 template <class O, class E, class C, class S, class A, int RT, int RS, int WT,
-          int WS>
-typename TLRWEager<O, E, C, S, A, RT, RS, WT, WS>::Globals
-    TLRWEager<O, E, C, S, A, RT, RS, WT, WS>::globals;
+          int WS, class T>
+typename TLRWEager<O, E, C, S, A, RT, RS, WT, WS, T>::Globals
+    TLRWEager<O, E, C, S, A, RT, RS, WT, WS, T>::globals;
 
 /// Initialize the API
 API_TM_DESCRIPTOR;
@@ -58,7 +58,7 @@ API_TM_MALLOC_FREE;
 API_TM_MEMFUNCS_GENERIC;
 API_TM_LOADFUNCS;
 API_TM_STOREFUNCS;
-API_TM_STATS_NOP;
+API_TM_STATS_REPORT;
 API_TM_EXECUTE_NOEXCEPT;
-API_TM_CLONES_THREAD_UNSAFE;
+API_TM_CLONES_CONCURRENT;
 API_TM_STACKFRAME_OPT;
\ No newline at end of file
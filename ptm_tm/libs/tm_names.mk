@@ -17,7 +17,20 @@ STM_NAMES = cgl_mutex cohorts htm_gl tlrw_eager                           \
             tl2_quiescence_safe           tl2_quiescence_unsafe           \
             tml_eager_safe                tml_eager_unsafe                \
             tml_lazy_safe                 tml_lazy_unsafe                 \
-            rdtscp_lazy
+            rdtscp_lazy                   adaptive                        \
+            hierarchical_lazy                                             \
+            orec_lazy_sharedclock_quiescence_safe                         \
+            orec_lazy_socketclock_quiescence_safe                         \
+            tlrw_eager_unbounded                                          \
+            orec_mvcc_quiescence_safe     orec_mvcc_quiescence_unsafe     \
+            orec_swiss_quiescence_safe    orec_swiss_quiescence_unsafe    \
+            tl2_tsext_quiescence_safe                                     \
+            ring_sw_wide_safe             ring_sw_wide_unsafe             \
+            ring_mw_wide_safe             ring_mw_wide_unsafe             \
+            orec_lazy_slab_quiescence_safe                                \
+            tl2_slab_quiescence_safe      norec_slab_quiescence_safe      \
+            orec_lazy_filtered_quiescence_safe                            \
+            tl2_filtered_quiescence_safe
 
 # For the PTM algorithms, we are currently investigating different levels of
 # dynamic optimization, which depend on what guarantees the program can
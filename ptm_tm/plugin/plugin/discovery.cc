@@ -1,6 +1,8 @@
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 
@@ -43,27 +45,43 @@ void tm_plugin::attach_annotations_to_functions(Module &M) {
 /// TM_RENAME annotations, and put them in the work list
 void tm_plugin::discover_annotated_funcs(Module &M) {
   // Before iterating through functions, see if there are any instances of
-  // TM_EXECUTE, TM_EXECUTE_C, or TM_EXECUTE_C_INTERNAL.  If so, add them to the
-  // pure list.  Also do _ZNSt14_Function_baseD2Ev, so that nested lambdas don't
-  // serialize
+  // TM_EXECUTE, TM_EXECUTE_FN, TM_EXECUTE_C, or TM_EXECUTE_C_INTERNAL, or of
+  // their read-only versions.  If so, add them to the pure list.  Also do
+  // _ZNSt14_Function_baseD2Ev, so that nested lambdas don't serialize
   //
   // To support nesting in the RAII API, TM_BEGIN_CFG and TM_COMMIT_CFG must be
-  // safe.  An unfortunate side effect is that we have to mark setjmp safe
+  // safe.  An unfortunate side effect is that we have to mark the checkpoint
+  // (and setjmp, which older RAII code used instead) safe
   if (Function *f = M.getFunction(TM_EXECUTE_STR)) {
     purelist.push_back(dyn_cast<Function>(f));
   }
+  if (Function *f = M.getFunction(TM_EXECUTE_FN_STR)) {
+    purelist.push_back(dyn_cast<Function>(f));
+  }
   if (Function *f = M.getFunction(TM_EXECUTE_C_STR)) {
     purelist.push_back(dyn_cast<Function>(f));
   }
   if (Function *f = M.getFunction(TM_EXECUTE_C_INTERNAL_STR)) {
     purelist.push_back(dyn_cast<Function>(f));
   }
+  if (Function *f = M.getFunction(TM_EXECUTE_RO_FN_STR)) {
+    purelist.push_back(dyn_cast<Function>(f));
+  }
+  if (Function *f = M.getFunction(TM_EXECUTE_C_RO_STR)) {
+    purelist.push_back(dyn_cast<Function>(f));
+  }
+  if (Function *f = M.getFunction(TM_EXECUTE_C_RO_INTERNAL_STR)) {
+    purelist.push_back(dyn_cast<Function>(f));
+  }
   if (Function *f = M.getFunction(TM_LAMBDA_BASE_NAME)) {
     purelist.push_back(dyn_cast<Function>(f));
   }
   if (Function *f = M.getFunction(TM_SETJUMP_NAME)) {
     purelist.push_back(dyn_cast<Function>(f));
   }
+  if (Function *f = M.getFunction(TM_CHECKPOINT_STR)) {
+    purelist.push_back(dyn_cast<Function>(f));
+  }
   if (Function *f = M.getFunction(TM_RAII_CTOR)) {
     purelist.push_back(dyn_cast<Function>(f));
   }
@@ -149,6 +167,10 @@ void tm_plugin::discover_lambda_funcs(Module &M) {
     // std::function<void (TM_OPAQUE*)>::operator()(TM_OPAQUE*) const, only
     // the lambdas with that same signature.
     //
+    // NB: Each instance of TM_LAMBDA_THUNK also has this signature, with a
+    //     void* as its first argument.  Treating it as a lambda is what we
+    //     want: its clone calls the clone of the lambda directly.
+    //
     // TODO: we are explicitly skipping std::function<>::operator()(...).  It
     //       seems not to be necessary, so then why is it in the .o file?
     //
@@ -161,21 +183,22 @@ void tm_plugin::discover_lambda_funcs(Module &M) {
   }
 }
 
-/// Find the functions in the module that are called via TM_EXECUTE_C, and put
-/// them in the work list
+/// Find the functions in the module that are called via TM_EXECUTE_C or
+/// TM_EXECUTE_C_RO, and put them in the work list
 void tm_plugin::discover_capi_funcs(Module &M) {
-  // Find any call to TM_EXECUTE_C in any function's body
+  // Find any call to TM_EXECUTE_C or TM_EXECUTE_C_RO in any function's body
   for (auto fn = M.getFunctionList().begin(), e = M.getFunctionList().end();
        fn != e; ++fn) {
     for (inst_iterator I = inst_begin(*fn), E = inst_end(*fn); I != E; ++I) {
       CallSite CS(cast<Value>(&*I)); // CallSite is CallInst | InvokeInst
       if (CS) {
         if (Function *Callee = CS.getCalledFunction()) {
-          // If this is a call to TM_EXECUTE_C, then operand 1 is a function
-          // that needs to be processed, unless (a) it's a function pointer
-          // that we don't know how to turn into a function, or (b) the
+          // If this is a call to TM_EXECUTE_C(_RO), then operand 1 is a
+          // function that needs to be processed, unless (a) it's a function
+          // pointer that we don't know how to turn into a function, or (b) the
           // function we're calling does not have a definition in this TU
-          if (Callee->getName() == TM_EXECUTE_C_STR) {
+          if (Callee->getName() == TM_EXECUTE_C_STR ||
+              Callee->getName() == TM_EXECUTE_C_RO_STR) {
             if (Function *f = dyn_cast<Function>(CS.getArgOperand(1))) {
               if (!f->isDeclaration()) {
                 func_worklist.push(f);
@@ -270,6 +293,153 @@ void tm_plugin::discover_reachable_funcs() {
   }
 }
 
+/// Find the functions that are read-only: they never write to memory outside of
+/// their own stack frame, never allocate or free, and only call functions that
+/// are also read-only.  Then use the same rules to find the read-only RAII
+/// regions.  The boundary transformations can then begin these regions as
+/// read-only transactions.
+///
+/// NB: Getting this wrong is a performance bug, not a correctness bug: if a
+///     read-only transaction writes, the TM restarts it as a writer.
+///
+/// NB: The frame of the function that launches a transaction is above the
+///     transaction's part of the stack, so stores to it are instrumented.  A
+///     lambda that stores its result to a captured variable therefore writes,
+///     and is not read-only.
+void tm_plugin::discover_read_only() {
+  // Assume that every function is read-only, and then mark the ones that might
+  // write, until nothing changes.  Starting optimistically lets recursive
+  // functions be read-only.
+  for (auto &fn : functions) {
+    fn.second.may_write = false;
+  }
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (auto &fn : functions) {
+      if (fn.second.may_write) {
+        continue;
+      }
+      // A pure function's writes are not instrumented, so they don't matter.
+      // We can't see what a TM_RENAME function does, so assume it writes.
+      if (fn.second.clone != nullptr) {
+        fn.second.may_write = fn.second.clone != fn.first;
+        changed |= fn.second.may_write;
+        continue;
+      }
+      for (inst_iterator I = inst_begin(*fn.first), E = inst_end(*fn.first);
+           I != E; ++I) {
+        if (may_write(&*I, true)) {
+          fn.second.may_write = true;
+          changed = true;
+          break;
+        }
+      }
+    }
+  }
+
+  // An RAII region's allocas belong to the function that contains it, and
+  // might not be on the transaction's part of the stack, so stores to them
+  // count as writes
+  for (auto &cfg : raii_regions) {
+    cfg.read_only = true;
+    for (auto bb : cfg.instruction_blocks) {
+      for (auto &inst : *bb) {
+        if (may_write(&inst, false)) {
+          cfg.read_only = false;
+        }
+      }
+    }
+  }
+}
+
+/// Decide if @param inst might write to shared memory, or allocate or free,
+/// when it runs in a transaction.  Stores to the function's own allocas are
+/// private only when @param own_stack is true.  For calls to functions that we
+/// discovered, we use what discover_read_only has decided about them so far.
+bool tm_plugin::may_write(Instruction *inst, bool own_stack) {
+  const DataLayout &DL = inst->getModule()->getDataLayout();
+  auto on_stack = [&](Value *ptr) {
+    return own_stack && isa<AllocaInst>(GetUnderlyingObject(ptr, DL));
+  };
+
+  // Atomic and volatile accesses are unsafe, so they make the transaction
+  // irrevocable.  We count them as writes, even when they are loads.
+  if (isa<AtomicRMWInst>(inst) || isa<AtomicCmpXchgInst>(inst)) {
+    return true;
+  }
+  if (LoadInst *load = dyn_cast<LoadInst>(inst)) {
+    return load->isVolatile() || load->isAtomic();
+  }
+  if (StoreInst *store = dyn_cast<StoreInst>(inst)) {
+    return store->isVolatile() || store->isAtomic() ||
+           !on_stack(store->getPointerOperand());
+  }
+  CallSite CS(cast<Value>(inst));
+  if (!CS) {
+    return false;
+  }
+
+  // We can't know what indirect calls and inline assembly do
+  Function *callee = CS.getCalledFunction();
+  if (!callee || CS.isInlineAsm()) {
+    return true;
+  }
+
+  // memcpy, memset, and memmove write to their destination.  Of the other
+  // intrinsics, only the element-atomic memory intrinsics and the masked
+  // stores write.
+  if (MemIntrinsic *mem = dyn_cast<MemIntrinsic>(inst)) {
+    return !on_stack(mem->getRawDest());
+  }
+  if (callee->isIntrinsic()) {
+    if (IntrinsicInst *II = dyn_cast<IntrinsicInst>(inst)) {
+      if (II->getIntrinsicID() == Intrinsic::masked_store ||
+          II->getIntrinsicID() == Intrinsic::masked_scatter) {
+        return true;
+      }
+    }
+    return isa<AnyMemIntrinsic>(inst);
+  }
+
+  // Allocation and reclamation count as writes, and so do nested transactions,
+  // since they are flattened into this one.  Registering a commit handler, or
+  // getting the descriptor, does not write.
+  StringRef name = callee->getName();
+  if (name == "malloc" || name == "aligned_alloc" || name == "free" ||
+      name == TM_EXECUTE_STR || name == TM_EXECUTE_FN_STR ||
+      name == TM_EXECUTE_RO_FN_STR || name == TM_EXECUTE_C_STR ||
+      name == TM_EXECUTE_C_RO_STR || name == TM_EXECUTE_C_INTERNAL_STR ||
+      name == TM_EXECUTE_C_RO_INTERNAL_STR || name == TM_RAII_CTOR) {
+    return true;
+  }
+  if (name == TM_COMMIT_HANDLER_STR || name == TM_GET_DESCRIPTOR_STR) {
+    return false;
+  }
+
+  // TM_EXECUTE_T and TM_EXECUTE_RO_T are pure, so the check below would hide
+  // the nested transactions that they launch.  Their instances have mangled
+  // names, so match on the prefix of the mangling (e.g., _Z12tm_execute_tI).
+  for (std::string tmpl : {TM_EXECUTE_T_STR, TM_EXECUTE_RO_T_STR}) {
+    if (name.startswith("_Z" + std::to_string(tmpl.size()) + tmpl + "I")) {
+      return true;
+    }
+  }
+
+  // Pure functions are not instrumented, so their writes do not matter
+  if (std::find(purelist.begin(), purelist.end(), callee) != purelist.end()) {
+    return false;
+  }
+
+  // For the functions we discovered, use what we know about them.  Any other
+  // function is in another TU, and is only safe if it never writes.
+  auto fn = functions.find(callee);
+  if (fn != functions.end()) {
+    return fn->second.may_write;
+  }
+  return !callee->onlyReadsMemory();
+}
+
 /// Iterate through the list of discovered functions, and for each one, generate
 /// a clone and add it to the module
 ///
@@ -286,23 +456,55 @@ void tm_plugin::create_clones() {
         std::find(purelist.begin(), purelist.end(), fn.first) ==
             purelist.end()) {
 
-      // Sometimes, when cloning one function into another through the standard
-      // LLVM utilities, the new function will have more arguments, or arguments
-      // in a different order, than the original function.  Consequently,
-      // CloneFunction takes a ValueToValueMap that explains how the arguments
-      // to the original map to arguments of the clone. In our case, we are not
-      // modifying the argument order or count, so an empty map is sufficient.
+      // When cloning one function into another through the standard LLVM
+      // utilities, the new function can have more arguments than the original
+      // function.  Consequently, cloning takes a ValueToValueMap that explains
+      // how the arguments to the original map to arguments of the clone.
       ValueToValueMapTy v2vmap;
+      Function *orig = fn.first;
+      Function *newfunc = nullptr;
 
-      // Create the clone.  We are using the simplest cloning technique that
-      // LLVM offers.  The clone will go into the current module
-      Function *newfunc = CloneFunction(fn.first, v2vmap, nullptr);
+      // The clone takes the transaction descriptor as a hidden last parameter,
+      // so that its instrumentation does not need to look the descriptor up in
+      // TLS.  We can't add a parameter after the "..." of a varargs function,
+      // so those clones keep the original signature.
+      if (orig->isVarArg()) {
+        // The argument order and count are not changing, so an empty map is
+        // sufficient, and we can use the simplest cloning technique that LLVM
+        // offers.  The clone will go into the current module
+        newfunc = CloneFunction(orig, v2vmap, nullptr);
+      } else {
+        // Create an empty function with the extra parameter, map the original
+        // arguments to the first parameters of the new function, and then
+        // clone the body into it.  This mirrors what CloneFunction does.
+        newfunc = Function::Create(add_desc_param(orig->getFunctionType()),
+                                   orig->getLinkage(), orig->getAddressSpace(),
+                                   "", orig->getParent());
+        Function::arg_iterator dest = newfunc->arg_begin();
+        for (const Argument &arg : orig->args()) {
+          dest->setName(arg.getName());
+          v2vmap[&arg] = &*dest++;
+        }
+        dest->setName("tm_desc");
+        SmallVector<ReturnInst *, 8> returns;
+        CloneFunctionInto(newfunc, orig, v2vmap,
+                          orig->getSubprogram() != nullptr, returns);
+        fn.second.takes_desc = true;
+      }
 
       // Give the new function a name by concatenating the TM_PREFIX_STR with
       // the original name of the function, and then save the new function so we
       // can instrument it in a later phase
-      newfunc->setName(Twine(TM_PREFIX_STR, fn.first->getName()));
+      newfunc->setName(Twine(TM_PREFIX_STR, orig->getName()));
       fn.second.clone = newfunc;
     }
   }
+}
+
+/// Make the type of a function that takes the transaction descriptor as a
+/// hidden last parameter, from the type of the original function
+FunctionType *tm_plugin::add_desc_param(FunctionType *type) {
+  std::vector<Type *> arg_types(type->param_begin(), type->param_end());
+  arg_types.push_back(sigs.get_type(signatures::OPAQUE));
+  return FunctionType::get(type->getReturnType(), arg_types, false);
 }
\ No newline at end of file
@@ -22,13 +22,19 @@ void tm_plugin::instrument_function_bodies() {
     if (std::find(purelist.begin(), purelist.end(), clone) != purelist.end()) {
       continue;
     }
+    // The descriptor is the clone's hidden last parameter, if it has one
+    Value *desc = nullptr;
+    if (func.second.takes_desc) {
+      desc = &*std::prev(clone->arg_end());
+    }
     for (auto bb = clone->begin(), bbe = clone->end(); bb != bbe; ++bb) {
       for (auto inst = bb->begin(), E = bb->end(); inst != E;) {
         CallSite callsite(cast<Value>(inst));
         if (callsite) {
           // If transform_callsite returns an instruction, then we should
           // use that instruction instead of the one we had
-          if (Instruction *new_inst = transform_callsite(callsite, inst)) {
+          if (Instruction *new_inst =
+                  transform_callsite(callsite, inst, desc)) {
             ReplaceInstWithValue(bb->getInstList(), inst, new_inst);
             inst = BasicBlock::iterator(new_inst); // update iterator
           }
@@ -45,7 +51,7 @@ void tm_plugin::instrument_function_bodies() {
         // atomic/volatile stores)
         else if (isa<StoreInst>(inst)) {
           StoreInst *store = dyn_cast<StoreInst>(&*inst);
-          if (CallInst *new_store = convert_store(store)) {
+          if (CallInst *new_store = convert_store(store, desc)) {
             ReplaceInstWithInst(store, new_store);
             inst = BasicBlock::iterator(new_store); // update iterator
           } else {
@@ -62,7 +68,7 @@ void tm_plugin::instrument_function_bodies() {
           // If convert_load returns nullptr, then we need to prefix with
           // unsafe, because it's a volatile or atomic, which is not supported.
           if (instrument_reads) {
-            if (Instruction *new_load = convert_load(load)) {
+            if (Instruction *new_load = convert_load(load, desc)) {
               ReplaceInstWithInst(load, new_load);
               inst = BasicBlock::iterator(new_load);
             } else {
@@ -147,8 +153,17 @@ void tm_plugin::instrument_function_bodies() {
 /// mechanism.  This may insert several instructions into the basic block, but
 /// will always return a CallInst that can be passed to ReplaceInstWithValue to
 /// replace @param inst.
+///
+/// Clones take the descriptor as a hidden last parameter, so the new call
+/// passes @param desc, the caller's descriptor, to them.  If desc is nullptr,
+/// the descriptor is fetched from the library immediately before the call.
+/// TM_TRANSLATE may return a clone or the original function.  Since it is
+/// harmless (on x86) to pass an extra argument to a function that does not
+/// expect it, calls through TM_TRANSLATE always pass the descriptor, unless the
+/// function is varargs.
 Instruction *tm_plugin::transform_callsite(CallSite &callsite,
-                                           BasicBlock::iterator inst) {
+                                           BasicBlock::iterator inst,
+                                           Value *desc) {
   // For inline assembly, serialize the transaction
   if (const CallInst *CI = dyn_cast<CallInst>(inst)) {
     if (CI->isInlineAsm()) {
@@ -169,12 +184,21 @@ Instruction *tm_plugin::transform_callsite(CallSite &callsite,
       Value *orig = callsite.getCalledValue();
       BitCastInst *erased =
           new BitCastInst(orig, sigs.get_type(signatures::OPAQUE), "", ins_pt);
-      // call TM_TRANSLATE, then cast the result back to the original func type
+      // call TM_TRANSLATE, then cast the result back to the original func
+      // type, extended with the descriptor parameter
       CallInst *xlate = CallInst::Create(sigs.get_func(signatures::TRANSLATE),
                                          {erased}, "", ins_pt);
-      BitCastInst *updated =
-          new BitCastInst(xlate, orig->getType(), "", ins_pt);
-      return create_callinst(callsite, inst, updated, orig);
+      FunctionType *type =
+          cast<FunctionType>(orig->getType()->getPointerElementType());
+      if (type->isVarArg()) {
+        BitCastInst *updated =
+            new BitCastInst(xlate, orig->getType(), "", ins_pt);
+        return create_callinst(callsite, inst, updated, orig, nullptr);
+      }
+      BitCastInst *updated = new BitCastInst(
+          xlate, add_desc_param(type)->getPointerTo(), "", ins_pt);
+      return create_callinst(callsite, inst, updated, orig,
+                             get_desc(desc, ins_pt));
     }
     // WARNING: this fallthrough code is not tested.  If we wind up here, we
     // will call the original, uninstrumented function
@@ -198,8 +222,10 @@ Instruction *tm_plugin::transform_callsite(CallSite &callsite,
     return nullptr;
   }
 
-  // We ignore calls to TM_COMMIT_HANDLER, since they are to the TM API
-  if (callee->getName() == TM_COMMIT_HANDLER_STR) {
+  // We ignore calls to TM_COMMIT_HANDLER and TM_GET_DESCRIPTOR, since they are
+  // to the TM API
+  if (callee->getName() == TM_COMMIT_HANDLER_STR ||
+      callee->getName() == TM_GET_DESCRIPTOR_STR) {
     return nullptr;
   }
 
@@ -239,18 +265,32 @@ Instruction *tm_plugin::transform_callsite(CallSite &callsite,
         new BitCastInst(orig, sigs.get_type(signatures::OPAQUE), "", ins_pt);
     CallInst *xlate = CallInst::Create(sigs.get_func(signatures::TRANSLATE),
                                        {erased}, "", ins_pt);
-    BitCastInst *updated = new BitCastInst(xlate, orig->getType(), "", ins_pt);
+    BitCastInst *updated = nullptr;
+    Value *xlate_desc = nullptr;
+    if (orig->isVarArg()) {
+      updated = new BitCastInst(xlate, orig->getType(), "", ins_pt);
+    } else {
+      updated = new BitCastInst(
+          xlate, add_desc_param(orig->getFunctionType())->getPointerTo(), "",
+          ins_pt);
+      xlate_desc = get_desc(desc, ins_pt);
+    }
     if (callsite.isInvoke())
-      return create_invokeinst(callsite, inst, updated, orig);
+      return create_invokeinst(callsite, inst, updated, orig, xlate_desc);
     else
-      return create_callinst(callsite, inst, updated, orig);
+      return create_callinst(callsite, inst, updated, orig, xlate_desc);
   }
 
-  // If we found a clone, create a call or invoke using the clone
+  // If we found a clone, create a call or invoke using the clone.  Pass the
+  // descriptor if the clone expects it
+  Value *clone_desc = nullptr;
+  if (clone_takes_desc(callee)) {
+    clone_desc = get_desc(desc, dyn_cast<Instruction>(&*inst));
+  }
   if (CallInst *callinst = dyn_cast<CallInst>(inst)) {
-    return create_callinst(callsite, inst, clone, clone);
+    return create_callinst(callsite, inst, clone, clone, clone_desc);
   } else if (InvokeInst *invokeinst = dyn_cast<InvokeInst>(inst)) {
-    return create_invokeinst(callsite, inst, clone, clone);
+    return create_invokeinst(callsite, inst, clone, clone, clone_desc);
   }
 
   // WARNING: this code path is not tested.  It seems dangerous to return a
@@ -259,13 +299,15 @@ Instruction *tm_plugin::transform_callsite(CallSite &callsite,
 }
 
 /// Replace a call instruction to the original code with a call to something
-/// safe
+/// safe.  If @param desc is not nullptr, pass it as an extra last argument.
 Instruction *tm_plugin::create_callinst(CallSite &callsite,
                                         BasicBlock::iterator inst, Value *val,
-                                        Value *orig_val) {
-  CallInst *new_call = CallInst::Create(
-      val, SmallVector<Value *, 8>(callsite.arg_begin(), callsite.arg_end()),
-      "", dyn_cast<Instruction>(&*inst));
+                                        Value *orig_val, Value *desc) {
+  SmallVector<Value *, 8> args(callsite.arg_begin(), callsite.arg_end());
+  if (desc)
+    args.push_back(desc);
+  CallInst *new_call =
+      CallInst::Create(val, args, "", dyn_cast<Instruction>(&*inst));
   // If it's an indirect call, use the calling conventions of the original
   if (!callsite.isIndirectCall())
     new_call->setCallingConv(dyn_cast<Function>(orig_val)->getCallingConv());
@@ -275,23 +317,33 @@ Instruction *tm_plugin::create_callinst(CallSite &callsite,
 }
 
 /// Replace an invoke instruction to the original code with a call to something
-/// safe
+/// safe.  If @param desc is not nullptr, pass it as an extra last argument.
 Instruction *tm_plugin::create_invokeinst(CallSite &callsite,
                                           BasicBlock::iterator inst, Value *val,
-                                          Value *orig_val) {
+                                          Value *orig_val, Value *desc) {
   // build a new invoke, using the landing pad and calling conventions of the
   // old invoke
   InvokeInst *invokeinst = dyn_cast<InvokeInst>(inst);
-  InvokeInst *newinst = InvokeInst::Create(
-      val, invokeinst->getNormalDest(), invokeinst->getUnwindDest(),
-      SmallVector<Value *, 8>(callsite.arg_begin(), callsite.arg_end()), "",
-      invokeinst);
+  SmallVector<Value *, 8> args(callsite.arg_begin(), callsite.arg_end());
+  if (desc)
+    args.push_back(desc);
+  InvokeInst *newinst =
+      InvokeInst::Create(val, invokeinst->getNormalDest(),
+                         invokeinst->getUnwindDest(), args, "", invokeinst);
   newinst->setCallingConv(dyn_cast<Function>(orig_val)->getCallingConv());
   if (!newinst->getDebugLoc())
     newinst->setDebugLoc(inst->getDebugLoc());
   return newinst;
 }
 
+/// Return @param desc if it is not nullptr.  Otherwise, insert a call to
+/// TM_GET_DESCRIPTOR before @param ins_pt, and return its result.
+Value *tm_plugin::get_desc(Value *desc, Instruction *ins_pt) {
+  if (desc)
+    return desc;
+  return CallInst::Create(sigs.get_func(signatures::GET_DESC), {}, "", ins_pt);
+}
+
 /// Insert a call to TM_UNSAFE before the current instruction
 void tm_plugin::prefix_with_unsafe(BasicBlock::iterator inst) {
   CallInst *new_call = CallInst::Create(sigs.get_func(signatures::UNSAFE), {},
@@ -299,8 +351,9 @@ void tm_plugin::prefix_with_unsafe(BasicBlock::iterator inst) {
 }
 
 /// Given a store, either replace it with a call to TM_STORE, or return
-/// nullptr to indicate that the store is not TM-safe
-CallInst *tm_plugin::convert_store(StoreInst *store) {
+/// nullptr to indicate that the store is not TM-safe.  If @param desc is not
+/// nullptr, the call is to the TM_STORE_*_DESC version, and passes desc.
+CallInst *tm_plugin::convert_store(StoreInst *store, Value *desc) {
   if (store->isVolatile() || store->isAtomic())
     return nullptr;
   // Get pointer and value operands of the store, and the base type
@@ -314,8 +367,12 @@ CallInst *tm_plugin::convert_store(StoreInst *store) {
 
   // If it's not a pointer type, then we just make a replacement call
   // instruction
-  if (!type->isPointerTy())
+  if (!type->isPointerTy()) {
+    if (desc)
+      return CallInst::Create(sigs.get_store_desc(val->getType()),
+                              {desc, val, ptr}, "");
     return CallInst::Create(sigs.get_store(val->getType()), {val, ptr}, "");
+  }
 
   // It's a pointer type.  We need to convert the arguments from type* and
   // type** to void* and void** (by adding two bitcasts), and then we can make
@@ -326,12 +383,16 @@ CallInst *tm_plugin::convert_store(StoreInst *store) {
       new BitCastInst(val, sigs.get_type(signatures::OPAQUE), "", store);
   BitCastInst *VSS =
       new BitCastInst(ptr, sigs.get_type(signatures::PTR_OPAQUE), "", store);
+  if (desc)
+    return CallInst::Create(sigs.get_store_desc(val->getType()),
+                            {desc, VS, VSS}, "");
   return CallInst::Create(sigs.get_store(val->getType()), {VS, VSS}, "");
 }
 
 /// Given a load, either replace it with a call to TM_LOAD, or return nullptr to
-/// indicate that the load is not TM-safe
-Instruction *tm_plugin::convert_load(LoadInst *load) {
+/// indicate that the load is not TM-safe.  If @param desc is not nullptr, the
+/// call is to the TM_LOAD_*_DESC version, and passes desc.
+Instruction *tm_plugin::convert_load(LoadInst *load, Value *desc) {
   if (load->isVolatile() || load->isAtomic())
     return nullptr;
   // Get pointer and return type of the load
@@ -343,8 +404,11 @@ Instruction *tm_plugin::convert_load(LoadInst *load) {
     return nullptr;
 
   // If it's not a pointer type, then we just make a replacement instruction
-  if (!type->isPointerTy())
+  if (!type->isPointerTy()) {
+    if (desc)
+      return CallInst::Create(sigs.get_load_desc(type), {desc, ptr}, "");
     return CallInst::Create(sigs.get_load(type), {ptr}, "");
+  }
 
   // It's a pointer type.  We need to convert the argument from type** to
   // void**, by adding a bitcast, and then we need to bitcast the return value
@@ -354,7 +418,9 @@ Instruction *tm_plugin::convert_load(LoadInst *load) {
   // NB: first bitcast and new load go before the original load
   BitCastInst *VSS =
       new BitCastInst(ptr, sigs.get_type(signatures::PTR_OPAQUE), "", load);
-  CallInst *new_load = CallInst::Create(sigs.get_load(type), {VSS}, "", load);
+  CallInst *new_load =
+      desc ? CallInst::Create(sigs.get_load_desc(type), {desc, VSS}, "", load)
+           : CallInst::Create(sigs.get_load(type), {VSS}, "", load);
   return new BitCastInst(new_load, type);
 }
 
@@ -8,9 +8,9 @@
 
 using namespace llvm;
 
-// to reduce boilerplate code, we use CREATE_FUNC_1 and CREATE_FUNC_2 to create
-// Module::getOrInsertFunction() calls.  These two macros differ based on the
-// number of arguments to getOrInsertFunction()
+// to reduce boilerplate code, we use CREATE_FUNC_1, CREATE_FUNC_2 and
+// CREATE_FUNC_3 to create Module::getOrInsertFunction() calls.  These macros
+// differ based on the number of arguments to getOrInsertFunction()
 //
 // NB: the 'false' indicates that it is not a varargs function
 #define CREATE_FUNC_1(NAME, RETTY, ARGSTY1)                                    \
@@ -22,6 +22,11 @@ using namespace llvm;
       M.getOrInsertFunction(                                                   \
            NAME, FunctionType::get(RETTY, {ARGSTY1, ARGSTY2}, false))          \
           .getCallee());
+#define CREATE_FUNC_3(NAME, RETTY, ARGSTY1, ARGSTY2, ARGSTY3)                  \
+  cast<Function>(                                                              \
+      M.getOrInsertFunction(                                                   \
+           NAME, FunctionType::get(RETTY, {ARGSTY1, ARGSTY2, ARGSTY3}, false)) \
+          .getCallee());
 
 /// Initialize the signatures object by creating Type* objects that can be
 /// reused throughout the plugin, and by inserting extern Function
@@ -74,6 +79,42 @@ void signatures::init(Module &M) {
   stores[P] = CREATE_FUNC_2(TM_STORE_P_STR, types[VOID],
                             {types[OPAQUE], types[PTR_OPAQUE]});
 
+  // create the load and store functions that take a descriptor.  Each has the
+  // same signature as above, but with an extra void* parameter at the front
+  loads_desc[U1] = CREATE_FUNC_2(TM_LOAD_U1_DESC_STR, types[I8],
+                                 {types[OPAQUE], types[OPAQUE]});
+  loads_desc[U2] = CREATE_FUNC_2(TM_LOAD_U2_DESC_STR, types[I16],
+                                 {types[OPAQUE], types[I16P]});
+  loads_desc[U4] = CREATE_FUNC_2(TM_LOAD_U4_DESC_STR, types[I32],
+                                 {types[OPAQUE], types[I32P]});
+  loads_desc[U8] = CREATE_FUNC_2(TM_LOAD_U8_DESC_STR, types[I64],
+                                 {types[OPAQUE], types[I64P]});
+  loads_desc[F] = CREATE_FUNC_2(TM_LOAD_F_DESC_STR, types[F32],
+                                {types[OPAQUE], types[F32P]});
+  loads_desc[D] = CREATE_FUNC_2(TM_LOAD_D_DESC_STR, types[F64],
+                                {types[OPAQUE], types[F64P]});
+  loads_desc[LD] = CREATE_FUNC_2(TM_LOAD_LD_DESC_STR, types[F128],
+                                 {types[OPAQUE], types[F128P]});
+  loads_desc[P] = CREATE_FUNC_2(TM_LOAD_P_DESC_STR, types[I8P],
+                                {types[OPAQUE], types[PTR_OPAQUE]});
+  stores_desc[U1] = CREATE_FUNC_3(TM_STORE_U1_DESC_STR, types[VOID],
+                                  {types[OPAQUE], types[I8], types[OPAQUE]});
+  stores_desc[U2] = CREATE_FUNC_3(TM_STORE_U2_DESC_STR, types[VOID],
+                                  {types[OPAQUE], types[I16], types[I16P]});
+  stores_desc[U4] = CREATE_FUNC_3(TM_STORE_U4_DESC_STR, types[VOID],
+                                  {types[OPAQUE], types[I32], types[I32P]});
+  stores_desc[U8] = CREATE_FUNC_3(TM_STORE_U8_DESC_STR, types[VOID],
+                                  {types[OPAQUE], types[I64], types[I64P]});
+  stores_desc[F] = CREATE_FUNC_3(TM_STORE_F_DESC_STR, types[VOID],
+                                 {types[OPAQUE], types[F32], types[F32P]});
+  stores_desc[D] = CREATE_FUNC_3(TM_STORE_D_DESC_STR, types[VOID],
+                                 {types[OPAQUE], types[F64], types[F64P]});
+  stores_desc[LD] = CREATE_FUNC_3(TM_STORE_LD_DESC_STR, types[VOID],
+                                  {types[OPAQUE], types[F128], types[F128P]});
+  stores_desc[P] =
+      CREATE_FUNC_3(TM_STORE_P_DESC_STR, types[VOID],
+                    {types[OPAQUE], types[OPAQUE], types[PTR_OPAQUE]});
+
   // create malloc, aligned_alloc, free, memcpy, memset and memmove functions
   this->funcs[MALLOC] = CREATE_FUNC_1(TM_MALLOC_STR, types[I8P], {types[I64]});
   this->funcs[ALIGNED_ALLOC] =
@@ -104,6 +145,13 @@ void signatures::init(Module &M) {
   funcs[TRANSLATE] =
       CREATE_FUNC_1(TM_TRANSLATE_CALL_STR, types[I8P], {types[I8P]});
 
+  // create the call for getting the descriptor of the current thread, for
+  // instrumented code that was not passed one
+  funcs[GET_DESC] = cast<Function>(
+      M.getOrInsertFunction(TM_GET_DESCRIPTOR_STR,
+                            FunctionType::get(types[OPAQUE], false))
+          .getCallee());
+
   // create the call for forcing a transaction to become irrevocable.
   funcs[UNSAFE] = cast<Function>(
       M.getOrInsertFunction(
@@ -113,24 +161,40 @@ void signatures::init(Module &M) {
 
   // The signature for the *internal* c-api execution function is complex, and
   // not necessarily needed. To simplify, we make the signature only if we can
-  // find the *external* c-api execution function
-  if (Function *OriginalFunc = M.getFunction(TM_EXECUTE_C_STR)) {
-    // Create arg types of OriginalFunc
-    std::vector<Type *> arg_types;
-    for (const Argument &arg : OriginalFunc->args())
-      arg_types.push_back(arg.getType());
-    // Duplicate the (first) function parameter and add it as an extra parameter
-    Type *ArgTy = arg_types[0];
-    arg_types.push_back(ArgTy);
-    // Create the new function type and function
-    FunctionType *FuncTy = FunctionType::get(
-        OriginalFunc->getFunctionType()->getReturnType(), arg_types,
-        OriginalFunc->getFunctionType()->isVarArg());
-    funcs[CAPI] =
-        cast<Function>(M.getOrInsertFunction(TM_EXECUTE_C_INTERNAL_STR, FuncTy,
-                                             OriginalFunc->getAttributes())
-                           .getCallee());
-  }
+  // find the *external* c-api execution function.  The read-only version has
+  // the same signature, and we may also use it for TM_EXECUTE_C calls that we
+  // find to be read-only.
+  funcs[CAPI] = make_capi_internal(M, TM_EXECUTE_C_STR,
+                                   TM_EXECUTE_C_INTERNAL_STR);
+  funcs[CAPI_RO] = make_capi_internal(M,
+                                      M.getFunction(TM_EXECUTE_C_RO_STR)
+                                          ? TM_EXECUTE_C_RO_STR
+                                          : TM_EXECUTE_C_STR,
+                                      TM_EXECUTE_C_RO_INTERNAL_STR);
+}
+
+/// Helper function to create the *internal* c-api execution function @param
+/// internal, whose signature is derived from the *external* one, @param
+/// external.  Returns nullptr if @param external is not in the module.
+Function *signatures::make_capi_internal(Module &M, const char *external,
+                                         const char *internal) {
+  Function *OriginalFunc = M.getFunction(external);
+  if (!OriginalFunc)
+    return nullptr;
+  // Create arg types of OriginalFunc
+  std::vector<Type *> arg_types;
+  for (const Argument &arg : OriginalFunc->args())
+    arg_types.push_back(arg.getType());
+  // Duplicate the (first) function parameter and add it as an extra parameter
+  Type *ArgTy = arg_types[0];
+  arg_types.push_back(ArgTy);
+  // Create the new function type and function
+  FunctionType *FuncTy = FunctionType::get(
+      OriginalFunc->getFunctionType()->getReturnType(), arg_types,
+      OriginalFunc->getFunctionType()->isVarArg());
+  return cast<Function>(
+      M.getOrInsertFunction(internal, FuncTy, OriginalFunc->getAttributes())
+          .getCallee());
 }
 
 /// Helper function to map a type to a vartype, to simplify array indexing
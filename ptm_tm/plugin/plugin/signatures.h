@@ -33,7 +33,9 @@ public:
     MEMMOVE = 6,       // memmove
     TRANSLATE = 7,     // tm_translate_call
     UNSAFE = 8,        // tm_unsafe
-    FN_COUNT = 9,      // # entries in this enum
+    GET_DESC = 9,      // tm_get_descriptor
+    CAPI_RO = 10,      // C API execute read-only transaction function
+    FN_COUNT = 11,     // # entries in this enum
   };
 
   /// An enum to avoid unnecessary hard-coding of array indices when looking up
@@ -63,12 +65,24 @@ private:
   /// Helper function to convert from llvm types to VarTypes
   static int type_to_vartype(llvm::Type *t);
 
+  /// Helper function to create the internal version of a C API execution
+  /// function, from the external one
+  static llvm::Function *make_capi_internal(llvm::Module &M,
+                                            const char *external,
+                                            const char *internal);
+
   /// Signatures of the tm_load_* functions
   llvm::Function *loads[VarTypes::VT_COUNT];
 
   /// Signatures of the tm_store_* functions
   llvm::Function *stores[VarTypes::VT_COUNT];
 
+  /// Signatures of the tm_load_*_desc functions
+  llvm::Function *loads_desc[VarTypes::VT_COUNT];
+
+  /// Signatures of the tm_store_*_desc functions
+  llvm::Function *stores_desc[VarTypes::VT_COUNT];
+
   /// Signatures of the other tm instrumentation functions
   llvm::Function *funcs[FuncNames::FN_COUNT];
 
@@ -100,6 +114,24 @@ public:
     }
   }
 
+  /// Get the appropriate tm_load_*_desc function for the provided type
+  llvm::Function *get_load_desc(llvm::Type *type) {
+    if (type_to_vartype(type) != -1) {
+      return loads_desc[type_to_vartype(type)];
+    } else {
+      return nullptr;
+    }
+  }
+
+  /// Get the appropriate tm_store_*_desc function for the provided type
+  llvm::Function *get_store_desc(llvm::Type *type) {
+    if (type_to_vartype(type) != -1) {
+      return stores_desc[type_to_vartype(type)];
+    } else {
+      return nullptr;
+    }
+  }
+
   /// Get an instrumented function
   llvm::Function *get_func(FuncNames f) { return funcs[f]; }
 
@@ -66,6 +66,25 @@ class tm_plugin : public llvm::ModulePass {
       return nullptr;
   }
 
+  /// A lookup function for finding if the clone of a function takes the
+  /// transaction descriptor as a hidden last parameter
+  bool clone_takes_desc(llvm::Function *input_function) {
+    auto function = functions.find(input_function);
+    return function != functions.end() && function->second.takes_desc;
+  }
+
+  /// A lookup function for finding if a function, and everything it calls, is
+  /// free of writes to shared memory, so that it can run in a read-only
+  /// transaction
+  bool is_read_only(llvm::Function *input_function) {
+    auto function = functions.find(input_function);
+    return function != functions.end() && !function->second.may_write;
+  }
+
+  /// Cloning: helper to make the type of a function that takes the transaction
+  /// descriptor as a hidden last parameter, from the type of the original
+  llvm::FunctionType *add_desc_param(llvm::FunctionType *type);
+
   /// Discovery: find all annotations in the Module and attach them to the
   /// corresponding functions
   void attach_annotations_to_functions(llvm::Module &M);
@@ -97,6 +116,14 @@ class tm_plugin : public llvm::ModulePass {
   /// reachable functions.
   void discover_reachable_funcs_raii(llvm::Module &M);
 
+  /// Discovery: find the reachable functions and the RAII regions that never
+  /// write to shared memory, so that their transactions can be read-only
+  void discover_read_only();
+
+  /// Discovery: helper to decide if an instruction might write to shared
+  /// memory, or allocate or free, when it runs in a transaction
+  bool may_write(llvm::Instruction *inst, bool own_stack);
+
   /// Cloning: clone all functions in the worklist
   void create_clones();
 
@@ -110,31 +137,38 @@ class tm_plugin : public llvm::ModulePass {
 
   /// Function Instrumentation: helper to transform a callsite to use a clone
   llvm::Instruction *transform_callsite(llvm::CallSite &callsite,
-                                        llvm::BasicBlock::iterator inst);
+                                        llvm::BasicBlock::iterator inst,
+                                        llvm::Value *desc);
 
   /// Function Instrumentation: helper to replace a call instruction with a new
   /// instruction
   llvm::Instruction *create_callinst(llvm::CallSite &callsite,
                                      llvm::BasicBlock::iterator inst,
-                                     llvm::Value *val, llvm::Value *orig_val);
+                                     llvm::Value *val, llvm::Value *orig_val,
+                                     llvm::Value *desc);
 
   /// Function Instrumentation: helper to replace an invoke instruction with a
   /// new instruction
   llvm::Instruction *create_invokeinst(llvm::CallSite &callsite,
                                        llvm::BasicBlock::iterator inst,
-                                       llvm::Value *val, llvm::Value *orig_val);
+                                       llvm::Value *val, llvm::Value *orig_val,
+                                       llvm::Value *desc);
+
+  /// Function Instrumentation: helper to get a descriptor to pass to a clone,
+  /// by calling TM_GET_DESCRIPTOR if the caller does not have one
+  llvm::Value *get_desc(llvm::Value *desc, llvm::Instruction *ins_pt);
 
   /// Function Instrumentation: helper to insert a call to TM_UNSAFE before the
   /// provided instruction
   void prefix_with_unsafe(llvm::BasicBlock::iterator inst);
 
   /// Function Instrumentation: helper to try to convert a store instruction
-  /// into a tm_store
-  llvm::CallInst *convert_store(llvm::StoreInst *store);
+  /// into a tm_store (or a tm_store_*_desc, if desc is not null)
+  llvm::CallInst *convert_store(llvm::StoreInst *store, llvm::Value *desc);
 
   /// Function Instrumentation: helper to try to convert a load instruction into
-  /// a tm_load
-  llvm::Instruction *convert_load(llvm::LoadInst *load);
+  /// a tm_load (or a tm_load_*_desc, if desc is not null)
+  llvm::Instruction *convert_load(llvm::LoadInst *load, llvm::Value *desc);
 
   /// Function Instrumentation: helper to try to convert a intrinsic instruction
   /// into a safe call
@@ -151,6 +185,10 @@ class tm_plugin : public llvm::ModulePass {
   /// Boundary Instrumentation: transform the code inside of lambdas
   void convert_lambdas_cxx_api(llvm::Module &M);
 
+  /// Boundary Instrumentation: make lambda and RAII regions that never write
+  /// begin read-only transactions
+  void convert_read_only_regions(llvm::Module &M);
+
   /// Run-time Mappings: add the static initializer that tells the runtime
   /// library about function-to-clone mappings
   void create_runtime_mappings(llvm::Module &M);
@@ -15,6 +15,16 @@ struct function_features {
 
   /// Is orig a lambda?  If so, we must do some work to it, too...
   bool orig_lambda = false;
+
+  /// Does the clone take the transaction descriptor as a hidden last
+  /// parameter?  This is true for every clone that the plugin creates, except
+  /// clones of varargs functions
+  bool takes_desc = false;
+
+  /// Might the function, or anything it calls, write to memory outside of its
+  /// own stack frame, or allocate or free memory?  If not, then a transaction
+  /// that only runs this function can be read-only.
+  bool may_write = true;
 };
 
 /// raii_region_t tracks a lexically-scoped region that uses the RAII API.  It
@@ -30,6 +40,9 @@ struct raii_region_t {
   /// all BBs between the constructor and destructor
   std::vector<llvm::BasicBlock *> instruction_blocks;
 
+  /// Is it safe to begin this region as a read-only transaction?
+  bool read_only = false;
+
   /// Default constructor makes an instance with no fields set
   raii_region_t() {}
 
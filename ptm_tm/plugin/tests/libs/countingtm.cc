@@ -19,6 +19,7 @@
 #include <unordered_map>
 
 #include "../../../common/tm_api.h"
+#include "../../../libs/common/checkpoint.h"
 #include "../include/tm_stats.h"
 
 // Global metadata
@@ -82,6 +83,13 @@ void begin_tx() {
   stats[TM_STATS_BEGIN_OUTER]++;
 }
 
+// Begin a read-only transaction.  We run it just like any other transaction,
+// but count it, so that tests can see that the read-only entry point was used
+void begin_tx_ro() {
+  begin_tx();
+  stats[TM_STATS_READONLY]++;
+}
+
 // Commit a transaction by releasing the lock, unless the thread is in a nested
 // transaction, in which case we can just decrement the counter and return
 void end_tx() {
@@ -222,12 +230,62 @@ STOREFUNC(double, TM_STORE_D, TM_STATS_STORE_D)
 STOREFUNC(long double, TM_STORE_LD, TM_STATS_STORE_LD)
 STOREFUNC(void *, TM_STORE_P, TM_STATS_STORE_P)
 
+// Clones call versions of the load/store functions that also take the
+// transaction descriptor.  countingTM does not need the descriptor, so these
+// count the same statistics as the functions above.
+//
+// NB: Our tests sometimes call clones directly, in which case the descriptor
+//     is garbage, so we must not look at it.
+#define LOADFUNC_DESC(TYPE, NAME, INDEX)                                       \
+  __attribute__((always_inline)) TYPE NAME(TM_OPAQUE *, TYPE *ptr) {           \
+    stats[INDEX]++;                                                            \
+    return *ptr;                                                               \
+  }
+#define STOREFUNC_DESC(TYPE, NAME, INDEX)                                      \
+  __attribute__((always_inline)) void NAME(TM_OPAQUE *, TYPE val, TYPE *ptr) { \
+    stats[INDEX]++;                                                            \
+    *ptr = val;                                                                \
+  }
+
+// Generate the load functions that take a descriptor
+LOADFUNC_DESC(uint8_t, TM_LOAD_U1_DESC, TM_STATS_LOAD_U1)
+LOADFUNC_DESC(uint16_t, TM_LOAD_U2_DESC, TM_STATS_LOAD_U2)
+LOADFUNC_DESC(uint32_t, TM_LOAD_U4_DESC, TM_STATS_LOAD_U4)
+LOADFUNC_DESC(uint64_t, TM_LOAD_U8_DESC, TM_STATS_LOAD_U8)
+LOADFUNC_DESC(float, TM_LOAD_F_DESC, TM_STATS_LOAD_F)
+LOADFUNC_DESC(double, TM_LOAD_D_DESC, TM_STATS_LOAD_D)
+LOADFUNC_DESC(long double, TM_LOAD_LD_DESC, TM_STATS_LOAD_LD)
+LOADFUNC_DESC(void *, TM_LOAD_P_DESC, TM_STATS_LOAD_P)
+
+// Generate the store functions that take a descriptor
+STOREFUNC_DESC(uint8_t, TM_STORE_U1_DESC, TM_STATS_STORE_U1)
+STOREFUNC_DESC(uint16_t, TM_STORE_U2_DESC, TM_STATS_STORE_U2)
+STOREFUNC_DESC(uint32_t, TM_STORE_U4_DESC, TM_STATS_STORE_U4)
+STOREFUNC_DESC(uint64_t, TM_STORE_U8_DESC, TM_STATS_STORE_U8)
+STOREFUNC_DESC(float, TM_STORE_F_DESC, TM_STATS_STORE_F)
+STOREFUNC_DESC(double, TM_STORE_D_DESC, TM_STATS_STORE_D)
+STOREFUNC_DESC(long double, TM_STORE_LD_DESC, TM_STATS_STORE_LD)
+STOREFUNC_DESC(void *, TM_STORE_P_DESC, TM_STATS_STORE_P)
+
+// Instrumented code that was not passed a descriptor (e.g., RAII regions) calls
+// this to get one
+TM_OPAQUE *TM_GET_DESCRIPTOR() { return (TM_OPAQUE *)TxThread::get_self(); }
+
 // For the C API, this is the call we actually make to launch an instrumented
-// region
+// region.  Clones take the descriptor as a hidden last parameter, so we pass
+// the same value as TM_EXECUTE passes to lambdas.
 void TM_EXECUTE_C_INTERNAL(void (*func)(void *), void *args,
                            void (*anno_func)(void *)) {
   begin_tx();
-  anno_func(args);
+  ((void (*)(void *, TM_OPAQUE *))anno_func)(args, (TM_OPAQUE *)0xCAFE);
+  end_tx();
+}
+
+// The read-only version of TM_EXECUTE_C_INTERNAL
+void TM_EXECUTE_C_RO_INTERNAL(void (*func)(void *), void *args,
+                              void (*anno_func)(void *)) {
+  begin_tx_ro();
+  ((void (*)(void *, TM_OPAQUE *))anno_func)(args, (TM_OPAQUE *)0xCAFE);
   end_tx();
 }
 
@@ -245,6 +303,16 @@ void TM_EXECUTE_C(void *flags, void (*func)(void *), void *args) {
   TM_EXECUTE_C_INTERNAL(func, args, clone.cfunc);
 }
 
+// The read-only version of TM_EXECUTE_C
+void TM_EXECUTE_C_RO(void *flags, void (*func)(void *), void *args) {
+  union {
+    void *voidstar;
+    TM_C_FUNC cfunc;
+  } clone;
+  clone.voidstar = TM_TRANSLATE_CALL((void *)func);
+  TM_EXECUTE_C_RO_INTERNAL(func, args, clone.cfunc);
+}
+
 void TM_EXECUTE(void *flags, std::function<void(TM_OPAQUE *)> func) {
   begin_tx();
   try {
@@ -256,6 +324,29 @@ void TM_EXECUTE(void *flags, std::function<void(TM_OPAQUE *)> func) {
   end_tx();
 }
 
+void TM_EXECUTE_FN(void *flags, void (*func)(void *, TM_OPAQUE *), void *obj) {
+  begin_tx();
+  try {
+    func(obj, (TM_OPAQUE *)0xCAFE);
+  } catch (...) {
+    end_tx();
+    throw;
+  }
+  end_tx();
+}
+
+void TM_EXECUTE_RO_FN(void *flags, void (*func)(void *, TM_OPAQUE *),
+                      void *obj) {
+  begin_tx_ro();
+  try {
+    func(obj, (TM_OPAQUE *)0xCAFE);
+  } catch (...) {
+    end_tx();
+    throw;
+  }
+  end_tx();
+}
+
 // When the plugin cannot statically determine the clone of a function, it
 // replaces the call to the uncloned function with a pair of instructions.  The
 // First is a call to this, which takes as a parameter the address of the
@@ -305,10 +396,15 @@ void TM_REPORT_ALL_STATS() {
   }
 }
 
-bool TM_RAII_BEGIN(jmp_buf & buffer) {
+bool TM_RAII_BEGIN(TM_CHECKPOINT_T &) {
   begin_tx();
   return true;
 }
 
+bool TM_RAII_RO_BEGIN(TM_CHECKPOINT_T &) {
+  begin_tx_ro();
+  return true;
+}
+
 void TM_RAII_END() { end_tx(); }
 }
@@ -0,0 +1,49 @@
+// Test execution of transactions via the C API
+//
+// Here we ensure that TX_BEGIN_C_RO launches the clone through the read-only
+// entry point, rather than serializing.
+
+#ifdef TEST_DRIVER
+#include "../include/harness.h"
+
+int val;
+
+extern "C" {
+int call_it(void *);
+int tx_call_it(void *);
+}
+
+int main() {
+  report<int>("capi_014", "Start read-only transaction from marked C function",
+              {{call_it(nullptr), tx_call_it(nullptr)}},
+              {{TM_STATS_BEGIN_OUTER, 1},
+               {TM_STATS_READONLY, 1},
+               {TM_STATS_LOAD_U4, 1},
+               {TM_STATS_END_OUTER, 1},
+               {TM_STATS_TRANSLATE_FOUND, 0},
+               {TM_STATS_UNSAFE, 0}});
+}
+#endif
+
+#ifdef TEST_OFILE1
+#include "../../../common/tm_api.h"
+extern int val;
+extern "C" {
+TX_SAFE void getval(void *param) { *(int *)param = val; }
+int tx_call_it(void *) {
+  val = 73;
+  int res = 0;
+  TX_BEGIN_C_RO(nullptr, getval, &res);
+  return res;
+}
+int call_it(void *) {
+  val = 73;
+  int res = 0;
+  getval(&res);
+  return res;
+}
+}
+#endif
+
+#ifdef TEST_OFILE2
+#endif
@@ -0,0 +1,46 @@
+// Test execution of transactions via the C API
+//
+// Here we ensure that TX_BEGIN_C uses the read-only entry point when the
+// function, and everything it calls, never writes to shared memory.
+
+#ifdef TEST_DRIVER
+#include "../include/harness.h"
+
+int val;
+
+extern "C" {
+int tx_call_both();
+}
+
+int main() {
+  report<int>("capi_015", "C functions that never write are read-only",
+              {{tx_call_both(), 147}},
+              {{TM_STATS_BEGIN_OUTER, 2},
+               {TM_STATS_READONLY, 1},
+               {TM_STATS_LOAD_U4, 2},
+               {TM_STATS_STORE_U4, 1},
+               {TM_STATS_END_OUTER, 2},
+               {TM_STATS_UNSAFE, 0}});
+}
+#endif
+
+#ifdef TEST_OFILE1
+#include "../../../common/tm_api.h"
+extern int val;
+extern "C" {
+int seen;
+TX_PURE __attribute__((noinline)) void see(int v) { seen = v; }
+__attribute__((noinline)) int getval() { return val; }
+TX_SAFE void readval(void *) { see(getval()); }
+TX_SAFE void incval(void *) { val++; }
+int tx_call_both() {
+  val = 73;
+  TX_BEGIN_C(nullptr, readval, nullptr);
+  TX_BEGIN_C(nullptr, incval, nullptr);
+  return seen + val;
+}
+}
+#endif
+
+#ifdef TEST_OFILE2
+#endif
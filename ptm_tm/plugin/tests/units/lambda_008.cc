@@ -0,0 +1,32 @@
+// Test of C++ lambdas for transaction boundaries
+//
+// TX_BEGIN no longer wraps the lambda in a std::function, but programs that
+// call TM_EXECUTE with a std::function directly should still get boundary
+// instrumentation and an instrumented body
+
+#ifdef TEST_DRIVER
+#include "../include/harness.h"
+int std_function_test();
+int main() {
+  report<int>("lambda_008", "Transaction via std::function is instrumented",
+              {{std_function_test(), 55}}, {{TM_STATS_BEGIN_OUTER, 1},
+              {TM_STATS_END_OUTER, 1},
+              {TM_STATS_UNSAFE, 0},
+              {TM_STATS_LOAD_U4, 1},
+              {TM_STATS_STORE_U4, 1}});
+}
+#endif
+
+#ifdef TEST_OFILE1
+#include "../../../common/tm_api.h"
+int x;
+int std_function_test() {
+  x = 55;
+  int tmp = 0;
+  TM_EXECUTE(nullptr, [&](TM_OPAQUE *) { tmp = x; });
+  return tmp;
+}
+#endif
+
+#ifdef TEST_OFILE2
+#endif
@@ -0,0 +1,37 @@
+// Test of C++ lambdas for transaction boundaries
+//
+// A lambda that never writes to shared memory should begin a read-only
+// transaction, even though it uses TX_BEGIN.  A lambda that writes should not.
+
+#ifdef TEST_DRIVER
+#include "../include/harness.h"
+int inferred_read_only_test();
+int main() {
+  report<int>("lambda_010", "Lambdas that never write are read-only",
+              {{inferred_read_only_test(), 25}}, {{TM_STATS_BEGIN_OUTER, 2},
+              {TM_STATS_END_OUTER, 2},
+              {TM_STATS_READONLY, 1},
+              {TM_STATS_UNSAFE, 0},
+              {TM_STATS_LOAD_U4, 2},
+              {TM_STATS_STORE_U4, 1}});
+}
+#endif
+
+#ifdef TEST_OFILE1
+#include "../../../common/tm_api.h"
+int x;
+int seen;
+// Pure, so its store is not instrumented, and does not make the caller write
+TX_PURE __attribute__((noinline)) void see(int v) { seen = v; }
+int inferred_read_only_test() {
+  x = 12;
+  TX_BEGIN { see(x); }
+  TX_END;
+  TX_BEGIN { x = x + 1; }
+  TX_END;
+  return seen + x;
+}
+#endif
+
+#ifdef TEST_OFILE2
+#endif
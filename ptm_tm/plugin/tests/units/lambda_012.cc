@@ -0,0 +1,34 @@
+// Test of C++ lambdas for transaction boundaries
+//
+// A lambda that only reads shared memory, but returns its result through a
+// captured variable, stores to the frame of the function that launched the
+// transaction.  That store is instrumented, so the lambda is not read-only.
+
+#ifdef TEST_DRIVER
+#include "../include/harness.h"
+int captured_output_test();
+int main() {
+  report<int>("lambda_012", "Lambdas with captured outputs are not read-only",
+              {{captured_output_test(), 12}}, {{TM_STATS_BEGIN_OUTER, 1},
+              {TM_STATS_END_OUTER, 1},
+              {TM_STATS_READONLY, 0},
+              {TM_STATS_UNSAFE, 0},
+              {TM_STATS_LOAD_U4, 1},
+              {TM_STATS_STORE_U4, 1}});
+}
+#endif
+
+#ifdef TEST_OFILE1
+#include "../../../common/tm_api.h"
+int x;
+int captured_output_test() {
+  x = 12;
+  int r = 0;
+  TX_BEGIN { r = x; }
+  TX_END;
+  return r;
+}
+#endif
+
+#ifdef TEST_OFILE2
+#endif
@@ -21,6 +21,12 @@
 // lambda APIs do not need anything special from this file in order to use
 // "lite" mode.
 //
+// Each API also has a read-only variant (TX_BEGIN_C_RO, TX_BEGIN_RO, and
+// TX_RAII_RO), for transactions that the programmer knows will not write to
+// shared memory.  Libraries may run these on a fast path that skips write-set
+// bookkeeping.  A read-only transaction that writes is still correct: the
+// library restarts it as a writer.
+//
 // All of the APIs benefit from the following common calls:
 //
 // - TX_SAFE:                 Indicate that a function is always safe to call
@@ -46,7 +52,7 @@
 #pragma once
 
 #include <functional>
-#include <setjmp.h>
+#include <type_traits>
 
 #include "tm_defines.h"
 
@@ -127,9 +133,17 @@ void TM_COMMIT_HANDLER(TM_C_FUNC, void *args);
 //           (4-parameter) function for launching code with TM
 #define TX_BEGIN_C(flags, func, params) TM_EXECUTE_C(flags, (func), (params))
 
+// Public:   TX_BEGIN_C_RO is the same as TX_BEGIN_C, except that the function
+//           should not write to shared memory
+//
+// Internal: The plugin transforms TM_EXECUTE_C_RO into TM_EXECUTE_C_RO_INTERNAL
+#define TX_BEGIN_C_RO(flags, func, params)                                     \
+  TM_EXECUTE_C_RO(flags, (func), (params))
+
 // The C API requires these delcarations
 extern "C" {
 void TM_EXECUTE_C(void *flags, TM_C_FUNC, void *args);
+void TM_EXECUTE_C_RO(void *flags, TM_C_FUNC, void *args);
 }
 
 //
@@ -153,41 +167,87 @@ void TM_EXECUTE_C(void *flags, TM_C_FUNC, void *args);
 //           } TX_END;
 //
 // Internal: The body of the lambda will be transformed so that it has both
-//           instrumented and uninstrumented code paths
-#define TX_BEGIN TM_EXECUTE(nullptr, [&](TM_OPAQUE*)
+//           instrumented and uninstrumented code paths.  The lambda is not
+//           wrapped in a std::function: TM_EXECUTE_T passes it to the library
+//           by address, along with a thunk that calls it directly.
+#define TX_BEGIN TM_EXECUTE_T(nullptr, [&](TM_OPAQUE*)
 #define TX_END   )
 
-// The lambda API requires these declarations
+// Public:   TX_BEGIN_RO is the same as TX_BEGIN, except that the region should
+//           not write to shared memory.  It also ends with TX_END.
+//
+// Internal: TM_EXECUTE_RO_T passes the lambda to TM_EXECUTE_RO_FN
+#define TX_BEGIN_RO TM_EXECUTE_RO_T(nullptr, [&](TM_OPAQUE*)
+
+// The lambda API requires these declarations.  TM_EXECUTE is the original
+// entry point, which takes a std::function.  It is still supported, but it
+// costs a type-erased call (and perhaps a heap allocation) per transaction.
 extern "C" {
 void TM_EXECUTE(void *flags, std::function<void(TM_OPAQUE *)> func);
+void TM_EXECUTE_FN(void *flags, void (*func)(void *, TM_OPAQUE *), void *obj);
+void TM_EXECUTE_RO_FN(void *flags, void (*func)(void *, TM_OPAQUE *),
+                      void *obj);
+}
+
+// Internal: TM_LAMBDA_THUNK is instantiated once per lambda type, and calls the
+//           lambda directly, so its body is visible to the optimizer.  Since it
+//           has the same (object, TM_OPAQUE*) signature as the lambda, the
+//           plugin treats it like a lambda: it gets a clone, and a prologue
+//           that calls the clone when there is a transaction descriptor.
+template <typename F> void TM_LAMBDA_THUNK(void *obj, TM_OPAQUE *desc) {
+  (*static_cast<F *>(obj))(desc);
+}
+
+// Internal: TM_EXECUTE_T launches a lambda via TM_EXECUTE_FN.  It is pure, so
+//           that a nested TX_BEGIN does not need a clone of it.
+template <typename F> TX_PURE void TM_EXECUTE_T(void *flags, F &&func) {
+  typedef typename std::remove_reference<F>::type lambda_t;
+  TM_EXECUTE_FN(flags, TM_LAMBDA_THUNK<lambda_t>, (void *)&func);
+}
+
+// Internal: TM_EXECUTE_RO_T is the read-only version of TM_EXECUTE_T
+template <typename F> TX_PURE void TM_EXECUTE_RO_T(void *flags, F &&func) {
+  typedef typename std::remove_reference<F>::type lambda_t;
+  TM_EXECUTE_RO_FN(flags, TM_LAMBDA_THUNK<lambda_t>, (void *)&func);
 }
 
 //
 // The mechanism used by the RAII API for launching a transaction is a
 // stack-constructed object that initializes the transaction upon construction,
 // and commits it upon destruction.  To get it all to work correctly, we need to
-// setjmp /before/ we construct the object, so we hide the setjmp and
-// constructor in a macro.
+// checkpoint the registers /before/ we construct the object, so we hide the
+// checkpoint and constructor in a macro.
 //
 
 // Public:   To execute a region of C++ code as a transaction, checkpoint the
-//           thread's architectural state with a setjmp, then pass the jmp_buf
-//           to the constructor for the transaction object.  The programmer
-//           needs to be sure to do the scoping correctly: this macro should be
-//           the first code after an open brace.
+//           thread's architectural state with TM_CHECKPOINT, then pass the
+//           checkpoint to the constructor for the transaction object.  The
+//           programmer needs to be sure to do the scoping correctly: this macro
+//           should be the first code after an open brace.  Use TX_RAII_RO for
+//           regions that should not write to shared memory.
 //
 // Internal: The control flow subgraph in which the RAII object is live will be
-//           transformed.
+//           transformed.  Both macros use the same constructor, so that the
+//           plugin sees the same boundaries.  Its last argument says whether
+//           the region is read-only.
 #if !defined(TM_USE_RAII_LITE)
 #define TX_RAII                                                                \
-  jmp_buf TM_RAII_JMPBUF;                                                      \
-  setjmp(TM_RAII_JMPBUF);                                                      \
+  TM_CHECKPOINT_T TM_RAII_CHECKPOINT;                                          \
+  TM_CHECKPOINT(&TM_RAII_CHECKPOINT);                                          \
+  bool TM_RAII_TXSTATE;                                                        \
+  TM_RAII tx(TM_RAII_TXSTATE, TM_RAII_CHECKPOINT, false)
+#define TX_RAII_RO                                                             \
+  TM_CHECKPOINT_T TM_RAII_CHECKPOINT;                                          \
+  TM_CHECKPOINT(&TM_RAII_CHECKPOINT);                                          \
   bool TM_RAII_TXSTATE;                                                        \
-  TM_RAII tx(TM_RAII_TXSTATE, TM_RAII_JMPBUF)
+  TM_RAII tx(TM_RAII_TXSTATE, TM_RAII_CHECKPOINT, true)
 
-// The RAII API requires these function declarations
+// The RAII API requires these function declarations.  Like setjmp, the
+// checkpoint returns a second time when a transaction restarts.
 extern "C" {
-bool TM_RAII_BEGIN(jmp_buf &);
+__attribute__((returns_twice)) int TM_CHECKPOINT(TM_CHECKPOINT_T *);
+bool TM_RAII_BEGIN(TM_CHECKPOINT_T &);
+bool TM_RAII_RO_BEGIN(TM_CHECKPOINT_T &);
 void TM_RAII_END();
 }
 
@@ -195,8 +255,8 @@ void TM_RAII_END();
 //
 // Internal: N/A
 struct TM_RAII {
-  TM_RAII(bool &take_inst, jmp_buf &buffer) {
-    take_inst = TM_RAII_BEGIN(buffer);
+  TM_RAII(bool &take_inst, TM_CHECKPOINT_T &buffer, bool read_only) {
+    take_inst = read_only ? TM_RAII_RO_BEGIN(buffer) : TM_RAII_BEGIN(buffer);
   }
   ~TM_RAII() { TM_RAII_END(); }
 };
@@ -205,6 +265,7 @@ struct TM_RAII {
 #define TX_RAII                                                                \
   bool TM_RAII_TXSTATE;                                                        \
   TM_RAII tx(TM_RAII_TXSTATE)
+#define TX_RAII_RO TX_RAII
 
 // The RAII_LITE API requires these function declarations
 extern "C" {
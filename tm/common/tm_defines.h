@@ -29,6 +29,21 @@
 #define TM_EXECUTE tm_execute
 #define TM_EXECUTE_STR "tm_execute"
 
+// The function that executes an instrumented region via the C++ "lambda" API,
+// when the lambda is passed as an object and a function that invokes it,
+// instead of as a std::function
+#define TM_EXECUTE_FN tm_execute_fn
+#define TM_EXECUTE_FN_STR "tm_execute_fn"
+
+// The functions that execute instrumented regions that will not write to
+// shared memory.  They correspond to TM_EXECUTE_C and TM_EXECUTE_FN, and let
+// the library use a read-only fast path.  If the region writes anyway, the
+// library restarts it as a writer.
+#define TM_EXECUTE_C_RO tm_execute_c_ro
+#define TM_EXECUTE_C_RO_STR "tm_execute_c_ro"
+#define TM_EXECUTE_RO_FN tm_execute_ro_fn
+#define TM_EXECUTE_RO_FN_STR "tm_execute_ro_fn"
+
 // The RAII class that executes an instrumented region via the C++ "raii" API
 #define TM_RAII tm_raii
 #define TM_RAII_STR "tm_raii"
@@ -71,6 +86,11 @@ typedef void (*TM_C_FUNC)(void *);
 #define TM_EXECUTE_C_INTERNAL tm_execute_c_internal
 #define TM_EXECUTE_C_INTERNAL_STR "tm_execute_c_internal"
 
+// The read-only version of TM_EXECUTE_C_INTERNAL, which the plugin uses in
+// place of TM_EXECUTE_C_RO
+#define TM_EXECUTE_C_RO_INTERNAL tm_execute_c_ro_internal
+#define TM_EXECUTE_C_RO_INTERNAL_STR "tm_execute_c_ro_internal"
+
 // The library will implement these memory access functions, and the plugin
 // will replace loads and stores with calls to these functions.
 #define TM_LOAD_U1 tm_load_u1
@@ -106,6 +126,43 @@ typedef void (*TM_C_FUNC)(void *);
 #define TM_STORE_P tm_store_p
 #define TM_STORE_P_STR "tm_store_p"
 
+// The library will also implement versions of the memory access functions that
+// take the transaction descriptor as their first argument.  Clones receive the
+// descriptor as a hidden last parameter, and pass it to these functions, so
+// that instrumented accesses do not need to look up the descriptor in TLS.
+#define TM_LOAD_U1_DESC tm_load_u1_desc
+#define TM_LOAD_U1_DESC_STR "tm_load_u1_desc"
+#define TM_STORE_U1_DESC tm_store_u1_desc
+#define TM_STORE_U1_DESC_STR "tm_store_u1_desc"
+#define TM_LOAD_U2_DESC tm_load_u2_desc
+#define TM_LOAD_U2_DESC_STR "tm_load_u2_desc"
+#define TM_STORE_U2_DESC tm_store_u2_desc
+#define TM_STORE_U2_DESC_STR "tm_store_u2_desc"
+#define TM_LOAD_U4_DESC tm_load_u4_desc
+#define TM_LOAD_U4_DESC_STR "tm_load_u4_desc"
+#define TM_STORE_U4_DESC tm_store_u4_desc
+#define TM_STORE_U4_DESC_STR "tm_store_u4_desc"
+#define TM_LOAD_U8_DESC tm_load_u8_desc
+#define TM_LOAD_U8_DESC_STR "tm_load_u8_desc"
+#define TM_STORE_U8_DESC tm_store_u8_desc
+#define TM_STORE_U8_DESC_STR "tm_store_u8_desc"
+#define TM_LOAD_F_DESC tm_load_f_desc
+#define TM_LOAD_F_DESC_STR "tm_load_f_desc"
+#define TM_STORE_F_DESC tm_store_f_desc
+#define TM_STORE_F_DESC_STR "tm_store_f_desc"
+#define TM_LOAD_D_DESC tm_load_d_desc
+#define TM_LOAD_D_DESC_STR "tm_load_d_desc"
+#define TM_STORE_D_DESC tm_store_d_desc
+#define TM_STORE_D_DESC_STR "tm_store_d_desc"
+#define TM_LOAD_LD_DESC tm_load_ld_desc
+#define TM_LOAD_LD_DESC_STR "tm_load_ld_desc"
+#define TM_STORE_LD_DESC tm_store_ld_desc
+#define TM_STORE_LD_DESC_STR "tm_store_ld_desc"
+#define TM_LOAD_P_DESC tm_load_p_desc
+#define TM_LOAD_P_DESC_STR "tm_load_p_desc"
+#define TM_STORE_P_DESC tm_store_p_desc
+#define TM_STORE_P_DESC_STR "tm_store_p_desc"
+
 // The library will implement these functions, and the plugin will
 // replace calls to malloc and free and memory intrinsic with calls to these
 // functions
@@ -128,13 +185,33 @@ typedef void (*TM_C_FUNC)(void *);
 #define TM_UNSAFE_STR "tm_unsafe"
 #define TM_TRANSLATE_CALL tm_translate_call
 #define TM_TRANSLATE_CALL_STR "tm_translate_call"
-#define TM_RAII_CTOR "_ZN7" TM_RAII_STR "C2ERbRA1_13__jmp_buf_tag"
+#define TM_GET_DESCRIPTOR tm_get_descriptor
+#define TM_GET_DESCRIPTOR_STR "tm_get_descriptor"
+// WARNING: the "15" in the mangled constructor name assumes the length of
+//          TM_CHECKPOINT_T_STR.  The trailing "b" is the read-only flag.
+#define TM_RAII_CTOR "_ZN7" TM_RAII_STR "C2ERbR15" TM_CHECKPOINT_T_STR "b"
 #define TM_RAII_DTOR "_ZN7" TM_RAII_STR "D2Ev"
 
 // The library will need to work with these functions
 #define TM_SETJUMP_NAME "_setjmp"
+#define TM_CHECKPOINT tm_checkpoint
+#define TM_CHECKPOINT_STR "tm_checkpoint"
 #define TM_LAMBDA_BASE_NAME "_ZNSt14_Function_baseD2Ev"
 
+// The registers that a transaction saves when it begins, so that it can restart
+// after an abort.  The library saves them via TM_CHECKPOINT, which returns a
+// second time when the library restores them.  The RAII API also calls
+// TM_CHECKPOINT, from application code.
+//
+// NB: The layout is fixed by the assembly in libs/common/checkpoint.h: rbx,
+//     rbp, r12, r13, r14, r15, the caller's stack pointer, and the return
+//     address
+#define TM_CHECKPOINT_T tm_checkpoint_t
+#define TM_CHECKPOINT_T_STR "tm_checkpoint_t"
+struct TM_CHECKPOINT_T {
+  void *regs[8];
+};
+
 //
 // These definitions are only used by the plugin
 //
@@ -159,8 +236,21 @@ struct TM_OPAQUE;
 // the programmer
 //
 
-// The name of a setjmp buffer created as part of the RAII API
-#define TM_RAII_JMPBUF tm_raii_jmp_buf
+// The template that the lambda API uses to launch a lambda without wrapping it
+// in a std::function
+#define TM_EXECUTE_T tm_execute_t
+#define TM_EXECUTE_T_STR "tm_execute_t"
+
+// The template that the lambda API uses to launch a read-only lambda
+#define TM_EXECUTE_RO_T tm_execute_ro_t
+#define TM_EXECUTE_RO_T_STR "tm_execute_ro_t"
+
+// The template that instantiates, for each lambda type, the function that
+// TM_EXECUTE_FN uses to invoke the lambda
+#define TM_LAMBDA_THUNK tm_lambda_thunk
+
+// The name of a checkpoint created as part of the RAII API
+#define TM_RAII_CHECKPOINT tm_raii_checkpoint
 
 // The name of a bool that tracks the instrumentation state in the RAII API
 #define TM_RAII_TXSTATE tm_raii_should_run_instrumented
@@ -168,6 +258,9 @@ struct TM_OPAQUE;
 // The function called by the RAII API to start a transaction
 #define TM_RAII_BEGIN tm_raii_begin
 
+// The function called by the RAII API to start a read-only transaction
+#define TM_RAII_RO_BEGIN tm_raii_ro_begin
+
 // The function called by the RAII API to end a transaction
 #define TM_RAII_END tm_raii_end
 
@@ -7,6 +7,9 @@
 
 #include <unordered_map>
 
+#include "../common/clone_table.h"
+#include "constants.h"
+
 namespace {
 /// The function pointer translation table that TM manipulates in order to track
 /// mappings from functions to their clones
@@ -27,12 +30,20 @@ namespace {
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wunused-variable"
 std::unordered_map<void *, void *> *clone_table;
+
+/// The function pointer translation table for API_TM_CLONES_CONCURRENT.  It can
+/// be updated (e.g., by a shared object that dlopen loads) while transactions
+/// are using it.
+CloneTable concurrent_clone_table;
 #pragma clang diagnostic pop
 
-/// Perform a lookup in the clone_table: if a clone is not found, return nullptr
+/// Perform a lookup in whichever clone table is in use: if a clone is not
+/// found, return nullptr
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wunused-function"
 void *get_clone(void *func) {
+  if (clone_table == nullptr)
+    return concurrent_clone_table.find(func);
   auto found = clone_table->find(func);
   if (found != clone_table->end())
     return found->second;
@@ -65,6 +76,30 @@ void *get_clone(void *func) {
   }                                                                            \
   }
 
+/// Create the API functions that are used for interacting with the clone table,
+/// in a way that is safe when shared objects register clones while
+/// transactions are running.  TM_TRANSLATE_CALL first checks a small
+/// per-thread cache, so that hot indirect call sites rarely reach the shared
+/// table.
+#define API_TM_CLONES_CONCURRENT                                               \
+  namespace {                                                                  \
+  thread_local CloneCache<CLONE_CACHE_SIZE> clone_cache;                       \
+  }                                                                            \
+  extern "C" {                                                                 \
+  void TM_REG_CLONE(void *from, void *to) {                                    \
+    concurrent_clone_table.insert(from, to);                                   \
+  }                                                                            \
+  void TM_UNSAFE() { get_self()->becomeIrrevocable(); }                        \
+  void *TM_TRANSLATE_CALL(void *func) {                                        \
+    void *clone = clone_cache.get(concurrent_clone_table, func);               \
+    if (clone == nullptr) {                                                    \
+      TM_UNSAFE();                                                             \
+      return func;                                                             \
+    }                                                                          \
+    return clone;                                                              \
+  }                                                                            \
+  }
+
 /// Create the API functions that are used for interacting with a nonexistent
 /// clone table.  This is specifically for single-lock TMs, like MUTEX, which
 /// are always irrevocable, or HTM-only TMs.
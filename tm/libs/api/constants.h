@@ -8,12 +8,17 @@
 
 #include <cstdint>
 
+#include "../common/stats.h"
+
 /// log_2 of the number of bytes protected by an orec
 const int OREC_COVERAGE = 4;
 
 /// Quiescence benefits from a limit on the number of threads.  4096 is safe
 const int MAX_THREADS = 4096;
 
+/// The largest number of sockets that a distributed clock keeps counters for
+const int MAX_SOCKETS = 8;
+
 /// The number of orecs in the system
 const uint32_t NUM_STRIPES = 1048576;
 
@@ -27,10 +32,26 @@ const uint32_t BACKOFF_MAX = 16;
 /// become irrevocable.
 const uint32_t ABORTS_THRESHOLD = 100;
 
+/// The number of writes after which a transaction becomes greedy in the
+/// two-phase contention manager (SwissTM's Wn)
+const int TWOPHASE_CM_WRITES = 10;
+
 /// A threshold for the number of mallocs in a transaction before it should
 /// become irrevocable
 const uint32_t MALLOC_THRESHOLD = 128;
 
+/// The number of freed blocks of each size class that a thread caches for
+/// reuse by its transactional mallocs
+const int SLAB_CACHE_SIZE = 256;
+
+/// The number of freed blocks that a thread collects before it tries to
+/// recycle them
+const int SLAB_LIMBO_SIZE = 128;
+
+/// The number of entries in the filter that a deduplicating read set uses to
+/// avoid logging the same orec twice
+const int READSET_FILTER_SIZE = 1024;
+
 /// Our default bytelock implementation constrains to one cache line, with an
 /// 8-byte owner field, leaving 56 slots for readers
 const int BYTELOCK_MAX_THREADS = 56;
@@ -54,14 +75,46 @@ const int32_t TLRW_WRITE_SPINS = 2048;
 /// Number of times an HTM transaction aborts before switching to serial
 const int32_t NUM_HTM_RETRIES = 8;
 
+/// The number of entries in each thread's cache of the clone table
+const int CLONE_CACHE_SIZE = 64;
+
 /// RingSTM Ring Size: number of filters in the ring
 const int32_t RING_SIZE = 1024;
 
 /// RingSTM: Number of bits in a filter
 const int32_t RING_FILTER_SIZE = 1024;
 
+/// RingSTM: Number of bits in a filter, for rings that use wide (AVX2/AVX-512)
+/// filters
+const int32_t RING_WIDE_FILTER_SIZE = 4096;
+
 /// RingSTM: Granularity of regions that map to ring bits
 const int32_t RING_COVERAGE = 5;
 
 /// Reduced Hardware NOrec: how many postfix fails before fallback to STM
-const int32_t NUM_POSTFIX_RETRIES = 8;
\ No newline at end of file
+const int32_t NUM_POSTFIX_RETRIES = 8;
+
+/// Adaptive: number of commits between decisions about switching algorithms
+const int32_t ADAPT_INTERVAL = 1 << 16;
+
+/// Adaptive: number of commits a thread batches before publishing them
+const int32_t ADAPT_BATCH = 64;
+
+/// Adaptive: number of intervals to stay with the best algorithm before
+/// measuring the others again
+const int32_t ADAPT_EXPLOIT = 16;
+
+/// Statistics: number of slots in each thread's histogram of conflicting orecs
+const int32_t STATS_HOT_SLOTS = 256;
+
+/// Statistics: number of conflicting orecs to print in a report
+const int32_t STATS_TOP_ORECS = 10;
+
+/// Per-thread statistics are compiled out unless the libraries are built with
+/// TM_STATS defined to a nonzero value (e.g., via `make STATS=1`)
+#if TM_STATS
+typedef CountingStats<MAX_THREADS, STATS_HOT_SLOTS, STATS_TOP_ORECS>
+    DefaultStats;
+#else
+typedef NoopStats DefaultStats;
+#endif
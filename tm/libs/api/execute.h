@@ -4,21 +4,111 @@
 #pragma once
 
 #include <functional>
-#include <setjmp.h>
+#include <mutex>
+#include <pthread.h>
+#include <vector>
 
 #include "../../common/tm_defines.h"
+#include "../common/checkpoint.h"
+
+/// Clones that the plugin creates take the transaction descriptor as a hidden
+/// last parameter, so the C API passes it when it calls a clone.  The lambda
+/// API passes it as the lambda's TM_OPAQUE* parameter.
+typedef void (*tm_c_clone_t)(void *, TM_OPAQUE *);
+
+/// Begin a read-only transaction.  Algorithms with a read-only fast path take
+/// a second argument to beginTx(); the rest run read-only transactions just
+/// like writers.
+template <class T>
+auto beginTxRO(T *self, checkpoint_t *b, int)
+    -> decltype(self->beginTx(b, true)) {
+  self->beginTx(b, true);
+}
+template <class T> void beginTxRO(T *self, checkpoint_t *b, long) {
+  self->beginTx(b);
+}
+
+/// Create the read-only versions of the API functions that launch
+/// transactions, for libraries that do not treat read-only transactions
+/// specially.  These must appear after the read/write versions.
+#define API_TM_EXECUTE_RO_AS_RW                                                \
+  void TM_EXECUTE_C_RO_INTERNAL(void (*func)(void *), void *args,              \
+                                tm_c_clone_t anno_func) {                      \
+    TM_EXECUTE_C_INTERNAL(func, args, anno_func);                              \
+  }                                                                            \
+  void TM_EXECUTE_C_RO(void *flags, void (*func)(void *), void *args) {        \
+    TM_EXECUTE_C(flags, func, args);                                           \
+  }                                                                            \
+  void TM_EXECUTE_RO_FN(void *flags, void (*func)(void *, TM_OPAQUE *),        \
+                        void *obj) {                                           \
+    TM_EXECUTE_FN(flags, func, obj);                                           \
+  }                                                                            \
+  bool TM_RAII_RO_BEGIN(checkpoint_t &buffer) { return TM_RAII_BEGIN(buffer); }
 
 /// Create helper methods that create a thread-local pointer to the TxThread,
-/// and help a caller to get/construct one
+/// and help a caller to get/construct one.
+///
+/// When a thread exits, its descriptor is put in a pool, and a new thread takes
+/// a descriptor from the pool before it constructs one.  A pooled descriptor
+/// keeps its ID, its logs' buffers, and its statistics, so programs that churn
+/// through threads neither leak descriptors nor pay to rebuild them.  While it
+/// is pooled, the descriptor is parked: epoch scans skip its ID, and it has
+/// forgotten the old thread's stack bottom.  It is unparked when a new thread
+/// takes it.
+///
+/// The descriptor is returned by a pthread key destructor rather than a
+/// thread_local destructor: glibc runs key destructors after all thread_local
+/// destructors, so a thread_local destructor that runs a transaction still
+/// finds the descriptor, and if a later key destructor runs a transaction, it
+/// takes a descriptor from the pool and sets the key again, which makes glibc
+/// call the reclaimer again.  The pointer is a separate (trivial) thread_local,
+/// so that the fast path of get_self() does not pay for any of this.
 #define API_TM_DESCRIPTOR                                                      \
   namespace {                                                                  \
   thread_local TxThread *self = nullptr;                                       \
+  struct DescriptorPool {                                                      \
+    std::mutex lock;                                                           \
+    std::vector<TxThread *> free;                                              \
+    pthread_key_t key;                                                         \
+    DescriptorPool() { pthread_key_create(&key, reclaim); }                    \
+    static DescriptorPool &get() {                                             \
+      /* never destroyed, since threads may exit after main() */               \
+      static DescriptorPool *pool = new DescriptorPool();                      \
+      return *pool;                                                            \
+    }                                                                          \
+    static void reclaim(void *desc) {                                          \
+      DescriptorPool &pool = get();                                            \
+      std::lock_guard<std::mutex> guard(pool.lock);                            \
+      ((TxThread *)desc)->park();                                              \
+      pool.free.push_back((TxThread *)desc);                                   \
+      self = nullptr;                                                          \
+    }                                                                          \
+  };                                                                           \
+  __attribute__((noinline)) TxThread *new_self() {                             \
+    DescriptorPool &pool = DescriptorPool::get();                              \
+    {                                                                          \
+      std::lock_guard<std::mutex> guard(pool.lock);                            \
+      if (!pool.free.empty()) {                                                \
+        self = pool.free.back();                                               \
+        pool.free.pop_back();                                                  \
+        self->unpark();                                                        \
+      }                                                                        \
+    }                                                                          \
+    if (self == nullptr) {                                                     \
+      self = new TxThread();                                                   \
+    }                                                                          \
+    pthread_setspecific(pool.key, self);                                       \
+    return self;                                                               \
+  }                                                                            \
   static TxThread *get_self() {                                                \
     if (__builtin_expect(self == nullptr, false)) {                            \
-      self = new TxThread();                                                   \
+      return new_self();                                                       \
     }                                                                          \
     return self;                                                               \
   }                                                                            \
+  }                                                                            \
+  extern "C" {                                                                 \
+  TM_OPAQUE *TM_GET_DESCRIPTOR() { return (TM_OPAQUE *)get_self(); }           \
   }
 
 /// Create the API functions that are used to launch transactions.  These are
@@ -29,49 +119,61 @@
 /// EXECUTE_C is for when the compiler could not find a clone at compile time,
 /// and needs to do the lookup at run time.  EXECUTE is for the C++ API, which
 /// always uses a lambda, and thus doesn't need to worry about lookup.
+/// EXECUTE_FN is also for the C++ API, but receives the lambda as an object and
+/// a thunk that calls it, so that there is no std::function in the way.  The
+/// _RO versions begin read-only transactions.
 #define API_TM_EXECUTE_NOEXCEPT                                                \
   extern "C" {                                                                 \
   void TM_EXECUTE_C_INTERNAL(void (*)(void *), void *args,                     \
-                             void (*anno_func)(void *)) {                      \
+                             tm_c_clone_t anno_func) {                         \
     /* get TxThread before making checkpoint, so it doesn't re-run on abort */ \
     TxThread *self = get_self();                                               \
-    jmp_buf _jmpbuf;                                                           \
-    setjmp(_jmpbuf);                                                           \
-    self->beginTx(&_jmpbuf);                                                   \
-    anno_func(args);                                                           \
+    checkpoint_t _checkpoint;                                                  \
+    TM_CHECKPOINT(&_checkpoint);                                               \
+    self->beginTx(&_checkpoint);                                               \
+    anno_func(args, (TM_OPAQUE *)self);                                        \
     self->commitTx();                                                          \
   }                                                                            \
   void TM_EXECUTE_C(void *, void (*func)(void *), void *args) {                \
     /* casting function ptr to void* is illegal, but it works on x86 */        \
     union {                                                                    \
       void *voidstar;                                                          \
-      TM_C_FUNC cfunc;                                                         \
+      tm_c_clone_t cfunc;                                                      \
     } clone;                                                                   \
     clone.voidstar = get_clone((void *)func);                                  \
     /* get TxThread before making checkpoint, so it doesn't re-run on abort */ \
     TxThread *self = get_self();                                               \
-    jmp_buf _jmpbuf;                                                           \
-    setjmp(_jmpbuf);                                                           \
-    self->beginTx(&_jmpbuf);                                                   \
+    checkpoint_t _checkpoint;                                                  \
+    TM_CHECKPOINT(&_checkpoint);                                               \
+    self->beginTx(&_checkpoint);                                               \
     /* If no clone, become irrevocable */                                      \
     if (clone.voidstar == nullptr) {                                           \
       self->becomeIrrevocable();                                               \
       func(args);                                                              \
     } else {                                                                   \
-      clone.cfunc(args);                                                       \
+      clone.cfunc(args, (TM_OPAQUE *)self);                                    \
     }                                                                          \
     self->commitTx();                                                          \
   }                                                                            \
   void TM_EXECUTE(void *, std::function<void(TM_OPAQUE *)> func) {             \
     /* get TxThread before making checkpoint, so it doesn't re-run on abort */ \
     TxThread *self = get_self();                                               \
-    jmp_buf _jmpbuf;                                                           \
-    setjmp(_jmpbuf);                                                           \
-    self->beginTx(&_jmpbuf);                                                   \
-    func((TM_OPAQUE *)0xCAFE);                                                 \
+    checkpoint_t _checkpoint;                                                  \
+    TM_CHECKPOINT(&_checkpoint);                                               \
+    self->beginTx(&_checkpoint);                                               \
+    func((TM_OPAQUE *)self);                                                   \
+    self->commitTx();                                                          \
+  }                                                                            \
+  void TM_EXECUTE_FN(void *, void (*func)(void *, TM_OPAQUE *), void *obj) {   \
+    /* get TxThread before making checkpoint, so it doesn't re-run on abort */ \
+    TxThread *self = get_self();                                               \
+    checkpoint_t _checkpoint;                                                  \
+    TM_CHECKPOINT(&_checkpoint);                                               \
+    self->beginTx(&_checkpoint);                                               \
+    func(obj, (TM_OPAQUE *)self);                                              \
     self->commitTx();                                                          \
   }                                                                            \
-  bool TM_RAII_BEGIN(jmp_buf &buffer) {                                        \
+  bool TM_RAII_BEGIN(checkpoint_t &buffer) {                                   \
     TxThread *self = get_self();                                               \
     self->beginTx(&buffer);                                                    \
     return true;                                                               \
@@ -80,6 +182,44 @@
     TxThread *self = get_self();                                               \
     self->commitTx();                                                          \
   }                                                                            \
+  void TM_EXECUTE_C_RO_INTERNAL(void (*)(void *), void *args,                  \
+                                tm_c_clone_t anno_func) {                      \
+    /* get TxThread before making checkpoint, so it doesn't re-run on abort */ \
+    TxThread *self = get_self();                                               \
+    checkpoint_t _checkpoint;                                                  \
+    TM_CHECKPOINT(&_checkpoint);                                               \
+    beginTxRO(self, &_checkpoint, 0);                                          \
+    anno_func(args, (TM_OPAQUE *)self);                                        \
+    self->commitTx();                                                          \
+  }                                                                            \
+  void TM_EXECUTE_C_RO(void *flags, void (*func)(void *), void *args) {        \
+    /* casting function ptr to void* is illegal, but it works on x86 */        \
+    union {                                                                    \
+      void *voidstar;                                                          \
+      tm_c_clone_t cfunc;                                                      \
+    } clone;                                                                   \
+    clone.voidstar = get_clone((void *)func);                                  \
+    /* If no clone, run as a writer, which knows what to do */                 \
+    if (clone.voidstar == nullptr)                                             \
+      TM_EXECUTE_C(flags, func, args);                                         \
+    else                                                                       \
+      TM_EXECUTE_C_RO_INTERNAL(func, args, clone.cfunc);                       \
+  }                                                                            \
+  void TM_EXECUTE_RO_FN(void *, void (*func)(void *, TM_OPAQUE *),             \
+                        void *obj) {                                           \
+    /* get TxThread before making checkpoint, so it doesn't re-run on abort */ \
+    TxThread *self = get_self();                                               \
+    checkpoint_t _checkpoint;                                                  \
+    TM_CHECKPOINT(&_checkpoint);                                               \
+    beginTxRO(self, &_checkpoint, 0);                                          \
+    func(obj, (TM_OPAQUE *)self);                                              \
+    self->commitTx();                                                          \
+  }                                                                            \
+  bool TM_RAII_RO_BEGIN(checkpoint_t &buffer) {                                \
+    TxThread *self = get_self();                                               \
+    beginTxRO(self, &buffer, 0);                                               \
+    return true;                                                               \
+  }                                                                            \
   }
 
 /// Create the API functions that are used to launch transactions.  These are
@@ -87,7 +227,7 @@
 #define API_TM_EXECUTE_NOEXCEPT_NOINST                                         \
   extern "C" {                                                                 \
   void TM_EXECUTE_C_INTERNAL(void (*func)(void *), void *args,                 \
-                             void (*)(void *)) {                               \
+                             tm_c_clone_t) {                                   \
     /* get TxThread before making checkpoint, so it doesn't re-run on abort */ \
     TxThread *self = get_self();                                               \
     self->beginTx();                                                           \
@@ -108,12 +248,19 @@
     func(0);                                                                   \
     self->commitTx();                                                          \
   }                                                                            \
+  void TM_EXECUTE_FN(void *, void (*func)(void *, TM_OPAQUE *), void *obj) {   \
+    /* get TxThread before making checkpoint, so it doesn't re-run on abort */ \
+    TxThread *self = get_self();                                               \
+    self->beginTx();                                                           \
+    func(obj, 0);                                                              \
+    self->commitTx();                                                          \
+  }                                                                            \
   void TM_RAII_LITE_BEGIN() {                                                  \
     TxThread *self = get_self();                                               \
     self->beginTx();                                                           \
   }                                                                            \
   void TM_RAII_LITE_END() { self->commitTx(); }                                \
-  bool TM_RAII_BEGIN(jmp_buf &) {                                              \
+  bool TM_RAII_BEGIN(checkpoint_t &) {                                         \
     TxThread *self = get_self();                                               \
     self->beginTx();                                                           \
     return false;                                                              \
@@ -122,6 +269,7 @@
     TxThread *self = get_self();                                               \
     self->commitTx();                                                          \
   }                                                                            \
+  API_TM_EXECUTE_RO_AS_RW                                                      \
   }
 
 /// Create the API functions that are used to launch hybrid transactions.  These
@@ -130,21 +278,21 @@
 /// aren't concerned about the TM aborting and needing a checkpoint to restore.
 ///
 /// The main difference versus the code above is that begin() is split, based on
-/// whether we are trying to begin in HTM (without a setjmp first) or not
+/// whether we are trying to begin in HTM (without a checkpoint first) or not
 #define API_TM_EXECUTE_HYBRID                                                  \
   extern "C" {                                                                 \
   void TM_EXECUTE_C_INTERNAL(void (*func)(void *), void *args,                 \
-                             void (*anno_func)(void *)) {                      \
+                             tm_c_clone_t anno_func) {                         \
     /* get TxThread before making checkpoint, so it doesn't re-run on abort */ \
     TxThread *self = get_self();                                               \
     if (self->beginHTM()) { /* Try to run as HTM */                            \
       func(nullptr);                                                           \
       self->commitTx();                                                        \
     } else {                                                                   \
-      jmp_buf _jmpbuf;                                                         \
-      setjmp(_jmpbuf);                                                         \
-      self->beginSTM(&_jmpbuf);                                                \
-      anno_func(args);                                                         \
+      checkpoint_t _checkpoint;                                                \
+      TM_CHECKPOINT(&_checkpoint);                                             \
+      self->beginSTM(&_checkpoint);                                            \
+      anno_func(args, (TM_OPAQUE *)self);                                      \
       self->commitTx();                                                        \
     }                                                                          \
   }                                                                            \
@@ -159,18 +307,18 @@
     /* casting function ptr to void* is illegal, but it works on x86 */        \
     union {                                                                    \
       void *voidstar;                                                          \
-      TM_C_FUNC cfunc;                                                         \
+      tm_c_clone_t cfunc;                                                      \
     } clone;                                                                   \
     clone.voidstar = get_clone((void *)func);                                  \
-    jmp_buf _jmpbuf;                                                           \
-    setjmp(_jmpbuf);                                                           \
-    self->beginSTM(&_jmpbuf);                                                  \
+    checkpoint_t _checkpoint;                                                  \
+    TM_CHECKPOINT(&_checkpoint);                                               \
+    self->beginSTM(&_checkpoint);                                              \
     /* If no clone, become irrevocable */                                      \
     if (clone.voidstar == nullptr) {                                           \
       self->becomeIrrevocable();                                               \
       func(args);                                                              \
     } else {                                                                   \
-      clone.cfunc(args);                                                       \
+      clone.cfunc(args, (TM_OPAQUE *)self);                                    \
     }                                                                          \
     self->commitTx();                                                          \
   }                                                                            \
@@ -181,14 +329,28 @@
       func(nullptr);                                                           \
       self->commitTx();                                                        \
     } else {                                                                   \
-      jmp_buf _jmpbuf;                                                         \
-      setjmp(_jmpbuf);                                                         \
-      self->beginSTM(&_jmpbuf);                                                \
-      func((TM_OPAQUE *)0xCAFE);                                               \
+      checkpoint_t _checkpoint;                                                \
+      TM_CHECKPOINT(&_checkpoint);                                             \
+      self->beginSTM(&_checkpoint);                                            \
+      func((TM_OPAQUE *)self);                                                 \
+      self->commitTx();                                                        \
+    }                                                                          \
+  }                                                                            \
+  void TM_EXECUTE_FN(void *, void (*func)(void *, TM_OPAQUE *), void *obj) {   \
+    /* get TxThread before making checkpoint, so it doesn't re-run on abort */ \
+    TxThread *self = get_self();                                               \
+    if (self->beginHTM()) {                                                    \
+      func(obj, nullptr);                                                      \
+      self->commitTx();                                                        \
+    } else {                                                                   \
+      checkpoint_t _checkpoint;                                                \
+      TM_CHECKPOINT(&_checkpoint);                                             \
+      self->beginSTM(&_checkpoint);                                            \
+      func(obj, (TM_OPAQUE *)self);                                            \
       self->commitTx();                                                        \
     }                                                                          \
   }                                                                            \
-  bool TM_RAII_BEGIN(jmp_buf &buffer) {                                        \
+  bool TM_RAII_BEGIN(checkpoint_t &buffer) {                                   \
     TxThread *self = get_self();                                               \
     if (self->beginHTM()) {                                                    \
       return false;                                                            \
@@ -201,11 +363,12 @@
     TxThread *self = get_self();                                               \
     self->commitTx();                                                          \
   }                                                                            \
+  API_TM_EXECUTE_RO_AS_RW                                                      \
   }
 
 /// Create the API functions that are used to launch transactions.  These are
 /// the versions of EXECUTE_NOEXCEPT specialized for when transactions only
-/// abort at commit time, and hence do not require setjmp/longjmp support.
+/// abort at commit time, and hence do not require checkpoint/restore support.
 ///
 /// NB: Irrevocability is not supported for these TMs, because we can't use
 ///     aborts to resolve two transactions attempting to be irrevocable
@@ -213,18 +376,18 @@
 #define API_TM_EXECUTE_NOEXCEPT_LOOP_NOIRREVOC                                 \
   extern "C" {                                                                 \
   void TM_EXECUTE_C_INTERNAL(void (*)(void *), void *args,                     \
-                             void (*anno_func)(void *)) {                      \
+                             tm_c_clone_t anno_func) {                         \
     TxThread *self = get_self();                                               \
     do {                                                                       \
       self->beginTx(&self);                                                    \
-      anno_func(args);                                                         \
+      anno_func(args, (TM_OPAQUE *)self);                                      \
     } while (!self->commitTx());                                               \
   }                                                                            \
   void TM_EXECUTE_C(void *, void (*func)(void *), void *args) {                \
     /* casting function ptr to void* is illegal, but it works on x86 */        \
     union {                                                                    \
       void *voidstar;                                                          \
-      TM_C_FUNC cfunc;                                                         \
+      tm_c_clone_t cfunc;                                                      \
     } clone;                                                                   \
     clone.voidstar = get_clone((void *)func);                                  \
     TxThread *self = get_self();                                               \
@@ -233,7 +396,7 @@
       if (clone.voidstar == nullptr) {                                         \
         std::terminate();                                                      \
       } else {                                                                 \
-        clone.cfunc(args);                                                     \
+        clone.cfunc(args, (TM_OPAQUE *)self);                                  \
       }                                                                        \
     } while (!self->commitTx());                                               \
   }                                                                            \
@@ -241,10 +404,17 @@
     TxThread *self = get_self();                                               \
     do {                                                                       \
       self->beginTx(&self);                                                    \
-      func((TM_OPAQUE *)0xCAFE);                                               \
+      func((TM_OPAQUE *)self);                                                 \
+    } while (!self->commitTx());                                               \
+  }                                                                            \
+  void TM_EXECUTE_FN(void *, void (*func)(void *, TM_OPAQUE *), void *obj) {   \
+    TxThread *self = get_self();                                               \
+    do {                                                                       \
+      self->beginTx(&self);                                                    \
+      func(obj, (TM_OPAQUE *)self);                                            \
     } while (!self->commitTx());                                               \
   }                                                                            \
-  bool TM_RAII_BEGIN(jmp_buf &) {                                              \
+  bool TM_RAII_BEGIN(checkpoint_t &) {                                         \
     TxThread *self = get_self();                                               \
     self->beginTx(&self);                                                      \
     return true;                                                               \
@@ -253,12 +423,13 @@
     TxThread *self = get_self();                                               \
     self->commitTx();                                                          \
   }                                                                            \
+  API_TM_EXECUTE_RO_AS_RW                                                      \
   }
 
 /// Create the API functions that are used to launch speculative PTM
 /// transactions.  Since we are dealing with PTM, irrevocability is never an
 /// option, and we must always take the instrumented code path.  Since we are
-/// dealing with speculation, we require setjmp / longjmp.
+/// dealing with speculation, we require a checkpoint.
 ///
 /// Note that these are the versions for when we are not concerned about
 /// exceptions escaping from transactions (that is, they don't use try/catch
@@ -266,45 +437,54 @@
 #define API_TM_EXECUTE_NOEXCEPT_PTM                                            \
   extern "C" {                                                                 \
   void TM_EXECUTE_C_INTERNAL(void (*)(void *), void *args,                     \
-                             void (*anno_func)(void *)) {                      \
+                             tm_c_clone_t anno_func) {                         \
     /* get TxThread before making checkpoint, so it doesn't re-run on abort */ \
     TxThread *self = get_self();                                               \
-    jmp_buf _jmpbuf;                                                           \
-    setjmp(_jmpbuf);                                                           \
-    self->beginTx(&_jmpbuf);                                                   \
-    anno_func(args);                                                           \
+    checkpoint_t _checkpoint;                                                  \
+    TM_CHECKPOINT(&_checkpoint);                                               \
+    self->beginTx(&_checkpoint);                                               \
+    anno_func(args, (TM_OPAQUE *)self);                                        \
     self->commitTx();                                                          \
   }                                                                            \
   void TM_EXECUTE_C(void *, void (*func)(void *), void *args) {                \
     /* casting function ptr to void* is illegal, but it works on x86 */        \
     union {                                                                    \
       void *voidstar;                                                          \
-      TM_C_FUNC cfunc;                                                         \
+      tm_c_clone_t cfunc;                                                      \
     } clone;                                                                   \
     clone.voidstar = get_clone((void *)func);                                  \
     /* get TxThread before making checkpoint, so it doesn't re-run on abort */ \
     TxThread *self = get_self();                                               \
-    jmp_buf _jmpbuf;                                                           \
-    setjmp(_jmpbuf);                                                           \
-    self->beginTx(&_jmpbuf);                                                   \
+    checkpoint_t _checkpoint;                                                  \
+    TM_CHECKPOINT(&_checkpoint);                                               \
+    self->beginTx(&_checkpoint);                                               \
     /* If no clone, become irrevocable */                                      \
     if (clone.voidstar == nullptr) {                                           \
       std::terminate();                                                        \
     } else {                                                                   \
-      clone.cfunc(args);                                                       \
+      clone.cfunc(args, (TM_OPAQUE *)self);                                    \
     }                                                                          \
     self->commitTx();                                                          \
   }                                                                            \
   void TM_EXECUTE(void *, std::function<void(TM_OPAQUE *)> func) {             \
     /* get TxThread before making checkpoint, so it doesn't re-run on abort */ \
     TxThread *self = get_self();                                               \
-    jmp_buf _jmpbuf;                                                           \
-    setjmp(_jmpbuf);                                                           \
-    self->beginTx(&_jmpbuf);                                                   \
-    func((TM_OPAQUE *)0xCAFE);                                                 \
+    checkpoint_t _checkpoint;                                                  \
+    TM_CHECKPOINT(&_checkpoint);                                               \
+    self->beginTx(&_checkpoint);                                               \
+    func((TM_OPAQUE *)self);                                                   \
+    self->commitTx();                                                          \
+  }                                                                            \
+  void TM_EXECUTE_FN(void *, void (*func)(void *, TM_OPAQUE *), void *obj) {   \
+    /* get TxThread before making checkpoint, so it doesn't re-run on abort */ \
+    TxThread *self = get_self();                                               \
+    checkpoint_t _checkpoint;                                                  \
+    TM_CHECKPOINT(&_checkpoint);                                               \
+    self->beginTx(&_checkpoint);                                               \
+    func(obj, (TM_OPAQUE *)self);                                              \
     self->commitTx();                                                          \
   }                                                                            \
-  bool TM_RAII_BEGIN(jmp_buf &buffer) {                                        \
+  bool TM_RAII_BEGIN(checkpoint_t &buffer) {                                   \
     TxThread *self = get_self();                                               \
     self->beginTx(&buffer);                                                    \
     return true;                                                               \
@@ -313,12 +493,50 @@
     TxThread *self = get_self();                                               \
     self->commitTx();                                                          \
   }                                                                            \
+  void TM_EXECUTE_C_RO_INTERNAL(void (*)(void *), void *args,                  \
+                                tm_c_clone_t anno_func) {                      \
+    /* get TxThread before making checkpoint, so it doesn't re-run on abort */ \
+    TxThread *self = get_self();                                               \
+    checkpoint_t _checkpoint;                                                  \
+    TM_CHECKPOINT(&_checkpoint);                                               \
+    beginTxRO(self, &_checkpoint, 0);                                          \
+    anno_func(args, (TM_OPAQUE *)self);                                        \
+    self->commitTx();                                                          \
+  }                                                                            \
+  void TM_EXECUTE_C_RO(void *flags, void (*func)(void *), void *args) {        \
+    /* casting function ptr to void* is illegal, but it works on x86 */        \
+    union {                                                                    \
+      void *voidstar;                                                          \
+      tm_c_clone_t cfunc;                                                      \
+    } clone;                                                                   \
+    clone.voidstar = get_clone((void *)func);                                  \
+    /* If no clone, run as a writer, which knows what to do */                 \
+    if (clone.voidstar == nullptr)                                             \
+      TM_EXECUTE_C(flags, func, args);                                         \
+    else                                                                       \
+      TM_EXECUTE_C_RO_INTERNAL(func, args, clone.cfunc);                       \
+  }                                                                            \
+  void TM_EXECUTE_RO_FN(void *, void (*func)(void *, TM_OPAQUE *),             \
+                        void *obj) {                                           \
+    /* get TxThread before making checkpoint, so it doesn't re-run on abort */ \
+    TxThread *self = get_self();                                               \
+    checkpoint_t _checkpoint;                                                  \
+    TM_CHECKPOINT(&_checkpoint);                                               \
+    beginTxRO(self, &_checkpoint, 0);                                          \
+    func(obj, (TM_OPAQUE *)self);                                              \
+    self->commitTx();                                                          \
+  }                                                                            \
+  bool TM_RAII_RO_BEGIN(checkpoint_t &buffer) {                                \
+    TxThread *self = get_self();                                               \
+    beginTxRO(self, &buffer, 0);                                               \
+    return true;                                                               \
+  }                                                                            \
   }
 
 /// Create the API functions that are used to launch non-speculative PTM
 /// transactions.  Since we are dealing with PTM, irrevocability is never an
 /// option, and we must always take the instrumented code path.  However, we
-/// don't need setjmp / longjmp.
+/// don't need a checkpoint.
 ///
 /// Note that these are the versions for when we are not concerned about
 /// exceptions escaping from transactions (that is, they don't use try/catch
@@ -326,18 +544,18 @@
 #define API_TM_EXECUTE_NOEXCEPT_NOSPEC_PTM                                     \
   extern "C" {                                                                 \
   void TM_EXECUTE_C_INTERNAL(void (*)(void *), void *args,                     \
-                             void (*anno_func)(void *)) {                      \
+                             tm_c_clone_t anno_func) {                         \
     /* get TxThread before making checkpoint, so it doesn't re-run on abort */ \
     TxThread *self = get_self();                                               \
     self->beginTx(&self);                                                      \
-    anno_func(args);                                                           \
+    anno_func(args, (TM_OPAQUE *)self);                                        \
     self->commitTx();                                                          \
   }                                                                            \
   void TM_EXECUTE_C(void *, void (*func)(void *), void *args) {                \
     /* casting function ptr to void* is illegal, but it works on x86 */        \
     union {                                                                    \
       void *voidstar;                                                          \
-      TM_C_FUNC cfunc;                                                         \
+      tm_c_clone_t cfunc;                                                      \
     } clone;                                                                   \
     clone.voidstar = get_clone((void *)func);                                  \
     /* get TxThread before making checkpoint, so it doesn't re-run on abort */ \
@@ -347,17 +565,24 @@
     if (clone.voidstar == nullptr) {                                           \
       std::terminate();                                                        \
     }                                                                          \
-    clone.cfunc(args);                                                         \
+    clone.cfunc(args, (TM_OPAQUE *)self);                                      \
     self->commitTx();                                                          \
   }                                                                            \
   void TM_EXECUTE(void *, std::function<void(TM_OPAQUE *)> func) {             \
     /* get TxThread before making checkpoint, so it doesn't re-run on abort */ \
     TxThread *self = get_self();                                               \
     self->beginTx(&self);                                                      \
-    func((TM_OPAQUE *)0xCAFE);                                                 \
+    func((TM_OPAQUE *)self);                                                   \
+    self->commitTx();                                                          \
+  }                                                                            \
+  void TM_EXECUTE_FN(void *, void (*func)(void *, TM_OPAQUE *), void *obj) {   \
+    /* get TxThread before making checkpoint, so it doesn't re-run on abort */ \
+    TxThread *self = get_self();                                               \
+    self->beginTx(&self);                                                      \
+    func(obj, (TM_OPAQUE *)self);                                              \
     self->commitTx();                                                          \
   }                                                                            \
-  bool TM_RAII_BEGIN(jmp_buf &) {                                              \
+  bool TM_RAII_BEGIN(checkpoint_t &) {                                         \
     TxThread *self = get_self();                                               \
     self->beginTx(&self);                                                      \
     return true;                                                               \
@@ -366,4 +591,5 @@
     TxThread *self = get_self();                                               \
     self->commitTx();                                                          \
   }                                                                            \
+  API_TM_EXECUTE_RO_AS_RW                                                      \
   }
@@ -4,9 +4,16 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <functional>
+#include <mutex>
+#include <sys/mman.h>
+#include <thread>
 
+#include "captured.h"
 #include "minivector.h"
 
 /// The ImmediateAllocationManager is a degenerate manager, suitable only for
@@ -39,16 +46,16 @@ public:
   /// Reclaim memory within a transaction
   void reclaim(void *addr) { free(addr); }
 
-  /// Return true if the given address is within the range returned by the most
-  /// recent allocation, but do so only if CAPTURE is true
+  /// Return true if the given address is within the range returned by one of the
+  /// recent allocations, but do so only if CAPTURE is true
   bool checkCaptured(void *) { return false; }
 };
 
 /// The BasicAllocationManager provides a mechanism for a transaction to log its
 /// allocations and frees, and to finalize or undo them if the transaction
 /// commits or aborts.  It also supports the "capture" optimization, which
-/// tracks the most recent allocation and suggests to the TM that accesses in
-/// that allocation shouldn't be instrumented.
+/// tracks the transaction's recent allocations and suggests to the TM that
+/// accesses in those allocations shouldn't be instrumented.
 template <bool CAPTURE> class BasicAllocationManager {
 protected:
   /// a list of all not-yet-committed allocations in this transaction
@@ -60,11 +67,8 @@ protected:
   /// Track if allocation management is active or not
   bool active = false;
 
-  /// Address of last allocation
-  void *lastAlloc;
-
-  /// Size of last allocation
-  size_t lastSize;
+  /// The ranges of the transaction's most recent allocations
+  CapturedRanges<16> captured;
 
 public:
   /// Indicate that logging should begin
@@ -79,8 +83,7 @@ public:
     }
     frees.clear();
     active = false;
-    lastAlloc = nullptr;
-    lastSize = 0;
+    captured.clear();
   }
 
   /// When a transaction aborts, drop its frees and reclaim its mallocs
@@ -91,8 +94,7 @@ public:
     }
     mallocs.clear();
     active = false;
-    lastAlloc = nullptr;
-    lastSize = 0;
+    captured.clear();
   }
 
   /// To allocate memory, we must also log it, so we can reclaim it if the
@@ -103,8 +105,7 @@ public:
     void *res = malloc(size);
     if (active) {
       mallocs.push_back(res);
-      lastAlloc = res;
-      lastSize = size;
+      captured.add(res, size);
     }
     return res;
   }
@@ -116,8 +117,7 @@ public:
     void *res = aligned_alloc(A, size);
     if (active) {
       mallocs.push_back(res);
-      lastAlloc = res;
-      lastSize = size;
+      captured.add(res, size);
     }
     return res;
   }
@@ -132,14 +132,11 @@ public:
     }
   }
 
-  /// Return true if the given address is within the range returned by the most
-  /// recent allocation, but do so only if CAPTURE is true
+  /// Return true if the given address is within the range returned by one of the
+  /// recent allocations, but do so only if CAPTURE is true
   bool checkCaptured(void *addr) {
     if (CAPTURE) {
-      uintptr_t lstart = (uintptr_t)lastAlloc;
-      uintptr_t lend = lstart + lastSize;
-      uintptr_t a = (uintptr_t)addr;
-      return a >= lstart && a < lend;
+      return captured.contains(addr);
     } else {
       return false;
     }
@@ -170,4 +167,480 @@ public:
     }
     return res;
   }
-};
\ No newline at end of file
+};
+
+/// The SlabAllocationManager keeps malloc off of the transaction critical path.
+/// Small blocks (up to 2048 bytes, in power-of-two size classes) are carved out
+/// of chunks of a region of address space that is reserved once per process.
+/// Every chunk holds blocks of a single size class, and a side table records
+/// the class of each chunk, so that a block's size can be found from its
+/// address alone.
+///
+/// - Each thread has, for each class, a bump pointer into its current chunk and
+///   a cache (a stack) of free blocks.  An allocation pops the cache if it can,
+///   and otherwise bumps the pointer; when the chunk runs out, the thread takes
+///   a new one.  At the start of a transaction we checkpoint every cache's top
+///   and bump pointer, and an abort rolls back all of the transaction's
+///   allocations by restoring them.  Allocation does not write to the blocks,
+///   so there is nothing else to undo, and nothing to log.  Chunks taken during
+///   an aborted transaction are kept as spares for later refills.
+/// - Frees are deferred with epochs.  When a transaction commits, its frees are
+///   put in a limbo list, tagged with the global epoch.  Each thread announces
+///   the epoch in which its current transaction began, and once the limbo list
+///   is long, the thread advances the global epoch and recycles its limbo list
+///   into its caches if no transaction that began in an older epoch is still
+///   running.
+/// - When a cache overflows, half of it moves to a global depot, and a thread
+///   whose cache ran dry refills it from the depot, so that blocks freed by one
+///   thread can be reused by others.  Both happen at commit time, outside of
+///   the transaction.
+///
+/// Requests that are too big for the classes, and requests made when the
+/// region is exhausted, are forwarded to malloc and logged, exactly as in the
+/// BasicAllocationManager.  Since small allocations are not logged, there is no
+/// need to become irrevocable after a number of allocations, and the callback
+/// is ignored.
+///
+/// NB: Small blocks do not come from malloc, so memory that a transaction
+///     allocates must be freed with TM_FREE (i.e., by a transaction), never by
+///     a call to free() outside of a transaction.  Instances that use this
+///     manager are only suitable for programs that follow this rule.
+template <int MAXCACHED, int MAXLIMBO, bool CAPTURE>
+class SlabAllocationManager {
+  /// log_2 of the size of the smallest size class
+  static const int MIN_SHIFT = 4;
+
+  /// The number of size classes.  Classes are powers of two, from 16 to 2048
+  static const int NUM_CLASSES = 8;
+
+  /// The size of the largest size class
+  static const size_t MAX_SIZE = (size_t)1 << (MIN_SHIFT + NUM_CLASSES - 1);
+
+  /// log_2 of the size of a chunk
+  static const int CHUNK_SHIFT = 16;
+
+  /// The size of a chunk.  Chunks are aligned to their size, so every block is
+  /// aligned to its size.
+  static const size_t CHUNK_BYTES = (size_t)1 << CHUNK_SHIFT;
+
+  /// The size of the region from which chunks are carved.  It is reserved with
+  /// MAP_NORESERVE, so only the chunks that are touched consume memory.
+  static const size_t REGION_BYTES = (size_t)1 << 35;
+
+  /// The number of chunks in the region
+  static const size_t NUM_CHUNKS = REGION_BYTES / CHUNK_BYTES;
+
+  /// A thread's announcement of the epoch in which its current transaction
+  /// began.  Announcements are never freed, but are reused by new threads.
+  struct reader_t {
+    /// The epoch when the current transaction began, or 0 if there is none
+    std::atomic<uint64_t> epoch;
+
+    /// Whether an allocation manager owns this announcement
+    std::atomic<bool> taken;
+
+    /// The next announcement in the global list
+    reader_t *next;
+  };
+
+  /// The state that all threads' allocation managers share
+  struct region_t {
+    /// The start of the region (aligned to CHUNK_BYTES)
+    char *base;
+
+    /// The size of the region, or 0 if it could not be reserved
+    size_t bytes;
+
+    /// The index of the next chunk that has never been used
+    std::atomic<size_t> next_chunk;
+
+    /// The size class of each chunk that has been carved
+    uint8_t *classes;
+
+    /// The global epoch
+    std::atomic<uint64_t> epoch;
+
+    /// The announcements of all threads
+    std::atomic<reader_t *> readers;
+
+    /// Protects the depot
+    std::mutex depot_lock;
+
+    /// Blocks that threads moved out of their caches, indexed by size class
+    MiniVector<void *> depot[NUM_CLASSES];
+
+    /// Reserve the region and the side table
+    region_t() : next_chunk(0), epoch(1), readers(nullptr) {
+      void *r = mmap(nullptr, REGION_BYTES + CHUNK_BYTES,
+                     PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+      void *c = mmap(nullptr, NUM_CHUNKS, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+      if (r == MAP_FAILED || c == MAP_FAILED) {
+        // Every allocation will go to malloc
+        base = nullptr;
+        bytes = 0;
+        classes = nullptr;
+        next_chunk = NUM_CHUNKS;
+        return;
+      }
+      uintptr_t b = ((uintptr_t)r + CHUNK_BYTES - 1) & ~(CHUNK_BYTES - 1);
+      base = (char *)b;
+      bytes = REGION_BYTES;
+      classes = (uint8_t *)c;
+    }
+
+    /// Return the region.  It is never destroyed, since threads may still be
+    /// freeing memory after main() returns.
+    static region_t &get() {
+      static region_t *region = new region_t();
+      return *region;
+    }
+
+    /// Return true if the address came from the region
+    bool contains(void *addr) {
+      return (uintptr_t)addr - (uintptr_t)base < bytes;
+    }
+
+    /// Return the size class of a block from the region
+    int classOf(void *addr) {
+      return classes[((char *)addr - base) >> CHUNK_SHIFT];
+    }
+
+    /// Return the smallest epoch announced by a running transaction, or
+    /// UINT64_MAX if there is none
+    uint64_t oldest() {
+      uint64_t res = UINT64_MAX;
+      for (reader_t *r = readers; r != nullptr; r = r->next) {
+        uint64_t e = r->epoch;
+        res = (e != 0 && e < res) ? e : res;
+      }
+      return res;
+    }
+  };
+
+  /// The per-thread state for one size class
+  struct slab_t {
+    /// The next unused block of the current chunk
+    char *bump = nullptr;
+
+    /// The end of the current chunk
+    char *end = nullptr;
+
+    /// The value of bump when the current transaction began
+    char *bump_checkpoint = nullptr;
+
+    /// The value of end when the current transaction began
+    char *end_checkpoint = nullptr;
+
+    /// Chunks that were taken during aborted transactions, linked through
+    /// their first word
+    char *spares = nullptr;
+
+    /// Set when the slab took a new chunk, so that commit refills the cache
+    /// from the depot
+    bool dry = false;
+
+    /// The number of blocks in the cache
+    uint32_t top = 0;
+
+    /// The value of top when the current transaction began
+    uint32_t checkpoint = 0;
+
+    /// The cache of free blocks.  Entries at or above top are not free
+    void *blocks[MAXCACHED];
+  };
+
+  /// The shared region
+  region_t &region;
+
+  /// This thread's announcement
+  reader_t *reader;
+
+  /// The per-thread state, indexed by size class
+  slab_t slabs[NUM_CLASSES];
+
+  /// The chunks taken during the current transaction
+  MiniVector<char *> taken;
+
+  /// a list of the not-yet-committed allocations that came from malloc
+  MiniVector<void *> mallocs;
+
+  /// a list of all not-yet-committed deallocations in this transaction
+  MiniVector<void *> frees;
+
+  /// Committed deallocations that transactions might still be using
+  MiniVector<void *> limbo;
+
+  /// The latest epoch in which a block was put in limbo
+  uint64_t limbo_epoch = 0;
+
+  /// Track if allocation management is active or not
+  bool active = false;
+
+  /// The ranges of the transaction's most recent allocations
+  CapturedRanges<16> captured;
+
+  /// Return the smallest size class that can hold a block of the given size.
+  /// The caller must ensure 0 < size <= MAX_SIZE
+  static int classOf(size_t size) {
+    if (size <= ((size_t)1 << MIN_SHIFT)) {
+      return 0;
+    }
+    return 64 - __builtin_clzll(size - 1) - MIN_SHIFT;
+  }
+
+  /// Return the size of the blocks in a size class
+  static size_t sizeOf(int c) { return (size_t)1 << (MIN_SHIFT + c); }
+
+  /// Give a slab a new chunk, from its spares if possible.  Returns false if
+  /// the region is exhausted.
+  bool refill(slab_t &s, int c) {
+    char *chunk = s.spares;
+    if (chunk != nullptr) {
+      s.spares = *(char **)chunk;
+    } else {
+      size_t idx = region.next_chunk.fetch_add(1);
+      if (idx >= NUM_CHUNKS) {
+        return false;
+      }
+      chunk = region.base + (idx << CHUNK_SHIFT);
+      region.classes[idx] = c;
+    }
+    if (active) {
+      taken.push_back(chunk);
+    }
+    s.dry = true;
+    s.bump = chunk;
+    s.end = chunk + CHUNK_BYTES;
+    return true;
+  }
+
+  /// Get a block from the malloc, and log it if we are in a transaction
+  void *getLarge(size_t size) {
+    void *res = malloc(size);
+    if (active) {
+      mallocs.push_back(res);
+    }
+    return res;
+  }
+
+  /// Get a block that can hold size bytes: from a cache, from a chunk, or, for
+  /// large blocks, from malloc
+  void *get(size_t size) {
+    void *res;
+    if (size == 0 || size > MAX_SIZE) {
+      res = getLarge(size);
+    } else {
+      int c = classOf(size);
+      slab_t &s = slabs[c];
+      if (s.top > 0) {
+        res = s.blocks[--s.top];
+      } else {
+        if (s.bump == s.end && !refill(s, c)) {
+          res = getLarge(sizeOf(c));
+        } else {
+          res = s.bump;
+          s.bump += sizeOf(c);
+        }
+      }
+    }
+    if (active) {
+      captured.add(res, size);
+    }
+    return res;
+  }
+
+  /// Give a block back to its cache, or to malloc if it did not come from the
+  /// region.  If the cache is full, move half of it to the depot.
+  void put(void *addr) {
+    if (!region.contains(addr)) {
+      free(addr);
+      return;
+    }
+    slab_t &s = slabs[region.classOf(addr)];
+    if (s.top == MAXCACHED) {
+      std::lock_guard<std::mutex> guard(region.depot_lock);
+      MiniVector<void *> &d = region.depot[region.classOf(addr)];
+      for (; s.top > MAXCACHED / 2; --s.top) {
+        d.push_back(s.blocks[s.top - 1]);
+      }
+    }
+    s.blocks[s.top++] = addr;
+  }
+
+  /// Move committed frees into limbo, and recycle the limbo list if no running
+  /// transaction could still be using its blocks
+  void retire() {
+    if (frees.empty()) {
+      return;
+    }
+    for (auto a : frees) {
+      limbo.push_back(a);
+    }
+    frees.clear();
+    limbo_epoch = region.epoch;
+    if (limbo.size() < MAXLIMBO) {
+      return;
+    }
+    region.epoch.fetch_add(1);
+    if (region.oldest() > limbo_epoch) {
+      for (auto a : limbo) {
+        put(a);
+      }
+      limbo.clear();
+    }
+  }
+
+  /// Refill the caches of slabs that took a new chunk from the depot
+  void restock() {
+    for (int c = 0; c < NUM_CLASSES; ++c) {
+      slab_t &s = slabs[c];
+      if (!s.dry) {
+        continue;
+      }
+      s.dry = false;
+      std::lock_guard<std::mutex> guard(region.depot_lock);
+      MiniVector<void *> &d = region.depot[c];
+      while (!d.empty() && s.top < MAXCACHED / 2) {
+        s.blocks[s.top++] = d.pop_back();
+      }
+    }
+  }
+
+public:
+  /// Construct a SlabAllocationManager by finding the region, and taking an
+  /// announcement
+  SlabAllocationManager() : region(region_t::get()), reader(nullptr) {
+    for (reader_t *r = region.readers; r != nullptr; r = r->next) {
+      bool expected = false;
+      if (!r->taken && r->taken.compare_exchange_strong(expected, true)) {
+        reader = r;
+        return;
+      }
+    }
+    reader = new reader_t();
+    reader->epoch = 0;
+    reader->taken = true;
+    reader->next = region.readers;
+    while (!region.readers.compare_exchange_weak(reader->next, reader))
+      ;
+  }
+
+  /// When the thread's descriptor is destroyed, wait until its limbo list is
+  /// safe, move its blocks to the depot, and give up its announcement.  The
+  /// rest of its current chunks and its spares are abandoned.
+  ~SlabAllocationManager() {
+    while (!limbo.empty() && region.oldest() <= limbo_epoch) {
+      region.epoch.fetch_add(1);
+      std::this_thread::yield();
+    }
+    std::lock_guard<std::mutex> guard(region.depot_lock);
+    for (auto a : limbo) {
+      if (region.contains(a)) {
+        region.depot[region.classOf(a)].push_back(a);
+      } else {
+        free(a);
+      }
+    }
+    for (int c = 0; c < NUM_CLASSES; ++c) {
+      for (uint32_t i = 0; i < slabs[c].top; ++i) {
+        region.depot[c].push_back(slabs[c].blocks[i]);
+      }
+    }
+    reader->taken = false;
+  }
+
+  /// Indicate that logging should begin, announce the epoch, and checkpoint
+  /// the slabs
+  void onBegin() {
+    active = true;
+    reader->epoch = region.epoch.load();
+    for (auto &s : slabs) {
+      s.checkpoint = s.top;
+      s.bump_checkpoint = s.bump;
+      s.end_checkpoint = s.end;
+    }
+  }
+
+  /// When a transaction commits, finalize its mallocs, and put its frees in
+  /// limbo.  Note that this should be called *after* privatization is ensured.
+  void onCommit() {
+    reader->epoch = 0;
+    mallocs.clear();
+    taken.clear();
+    active = false;
+    captured.clear();
+    retire();
+    restock();
+  }
+
+  /// When a transaction aborts, drop its frees, put back the blocks it took
+  /// from the slabs, keep the chunks it took as spares, and reclaim its
+  /// mallocs
+  void onAbort() {
+    reader->epoch = 0;
+    frees.clear();
+    for (auto &s : slabs) {
+      s.top = s.checkpoint;
+      s.bump = s.bump_checkpoint;
+      s.end = s.end_checkpoint;
+    }
+    for (auto chunk : taken) {
+      slab_t &s = slabs[region.classOf(chunk)];
+      *(char **)chunk = s.spares;
+      s.spares = chunk;
+    }
+    taken.clear();
+    for (auto p : mallocs) {
+      free(p);
+    }
+    mallocs.clear();
+    active = false;
+    captured.clear();
+  }
+
+  /// Allocate memory within a transaction
+  ///
+  /// NB: the function pointer is ignored in this allocation manager
+  void *alloc(size_t size, std::function<void()>) { return get(size); }
+
+  /// Allocate memory that is aligned on a byte boundary as specified by A.
+  /// Blocks are aligned to their size, so an aligned request can be served by
+  /// a block at least as large as the alignment.
+  ///
+  /// NB: the function pointer is ignored in this allocation manager
+  void *alignAlloc(size_t A, size_t size, std::function<void()>) {
+    if (A <= MAX_SIZE && size <= MAX_SIZE) {
+      return get(size > A ? size : A);
+    }
+    void *res = aligned_alloc(A, size);
+    if (active) {
+      mallocs.push_back(res);
+      captured.add(res, size);
+    }
+    return res;
+  }
+
+  /// To free memory, we wait until the transaction has committed, and then we
+  /// put the block in limbo
+  void reclaim(void *addr) {
+    if (addr == nullptr) {
+      return;
+    }
+    frees.push_back(addr);
+    if (!active) {
+      retire();
+    }
+  }
+
+  /// Return true if the given address is within the range returned by one of the
+  /// recent allocations, but do so only if CAPTURE is true
+  bool checkCaptured(void *addr) {
+    if (CAPTURE) {
+      return captured.contains(addr);
+    } else {
+      return false;
+    }
+  }
+};
@@ -0,0 +1,58 @@
+/// checkpoint.h implements the register checkpoint that a transaction takes
+/// when it begins, and the restore that takes an aborted transaction back to
+/// it.  These replace setjmp and longjmp.  Like libitm's _ITM_beginTransaction,
+/// the checkpoint only saves the registers that the x86-64 ABI requires a
+/// callee to preserve, plus the stack pointer and return address.  Unlike
+/// glibc's setjmp, it does not mangle pointers, and never touches the signal
+/// mask.
+///
+/// NB: Each TM library is a single translation unit, so the functions are
+///     defined here, not just declared.  TM_CHECKPOINT is extern "C", because
+///     the RAII API calls it from application code.
+
+#pragma once
+
+#include "../../common/tm_defines.h"
+
+#if !defined(__x86_64__)
+#error "Transaction checkpoints are only implemented for x86-64"
+#endif
+
+/// The checkpoint type, as the library code refers to it
+typedef TM_CHECKPOINT_T checkpoint_t;
+
+extern "C" {
+/// Save the caller's registers in a checkpoint, and return 0.  When the
+/// checkpoint is restored, this returns again, with 1.
+///
+/// NB: The stack pointer that we save is the caller's, as of when this returns
+__attribute__((naked, returns_twice)) int TM_CHECKPOINT(checkpoint_t *) {
+  asm("movq (%rsp), %rax\n\t"
+      "leaq 8(%rsp), %rcx\n\t"
+      "movq %rbx, 0(%rdi)\n\t"
+      "movq %rbp, 8(%rdi)\n\t"
+      "movq %r12, 16(%rdi)\n\t"
+      "movq %r13, 24(%rdi)\n\t"
+      "movq %r14, 32(%rdi)\n\t"
+      "movq %r15, 40(%rdi)\n\t"
+      "movq %rcx, 48(%rdi)\n\t"
+      "movq %rax, 56(%rdi)\n\t"
+      "xorl %eax, %eax\n\t"
+      "ret");
+}
+}
+
+/// Restore the registers in a checkpoint, so that the TM_CHECKPOINT call that
+/// saved them returns again.  The frame that made that call must still be live.
+__attribute__((naked, noreturn)) inline void
+restore_checkpoint(checkpoint_t *) {
+  asm("movq 0(%rdi), %rbx\n\t"
+      "movq 8(%rdi), %rbp\n\t"
+      "movq 16(%rdi), %r12\n\t"
+      "movq 24(%rdi), %r13\n\t"
+      "movq 32(%rdi), %r14\n\t"
+      "movq 40(%rdi), %r15\n\t"
+      "movq 48(%rdi), %rsp\n\t"
+      "movl $1, %eax\n\t"
+      "jmpq *56(%rdi)");
+}
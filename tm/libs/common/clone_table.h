@@ -0,0 +1,186 @@
+/// clone_table.h provides a concurrent map from functions to their
+/// transactional clones, and a per-thread cache for it, so that indirect calls
+/// in transactions can find clones cheaply, even while shared objects are
+/// registering new clones.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+
+/// CloneTable is an open-addressing hash table that maps function pointers to
+/// clone pointers.  Lookups are lock-free and never write shared memory.
+/// Registrations are serialized by a spinlock, which is fine because they only
+/// happen when the program or a shared object is loading.
+///
+/// Each entry's value is written before its key, so a reader that sees the key
+/// sees a valid clone.  Re-registering a function just replaces its clone.
+/// When the table gets half full, registration copies it into one that is twice
+/// as big, and then publishes the new one.  Concurrent readers may still be
+/// using the old table, so it is never freed.  Since tables grow geometrically,
+/// the leaked memory is less than the size of the current table.
+///
+/// Every registration increments a version number, so that caches of the table
+/// (see CloneCache) can tell when they are stale.
+///
+/// NB: The constructor is constexpr, so that a global CloneTable is ready
+///     before any static constructor registers clones.
+class CloneTable {
+  /// A mapping from a function to its clone
+  struct entry_t {
+    /// The function, or nullptr if the entry is unused
+    std::atomic<void *> func;
+
+    /// The clone
+    std::atomic<void *> clone;
+  };
+
+  /// A table is a header, followed by its entries
+  struct table_t {
+    /// log_2 of the number of entries
+    int bits;
+
+    /// The entries
+    entry_t entries[];
+  };
+
+  /// The current table, or nullptr if nothing has been registered
+  std::atomic<table_t *> table;
+
+  /// The number of registrations
+  std::atomic<uintptr_t> version;
+
+  /// The number of functions in the table
+  size_t count;
+
+  /// A lock that serializes registrations
+  std::atomic<bool> lock;
+
+  /// Map a function to its preferred entry in a table with 2^bits entries
+  static size_t hash(void *func, int bits) {
+    return ((uintptr_t)func * 0x9E3779B97F4A7C15ULL) >> (64 - bits);
+  }
+
+  /// Create a table with 2^bits unused entries
+  static table_t *make_table(int bits) {
+    table_t *t = static_cast<table_t *>(
+        calloc(1, sizeof(table_t) + (sizeof(entry_t) << bits)));
+    t->bits = bits;
+    return t;
+  }
+
+  /// Add or update a mapping in a table.  The table must not be full.
+  static void put(table_t *t, void *func, void *clone) {
+    size_t mask = ((size_t)1 << t->bits) - 1;
+    for (size_t i = hash(func, t->bits);; i = (i + 1) & mask) {
+      void *f = t->entries[i].func.load(std::memory_order_relaxed);
+      if (f == func || f == nullptr) {
+        t->entries[i].clone.store(clone, std::memory_order_release);
+        t->entries[i].func.store(func, std::memory_order_release);
+        return;
+      }
+    }
+  }
+
+public:
+  /// Construct an empty CloneTable
+  constexpr CloneTable() : table(nullptr), version(0), count(0), lock(false) {}
+
+  /// Map func to clone, replacing any previous mapping for func
+  void insert(void *func, void *clone) {
+    while (lock.exchange(true, std::memory_order_acquire)) {
+    }
+    table_t *t = table.load(std::memory_order_relaxed);
+    if (t == nullptr || (count + 1) * 2 > ((size_t)1 << t->bits)) {
+      table_t *bigger = make_table(t ? t->bits + 1 : 8);
+      if (t) {
+        for (size_t i = 0; i < ((size_t)1 << t->bits); ++i) {
+          void *f = t->entries[i].func.load(std::memory_order_relaxed);
+          if (f) {
+            void *c = t->entries[i].clone.load(std::memory_order_relaxed);
+            put(bigger, f, c);
+          }
+        }
+      }
+      table.store(bigger, std::memory_order_release);
+      t = bigger;
+    }
+    if (find(func) == nullptr) {
+      ++count;
+    }
+    put(t, func, clone);
+    version.fetch_add(1, std::memory_order_release);
+    lock.store(false, std::memory_order_release);
+  }
+
+  /// Return the clone of func, or nullptr if it has none
+  void *find(void *func) const {
+    table_t *t = table.load(std::memory_order_acquire);
+    if (t == nullptr) {
+      return nullptr;
+    }
+    size_t mask = ((size_t)1 << t->bits) - 1;
+    for (size_t i = hash(func, t->bits);; i = (i + 1) & mask) {
+      void *f = t->entries[i].func.load(std::memory_order_acquire);
+      if (f == func) {
+        return t->entries[i].clone.load(std::memory_order_acquire);
+      }
+      if (f == nullptr) {
+        return nullptr;
+      }
+    }
+  }
+
+  /// Return the number of registrations so far
+  uintptr_t getVersion() const {
+    return version.load(std::memory_order_acquire);
+  }
+};
+
+/// CloneCache is a small, direct-mapped cache of a CloneTable, meant to be
+/// thread-local.  It remembers the results (including misses) of recent
+/// lookups, so that a hot indirect call site usually costs one comparison.
+/// The cache is flushed whenever the table's version changes.
+///
+/// NB: The cache has no constructor, so that a thread_local CloneCache needs no
+///     initialization beyond being zeroed.
+template <int SIZE> class CloneCache {
+  static_assert((SIZE & (SIZE - 1)) == 0, "SIZE must be a power of 2");
+
+  /// A cached lookup
+  struct entry_t {
+    /// The function
+    void *func;
+
+    /// Its clone, or nullptr if it has none
+    void *clone;
+  };
+
+  /// The cached lookups
+  entry_t entries[SIZE];
+
+  /// The version of the table when the cache was last flushed
+  uintptr_t version;
+
+public:
+  /// Return the clone of func, or nullptr if it has none, consulting the table
+  /// on a cache miss
+  void *get(const CloneTable &table, void *func) {
+    uintptr_t v = table.getVersion();
+    if (__builtin_expect(v != version, false)) {
+      for (int i = 0; i < SIZE; ++i) {
+        entries[i] = {nullptr, nullptr};
+      }
+      version = v;
+    }
+    // Functions are usually 16-byte aligned, so skip the low bits
+    entry_t &e = entries[((uintptr_t)func >> 4) & (SIZE - 1)];
+    if (e.func == func) {
+      return e.clone;
+    }
+    void *clone = table.find(func);
+    e = {func, clone};
+    return clone;
+  }
+};
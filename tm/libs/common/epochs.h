@@ -15,7 +15,9 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstddef>
+#include <exception>
 
 #include "pad_word.h"
 
@@ -23,15 +25,33 @@
 /// does not support quiescence or irrevocability.  Since we use it as the base
 /// for all other EpochManagers, we place the Epoch table in it, even though it
 /// does not use the Epoch table.
+///
+/// IDs are recycled along with descriptors: API_TM_DESCRIPTOR pools the
+/// descriptors of exited threads, and a new thread takes one from the pool
+/// before it constructs a new one.  Thus programs that churn through threads
+/// (e.g., thread pools) do not exhaust MAXTHREADS.  A bitmap records which IDs
+/// belong to live threads.  When a descriptor is pooled, it parks its
+/// EpochManager, which clears its bit, and when a new thread takes it, it
+/// unparks the EpochManager, which sets the bit again.  Epoch table scans only
+/// visit the slots whose bits are set.
 template <int MAXTHREADS> class BasicEpochManager {
+  /// The number of IDs tracked by each word of the live bitmap
+  static const int WORD_BITS = 64;
+
+  /// The number of words in the live bitmap
+  static const int LIVE_WORDS = (MAXTHREADS + WORD_BITS - 1) / WORD_BITS;
+
 public:
   /// Globals encapsulates the shared data that threads' EpochManagers will use
   /// to coordinate.
   class Globals {
   public:
-    /// A monotonically increasing counter for assigning thread IDs
+    /// One more than the largest ID ever assigned
     pad_dword_t idGenerator;
 
+    /// Bit i of word w is set when ID w*64+i belongs to a live thread
+    pad_word_t live[LIVE_WORDS];
+
     /// The epoch table for tracking if threads are in a transaction or not.
     pad_word_t epochs[MAXTHREADS];
 
@@ -44,20 +64,68 @@ public:
       }
     }
 
-    /// Return the total number of threads in the system
+    /// Return the number of IDs that might be in use.  This includes the IDs
+    /// of pooled descriptors.
     uintptr_t getThreads() { return idGenerator.val; }
+
+    /// Claim a new ID for a live thread
+    size_t acquire() {
+      size_t id = idGenerator.val++;
+      if (id >= MAXTHREADS) {
+        std::terminate();
+      }
+      unpark(id);
+      return id;
+    }
+
+    /// Clear an ID's bit in the live bitmap.  Its thread is not in a
+    /// transaction, so its epoch is already -1.
+    void park(size_t id) {
+      live[id / WORD_BITS].val.fetch_and(~(1ULL << (id % WORD_BITS)));
+    }
+
+    /// Set an ID's bit in the live bitmap
+    void unpark(size_t id) {
+      live[id / WORD_BITS].val.fetch_or(1ULL << (id % WORD_BITS));
+    }
+
+    /// Spin until every live thread other than self has an epoch that
+    /// satisfies the predicate
+    template <class F> void waitAll(size_t self, F ok) {
+      uintptr_t max = idGenerator.val;
+      for (uintptr_t w = 0; w * WORD_BITS < max; ++w) {
+        uintptr_t bits = live[w].val;
+        while (bits) {
+          size_t i = w * WORD_BITS + __builtin_ctzll(bits);
+          bits &= bits - 1;
+          if (i != self) { // don't wait on self :)
+            while (!ok(epochs[i].val.load()))
+              ;
+          }
+        }
+      }
+    }
   };
 
+private:
+  /// The Globals from which this thread's ID came
+  Globals &globals;
+
+public:
   /// The unique Id of the thread to which this EpochManager belongs
   size_t id;
 
   /// Construct a thread's instance of the BasicEpochManager by giving the
   /// thread a unique id.
-  BasicEpochManager(Globals &g) : id(g.idGenerator.val++) {
-    if (id >= MAXTHREADS) {
-      std::terminate();
-    }
-  }
+  BasicEpochManager(Globals &g) : globals(g), id(g.acquire()) {}
+
+  /// Stop epoch scans from visiting this ID, because its descriptor is being
+  /// pooled
+  void park() { globals.park(id); }
+
+  /// Let epoch scans visit this ID again, because a new thread has taken its
+  /// descriptor from the pool
+  void unpark() { globals.unpark(id); }
 
   /// Return whether the thread is irrevocable or not
   bool isIrrevoc() { return false; }
@@ -115,13 +183,7 @@ public:
   /// greater than the provided time.  Note that the table holds unsigned
   /// integers, so -1 is big.
   void quiesce(Globals &g, uintptr_t time) {
-    uintptr_t count = g.idGenerator.val;
-    for (uintptr_t i = 0; i < count; ++i) {
-      if (i != this->id) { // don't wait on self :)
-        while (g.epochs[i].val < time)
-          ;
-      }
-    }
+    g.waitAll(this->id, [&](uintptr_t e) { return e >= time; });
   }
 };
 
@@ -202,13 +264,7 @@ public:
       return false;
     }
     // Wait on all threads to exit transactions
-    uintptr_t count = g.idGenerator.val;
-    for (uintptr_t i = 0; i < count; ++i) {
-      if (i != this->id) { // don't wait on self :)
-        while (g.epochs[i].val != (uintptr_t)-1)
-          ;
-      }
-    }
+    g.waitAll(this->id, [](uintptr_t e) { return e == (uintptr_t)-1; });
     // mark self irrevocable
     hasToken = true;
     return true;
@@ -234,12 +290,287 @@ public:
   /// greater than the provided time.  Note that the table holds unsigned
   /// integers, so -1 is big.
   void quiesce(Globals &g, uintptr_t time) {
-    uintptr_t count = g.idGenerator.val;
-    for (uintptr_t i = 0; i < count; ++i) {
-      if (i != this->id) { // don't wait on self :)
-        while (g.epochs[i].val < time)
-          ;
+    g.waitAll(this->id, [&](uintptr_t e) { return e >= time; });
+  }
+};
+
+/// HierarchicalEpochManager is an Epoch manager that supports both
+/// irrevocability and quiescence, like IrrevocQuiesceEpochManager, but it
+/// organizes the epoch table so that scans are proportional to the number of
+/// live threads:
+///
+/// - The table is split into groups of 64 slots.  Each group has a summary
+///   word, in which bit i is set when slot i belongs to a live thread.  A
+///   global word has bit g set when group g has at least one live slot.
+///   quiesce() and tryIrrevoc() only visit the live slots of those groups.
+/// - The per-socket tables are formed by striping: group g belongs to socket
+///   g % sockets.  A thread takes a slot in a group of the socket on which it
+///   is running (if one is free), so that the slots of a socket's threads tend
+///   to be on lines written by that socket.  Striping keeps ids dense and the
+///   table a single array, at the cost of a socket's groups not being
+///   contiguous.  When a socket's groups are full, a thread takes a slot in
+///   any group.
+/// - A thread that exits does not give up its slot: API_TM_DESCRIPTOR pools its
+///   descriptor, slot and all, for the next thread.  While the descriptor is
+///   pooled, its EpochManager is parked, which clears the slot's bit in its
+///   group's summary (and the group's bit in the global word, if that was the
+///   last live slot of the group).  A new thread that takes the descriptor
+///   unparks it, which sets the bits again.  Each group also records which of
+///   its slots have been claimed, so that a parked slot is not given to a new
+///   descriptor.
+///
+/// NB: Claiming, parking, and unparking slots happen when threads start and
+///     exit, so they are serialized by a lock.  This keeps a group's summary bit and the
+///     global bit consistent without blocking scans, which do not take the
+///     lock.
+template <int MAXTHREADS> class HierarchicalEpochManager {
+  /// The number of slots per group: one per bit of a summary word
+  static const int GROUP_SIZE = 64;
+
+  /// The number of groups
+  static const int NUM_GROUPS = (MAXTHREADS + GROUP_SIZE - 1) / GROUP_SIZE;
+
+  static_assert(NUM_GROUPS <= 64, "The group summary is a single word");
+
+  /// A group of slots in the epoch table
+  struct group_t {
+    /// Bit i is set when slot i belongs to a descriptor, live or pooled
+    pad_word_t claimed;
+
+    /// Bit i is set when slot i belongs to a live thread
+    pad_word_t live;
+
+    /// The epoch table entries of the group
+    pad_word_t epochs[GROUP_SIZE];
+  };
+
+public:
+  /// Globals encapsulates the shared data that threads' EpochManagers will use
+  /// to coordinate.
+  class Globals {
+  public:
+    /// A token that can be assigned to one thread at a time
+    pad_dword_t token;
+
+    /// Bit g is set when group g has at least one live slot
+    pad_dword_t used;
+
+    /// A lock that serializes claiming and releasing slots
+    pad_dword_t registry;
+
+    /// The number of sockets among which groups are striped
+    int sockets;
+
+    /// The groups that comprise the epoch table
+    group_t groups[NUM_GROUPS];
+
+    /// Construct a HierarchicalEpochManager::Globals by clearing the summaries,
+    /// initializing the epoch table to all -1s, and finding the number of
+    /// sockets
+    Globals() : sockets(getNumSockets()) {
+      token.val = 0;
+      used.val = 0;
+      registry.val = 0;
+      for (int g = 0; g < NUM_GROUPS; ++g) {
+        groups[g].claimed.val = 0;
+        groups[g].live.val = 0;
+        for (int i = 0; i < GROUP_SIZE; ++i) {
+          groups[g].epochs[i].val = -1;
+        }
+      }
+    }
+
+    /// Return the number of live threads.  Note that ids are not dense, so
+    /// this is not a bound on the ids in use.
+    uintptr_t getThreads() {
+      uintptr_t count = 0;
+      uintptr_t used_groups = used.val;
+      while (used_groups) {
+        int g = __builtin_ctzll(used_groups);
+        used_groups &= used_groups - 1;
+        count += __builtin_popcountll(groups[g].live.val);
+      }
+      return count;
+    }
+
+    /// Claim a free slot, preferring the groups of the given socket.  Returns
+    /// the slot's id.
+    size_t acquire(int socket) {
+      lock();
+      // First pass: only the socket's groups; second pass: any group
+      for (int pass = 0; pass < 2; ++pass) {
+        for (int g = 0; g < NUM_GROUPS; ++g) {
+          if (pass == 0 && (g % sockets) != (socket % sockets)) {
+            continue;
+          }
+          uintptr_t claimed = groups[g].claimed.val;
+          if (~claimed == 0) {
+            continue;
+          }
+          int slot = __builtin_ctzll(~claimed);
+          size_t id = g * GROUP_SIZE + slot;
+          if (id >= MAXTHREADS) {
+            continue;
+          }
+          groups[g].claimed.val.fetch_or(1ULL << slot);
+          publish(id);
+          unlock();
+          return id;
+        }
+      }
+      unlock();
+      std::terminate();
+    }
+
+    /// Remove a slot from its group's summary, and retire the group from the
+    /// global summary if it has no more live slots.  The slot's thread is not
+    /// in a transaction, so its epoch is already -1.
+    void park(size_t id) {
+      size_t g = id / GROUP_SIZE;
+      lock();
+      uintptr_t bit = 1ULL << (id % GROUP_SIZE);
+      if (groups[g].live.val.fetch_and(~bit) == bit) {
+        used.val.fetch_and(~(1ULL << g));
+      }
+      unlock();
+    }
+
+    /// Return a parked slot to its group's summary
+    void unpark(size_t id) {
+      lock();
+      publish(id);
+      unlock();
+    }
+
+    /// Spin until every live thread other than self has an epoch that
+    /// satisfies the predicate
+    template <class F> void waitAll(size_t self, F ok) {
+      // Order the caller's writes (the token or the timestamp) before reading
+      // the summaries.  A thread that is not in the summaries at this point
+      // will see those writes when it begins its next transaction.
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      uintptr_t used_groups = used.val;
+      while (used_groups) {
+        int g = __builtin_ctzll(used_groups);
+        used_groups &= used_groups - 1;
+        uintptr_t live = groups[g].live.val;
+        while (live) {
+          int slot = __builtin_ctzll(live);
+          live &= live - 1;
+          if (g * GROUP_SIZE + slot != (int)self) { // don't wait on self :)
+            while (!ok(groups[g].epochs[slot].val.load()))
+              ;
+          }
+        }
+      }
+    }
+
+  private:
+    /// Add a slot to the summaries.  The slot is published before the group,
+    /// so that a scan that sees the group's bit also sees the slot.
+    void publish(size_t id) {
+      size_t g = id / GROUP_SIZE;
+      groups[g].live.val.fetch_or(1ULL << (id % GROUP_SIZE));
+      used.val.fetch_or(1ULL << g);
+    }
+
+    /// Acquire the registry lock
+    void lock() {
+      uintptr_t unheld = 0;
+      while (!registry.val.compare_exchange_weak(unheld, 1)) {
+        unheld = 0;
+      }
+    }
+
+    /// Release the registry lock
+    void unlock() { registry.val = 0; }
+  };
+
+private:
+  /// The Globals in which this thread has its slot
+  Globals &globals;
+
+  /// hasToken tracks if the current thread owns Globals::token
+  bool hasToken;
+
+  /// Return this thread's entry in the epoch table
+  std::atomic<uintptr_t> &myEpoch() {
+    return globals.groups[id / GROUP_SIZE].epochs[id % GROUP_SIZE].val;
+  }
+
+public:
+  /// The unique Id of the thread to which this EpochManager belongs
+  size_t id;
+
+  /// Construct a thread's instance of the HierarchicalEpochManager by claiming
+  /// a slot on the thread's current socket
+  HierarchicalEpochManager(Globals &g)
+      : globals(g), hasToken(false), id(g.acquire(getSocket())) {}
+
+  /// Stop epoch scans from visiting this slot, because its descriptor is being
+  /// pooled
+  void park() { globals.park(id); }
+
+  /// Let epoch scans visit this slot again, because a new thread has taken its
+  /// descriptor from the pool
+  void unpark() { globals.unpark(id); }
+
+  /// Return whether the thread is irrevocable or not
+  bool isIrrevoc() { return hasToken; }
+
+  /// Clear a thread's value in the epoch table
+  void clearEpoch(Globals &) { myEpoch() = -1LL; }
+
+  /// Set a thread's value in the epoch table
+  void setEpoch(Globals &, uintptr_t time) { myEpoch() = time; }
+
+  /// When a thread starts, block it until there are no irrevocable
+  /// transactions, and also update the epoch table
+  void onBegin(Globals &g, uintptr_t time) {
+    while (true) {
+      setEpoch(g, time);
+      if (!g.token.val) {
+        break;
       }
+      clearEpoch(g);
+      while (g.token.val)
+        ;
     }
   }
-};
\ No newline at end of file
+
+  /// When a thread commits as irrevocable, reset it in the epoch table and
+  /// release the token
+  void onCommitIrrevoc(Globals &g) {
+    clearEpoch(g);
+    g.token.val = 0;
+    hasToken = false;
+  }
+
+  /// Check if there exists an irrevocable thread
+  bool existIrrevoc(Globals &g) { return g.token.val; }
+
+  /// Try to become irrevocable, but possibly fail
+  bool tryIrrevoc(Globals &g) {
+    // If we are already irrevocable, succeed immediately
+    if (hasToken) {
+      return true;
+    }
+    // Attempt to get the token
+    uint64_t oldval = 0;
+    if (g.token.val || !g.token.val.compare_exchange_strong(oldval, 1)) {
+      return false;
+    }
+    // Wait on all live threads to exit transactions
+    g.waitAll(id, [](uintptr_t e) { return e == (uintptr_t)-1; });
+    // mark self irrevocable
+    hasToken = true;
+    return true;
+  }
+
+  /// Wait for all live threads to update their entries in the epoch table to
+  /// be greater than the provided time.  Note that the table holds unsigned
+  /// integers, so -1 is big.
+  void quiesce(Globals &g, uintptr_t time) {
+    g.waitAll(id, [time](uintptr_t e) { return e >= time; });
+  }
+};
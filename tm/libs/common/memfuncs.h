@@ -132,4 +132,76 @@ void *tx_basic_memmove(void *dest, const void *src, size_t len, T &t) {
     }
   }
   return dest;
-}
\ No newline at end of file
+}
+
+/// The number of bytes that the bulk memory functions stage in a private
+/// buffer between a readRange and a writeRange
+const size_t BULK_STAGING_BYTES = 256;
+
+/// Bulk transactional memcpy.  This requires the TM algorithm to provide
+/// readRange and writeRange, which instrument a whole range at a time (e.g., by
+/// reading and logging each covered orec once, and by logging whole chunks in
+/// the redo log).  The source is staged through a private buffer, a piece at a
+/// time.
+template <class T>
+void *tx_bulk_memcpy(void *dest, const void *src, size_t len, size_t, T &t) {
+  if (t.isIrrevoc()) {
+    memcpy(dest, src, len);
+    return dest;
+  }
+  uint8_t buf[BULK_STAGING_BYTES];
+  uint8_t *d = (uint8_t *)dest, *s = (uint8_t *)src;
+  while (len > 0) {
+    size_t n = len < BULK_STAGING_BYTES ? len : BULK_STAGING_BYTES;
+    t.readRange(s, buf, n);
+    t.writeRange(d, buf, n);
+    d += n;
+    s += n;
+    len -= n;
+  }
+  return dest;
+}
+
+/// Bulk transactional memset.  This requires the TM algorithm to provide
+/// writeRange, and writes from a private buffer that holds the value.
+template <class T>
+void *tx_bulk_memset(void *dest, int val, size_t len, T &t) {
+  if (t.isIrrevoc()) {
+    memset(dest, val, len);
+    return dest;
+  }
+  uint8_t buf[BULK_STAGING_BYTES];
+  memset(buf, val, len < BULK_STAGING_BYTES ? len : BULK_STAGING_BYTES);
+  uint8_t *d = (uint8_t *)dest;
+  while (len > 0) {
+    size_t n = len < BULK_STAGING_BYTES ? len : BULK_STAGING_BYTES;
+    t.writeRange(d, buf, n);
+    d += n;
+    len -= n;
+  }
+  return dest;
+}
+
+/// Bulk transactional memmove.  This is like tx_bulk_memcpy, except that when
+/// the destination is after the source, it moves pieces starting from the end
+/// of the range.  Since each piece is read completely before it is written,
+/// overlap between the ranges is handled correctly.
+template <class T>
+void *tx_bulk_memmove(void *dest, const void *src, size_t len, T &t) {
+  if (t.isIrrevoc()) {
+    memmove(dest, src, len);
+    return dest;
+  }
+  uint8_t buf[BULK_STAGING_BYTES];
+  uint8_t *d = (uint8_t *)dest, *s = (uint8_t *)src;
+  if (d < s) {
+    return tx_bulk_memcpy(dest, src, len, 0, t);
+  }
+  while (len > 0) {
+    size_t n = len < BULK_STAGING_BYTES ? len : BULK_STAGING_BYTES;
+    len -= n;
+    t.readRange(s + len, buf, n);
+    t.writeRange(d + len, buf, n);
+  }
+  return dest;
+}
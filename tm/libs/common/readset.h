@@ -0,0 +1,101 @@
+/// readset.h provides containers that orec-based STMs can use for their read
+/// sets.  MiniVector<orec_t *> is the simplest read set: it logs every read.
+/// The containers in this file provide the same public interface, so that they
+/// are interchangeable with it in TM algorithms.
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "minivector.h"
+#include "orec_t.h"
+
+/// FilteredReadSet is a read set that drops most duplicate orecs, so that the
+/// cost of validation is bounded by the number of distinct orecs a transaction
+/// reads, rather than by the number of reads it performs (e.g., when it walks
+/// the same tree path many times, or spins on a field).
+///
+/// In front of the vector of orecs is a direct-mapped filter, indexed by the
+/// orec's position in memory.  Each filter entry holds the last orec that was
+/// logged in it, and the read set's version at that time.  An orec is only
+/// added to the vector if its entry does not already hold it for the current
+/// version.  clear() just bumps the version, so that the filter does not need
+/// to be zeroed between transactions.
+///
+/// NB: The filter is direct-mapped, so when two orecs in a read set collide,
+///     each may be logged more than once.  Duplicates are harmless: they only
+///     cost extra validation.
+template <int FILTER_SIZE> class FilteredReadSet {
+  static_assert((FILTER_SIZE & (FILTER_SIZE - 1)) == 0,
+                "FILTER_SIZE must be a power of 2");
+
+  /// A filter entry
+  struct entry_t {
+    /// The orec most recently logged in this entry
+    orec_t *orec;
+
+    /// The version of the read set when orec was logged
+    uintptr_t version;
+  };
+
+  /// The distinct orecs (mostly) of the read set
+  MiniVector<orec_t *> orecs;
+
+  /// The filter
+  entry_t *filter;
+
+  /// The current version.  Version 0 is never used, so a zeroed filter is empty
+  uintptr_t version = 1;
+
+  /// Map an orec to its filter entry.  Orecs are adjacent in the orec table, so
+  /// neighboring orecs map to neighboring entries.
+  static size_t slot(orec_t *o) {
+    return ((uintptr_t)o / sizeof(orec_t)) & (FILTER_SIZE - 1);
+  }
+
+public:
+  /// Construct a FilteredReadSet with an empty filter
+  FilteredReadSet()
+      : filter(static_cast<entry_t *>(calloc(FILTER_SIZE, sizeof(entry_t)))) {}
+
+  /// Reclaim the filter when the FilteredReadSet is destructed
+  ~FilteredReadSet() { free(filter); }
+
+  /// Add an orec to the read set, unless the filter says it is already there
+  void push_back(orec_t *o) {
+    entry_t &e = filter[slot(o)];
+    if (e.orec == o && e.version == version) {
+      return;
+    }
+    e.orec = o;
+    e.version = version;
+    orecs.push_back(o);
+  }
+
+  /// Empty the read set, by bumping the version
+  void clear() {
+    orecs.clear();
+    if (__builtin_expect(++version == 0, false)) {
+      for (int i = 0; i < FILTER_SIZE; ++i) {
+        filter[i].version = 0;
+      }
+      version = 1;
+    }
+  }
+
+  /// Return whether the read set is empty or not
+  bool empty() { return orecs.empty(); }
+
+  /// Return the number of orecs in the read set
+  unsigned long size() const { return orecs.size(); }
+
+  /// Iteration is over the orecs, as with a MiniVector
+  typedef MiniVector<orec_t *>::iterator iterator;
+
+  /// Get an iterator to the first orec
+  iterator begin() const { return orecs.begin(); }
+
+  /// Get an iterator to one past the last orec
+  iterator end() const { return orecs.end(); }
+};
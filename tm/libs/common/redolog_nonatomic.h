@@ -3,6 +3,7 @@
 #include <cassert>
 #include <cstdint>
 #include <cstdlib>
+#include <immintrin.h>
 #include <string.h>
 
 /// RedoLog combines a hash-based index with a vector, so that we can quickly
@@ -19,6 +20,14 @@
 ///     will not be able to log it correctly.  On SPARC, we'd get a bus error
 ///     anyway.  But on x86, such mis-alignment is possible.
 ///
+/// NB: When the build targets AVX2 or AVX-512 (e.g., via -march=native),
+///     lookups compare several index slots at a time, and nonatomic writeback
+///     uses masked vector stores.  Otherwise, we fall back to scalar code.
+///
+/// NB: The RedoLog also keeps a small signature (a Bloom filter with one hash
+///     function) of the chunks it holds, so that reads of addresses that were
+///     never written can skip the hash lookup.  It is cleared by reset().
+///
 /// Warning: This is the "nonatomic" version of the RedoLog.  It is incorrect
 ///          with respect to the C++ memory model, because a thread may write
 ///          back to an address at the same time as some concurrent doomed
@@ -64,6 +73,9 @@ template <int CHUNKSIZE> class RedoLog_Nonatomic {
   /// number of static probes before we resize the list
   static const int SPILL_FACTOR = 3;
 
+  /// number of 64-bit words in the write signature
+  static const int SIG_WORDS = 4;
+
   /// The "hashtable" of the Redo Log
   index_t *index;
 
@@ -85,6 +97,15 @@ template <int CHUNKSIZE> class RedoLog_Nonatomic {
   /// Current # elements in vector
   size_t vector_size;
 
+  /// The write signature: one bit is set for each chunk in the vector
+  uint64_t signature[SIG_WORDS];
+
+  /// Map a chunk's key to a bit of the write signature.  We use the high bits
+  /// of a multiplicative hash, so that strided keys do not collide.
+  static size_t sig_bit(uintptr_t const key) {
+    return (size_t)((key * 0x9E3779B97F4A7C15ull) >> 56) % (64 * SIG_WORDS);
+  }
+
   /// This hash function is straight from CLRS (that's where the magic constant
   /// comes from).
   size_t hash(uintptr_t const key) const {
@@ -142,12 +163,66 @@ template <int CHUNKSIZE> class RedoLog_Nonatomic {
     version = 1;
   }
 
+  /// Write the valid bytes of a chunk back to main memory, without regard for
+  /// the C++ memory model
+  static void writeback_chunk(const writeback_chunk_t &c) {
+    uint8_t *addr = (uint8_t *)c.key;
+#if defined(__AVX512BW__) && defined(__AVX512VL__)
+    // Each mask bit selects one byte, so a masked store writes exactly the
+    // valid bytes, 32 at a time
+    if constexpr (CHUNKSIZE % 32 == 0) {
+      for (int bytes = 0; bytes < CHUNKSIZE; bytes += 32) {
+        __m256i v = _mm256_loadu_si256((__m256i *)(c.data + bytes));
+        _mm256_mask_storeu_epi8(addr + bytes, (__mmask32)(c.mask >> bytes), v);
+      }
+      return;
+    }
+#elif defined(__AVX2__)
+    // AVX2 can only mask 32-bit lanes, so we use a masked store for the groups
+    // of 4 bytes that are entirely valid, and write the rest one byte at a time
+    if constexpr (CHUNKSIZE % 32 == 0) {
+      const __m256i lanes = _mm256_setr_epi32(1, 1 << 4, 1 << 8, 1 << 12,
+                                              1 << 16, 1 << 20, 1 << 24, 1 << 28);
+      for (int bytes = 0; bytes < CHUNKSIZE; bytes += 32) {
+        uint32_t m = (uint32_t)(c.mask >> bytes);
+        uint32_t full = m & (m >> 1) & (m >> 2) & (m >> 3) & 0x11111111;
+        __m256i sel = _mm256_and_si256(_mm256_set1_epi32(full), lanes);
+        _mm256_maskstore_epi32((int *)(addr + bytes),
+                               _mm256_cmpeq_epi32(sel, lanes),
+                               _mm256_loadu_si256((__m256i *)(c.data + bytes)));
+        for (uint32_t rest = m & ~(full * 0xF); rest; rest &= rest - 1) {
+          int b = bytes + __builtin_ctz(rest);
+          addr[b] = c.data[b];
+        }
+      }
+      return;
+    }
+#endif
+    for (int bytes = 0; bytes < CHUNKSIZE; bytes += 4) {
+      // figure out if current 4 bytes are all valid
+      int m = c.mask >> bytes;
+      m = m & 0xF;
+      if (m == 0xF) {
+        // we can write this as a 32-bit word
+        *(uint32_t *)(addr + bytes) = *(uint32_t *)(c.data + bytes);
+      } else if (m != 0) {
+        // write out live bytes, one at a time
+        // NB: an easily-unrolled loop probably outperforms a while loop
+        for (int q = 0; q < 4; ++q) {
+          if (m & 1)
+            addr[bytes + q] = c.data[bytes + q];
+          m >>= 1;
+        }
+      }
+    }
+  }
+
 public:
   /// Construct a RedoLog by providing an initial capacity (default 64)
   RedoLog_Nonatomic(const size_t initial_capacity = 64)
       : index(nullptr), ilength(0), version(1), shift(8 * sizeof(uint32_t)),
         redo_vector(nullptr), vector_capacity(initial_capacity),
-        vector_size(0) {
+        vector_size(0), signature{0} {
     // Find a good index length for the initial capacity of the list.
     while (ilength < SPILL_FACTOR * initial_capacity)
       doubleIndexLength();
@@ -165,6 +240,34 @@ public:
   /// Find the vector index of the chunk containing key, or -1 on failure
   int lookup(uintptr_t key) {
     size_t h = hash(key);
+#ifdef __AVX2__
+    // Compare the (version, address) pairs of four slots at a time.  In the
+    // resulting mask, slot s has bit 2s set if its version is current, and bit
+    // 2s+1 set if its address matches.  When four slots would run past the end
+    // of the index, we finish with the scalar loop, which can wrap around.
+    const __m256i want = _mm256_set_epi64x(key, version, key, version);
+    while (h + 4 <= ilength) {
+      __m256i lo = _mm256_loadu2_m128i((__m128i *)&index[h + 1],
+                                       (__m128i *)&index[h]);
+      __m256i hi = _mm256_loadu2_m128i((__m128i *)&index[h + 3],
+                                       (__m128i *)&index[h + 2]);
+      int m = _mm256_movemask_pd(
+                  _mm256_castsi256_pd(_mm256_cmpeq_epi64(lo, want))) |
+              (_mm256_movemask_pd(
+                   _mm256_castsi256_pd(_mm256_cmpeq_epi64(hi, want)))
+               << 4);
+      int found = m & (m >> 1) & 0x55;
+      int empty = ~m & 0x55;
+      // The probe sequence ends at the first empty slot
+      if (found && (!empty || __builtin_ctz(found) < __builtin_ctz(empty))) {
+        return index[h + __builtin_ctz(found) / 2].index;
+      }
+      if (empty) {
+        return -1;
+      }
+      h += 4;
+    }
+#endif
     while (index[h].version == version) {
       if (index[h].address != key) {
         // use linear probing... given SPILL_FACTOR, we never wrap around
@@ -179,6 +282,9 @@ public:
   /// Fast check if the RedoLog is empty
   bool isEmpty() const { return vector_size == 0; }
 
+  /// Return the number of chunks in the RedoLog
+  size_t size() const { return vector_size; }
+
   /// reserve is effectively the first half of an "upsert".  It finds the vector
   /// entry into which a key should go, or makes that vector entry
   ///
@@ -224,6 +330,9 @@ public:
   /// fast-clear the hash by bumping the version number
   void reset() {
     vector_size = 0;
+    for (int i = 0; i < SIG_WORDS; ++i) {
+      signature[i] = 0;
+    }
     version += 1;
     // check overflow
     if (version != 0)
@@ -237,29 +346,7 @@ public:
   void writeback_nonatomic() {
     // iterate through the slabs, and then write out the bytes
     for (size_t i = 0; i < vector_size; ++i) {
-      for (int bytes = 0; bytes < CHUNKSIZE; bytes += 4) {
-        // figure out if current 4 bytes are all valid
-        int m = redo_vector[i].mask >> bytes;
-        m = m & 0xF;
-        if (m == 0xF) {
-          // we can write this as a 32-bit word
-          uint32_t *addr = (uint32_t *)(redo_vector[i].key + bytes);
-          uint32_t *data = (uint32_t *)(redo_vector[i].data + bytes);
-          *addr = *data;
-        } else if (m != 0) {
-          // write out live bytes, one at a time
-          uint8_t *addr = (uint8_t *)redo_vector[i].key + bytes;
-          uint8_t *data = redo_vector[i].data + bytes;
-          // NB: an easily-unrolled loop probably outperforms a while loop
-          for (int q = 0; q < 4; ++q) {
-            if (m & 1)
-              *addr = *data;
-            ++addr;
-            ++data;
-            m >>= 1;
-          }
-        }
-      }
+      writeback_chunk(redo_vector[i]);
     }
   }
 
@@ -276,6 +363,10 @@ public:
     uintptr_t key = (uintptr_t)addr & ~MASK;
     uint64_t offset = (uintptr_t)addr & MASK;
 
+    // add the chunk to the write signature
+    size_t bit = sig_bit(key);
+    signature[bit / 64] |= 1ull << (bit % 64);
+
     // get slab index, transform into in-slab address where we should write
     int idx = reserve(key);
     uint8_t *dataptr = redo_vector[idx].data;
@@ -294,6 +385,11 @@ public:
     uintptr_t key = (uintptr_t)addr & ~MASK;
     uint64_t offset = (uintptr_t)addr & MASK;
 
+    // if the chunk is not in the write signature, it was never written
+    size_t bit = sig_bit(key);
+    if (!(signature[bit / 64] & (1ull << (bit % 64))))
+      return 0;
+
     // get slab target, see if it's valid
     int idx = lookup(key);
     if (idx == -1)
@@ -311,6 +407,77 @@ public:
     return livebits;
   }
 
+  /// Insert a range of bytes into the RedoLog.  This is the bulk version of
+  /// insert(): it reserves each chunk that the range covers once, and copies
+  /// all of the chunk's bytes at the same time.
+  void insertRange(void *addr, const void *src, size_t len) {
+    uintptr_t a = (uintptr_t)addr;
+    const uint8_t *s = (const uint8_t *)src;
+    while (len > 0) {
+      uintptr_t key = a & ~MASK;
+      uint64_t offset = a & MASK;
+      size_t n = CHUNKSIZE - offset < len ? CHUNKSIZE - offset : len;
+
+      // add the chunk to the write signature
+      size_t bit = sig_bit(key);
+      signature[bit / 64] |= 1ull << (bit % 64);
+
+      // copy the bytes, and update the mask
+      int idx = reserve(key);
+      memcpy(redo_vector[idx].data + offset, s, n);
+      uint64_t mask = n == 64 ? ~0ull : (1ull << n) - 1;
+      redo_vector[idx].mask |= (mask << offset);
+      a += n;
+      s += n;
+      len -= n;
+    }
+  }
+
+  /// Call f on the address of each aligned 8-byte word that writeback will
+  /// modify (e.g., so that a multi-version TM can save the words' old values)
+  template <class F> void forEachWord(F f) const {
+    for (size_t i = 0; i < vector_size; ++i) {
+      for (int w = 0; w < CHUNKSIZE; w += 8) {
+        if ((redo_vector[i].mask >> w) & 0xFF) {
+          f(redo_vector[i].key + w);
+        }
+      }
+    }
+  }
+
+  /// Look up a range of bytes in the RedoLog.  This is the bulk version of
+  /// find() and reconstruct(): dst holds the bytes of the range that were read
+  /// from memory, and any bytes that are in the RedoLog are copied onto them.
+  void findRange(const void *addr, void *dst, size_t len) {
+    uintptr_t a = (uintptr_t)addr;
+    uint8_t *d = (uint8_t *)dst;
+    while (len > 0) {
+      uintptr_t key = a & ~MASK;
+      uint64_t offset = a & MASK;
+      size_t n = CHUNKSIZE - offset < len ? CHUNKSIZE - offset : len;
+
+      // skip chunks that are not in the write signature, or not in the log
+      size_t bit = sig_bit(key);
+      int idx = (signature[bit / 64] & (1ull << (bit % 64))) ? lookup(key) : -1;
+      if (idx != -1) {
+        uint64_t mask = n == 64 ? ~0ull : (1ull << n) - 1;
+        uint64_t live = (redo_vector[idx].mask >> offset) & mask;
+        uint8_t *data = redo_vector[idx].data + offset;
+        if (live == mask) {
+          memcpy(d, data, n);
+        } else {
+          for (; live; live &= live - 1) {
+            int i = __builtin_ctzll(live);
+            d[i] = data[i];
+          }
+        }
+      }
+      a += n;
+      d += n;
+      len -= n;
+    }
+  }
+
   /// Sometimes, a program will have different granularities (byte, int, long)
   /// when accessing the same region of memory at different times, in the same
   /// transaction.  If a smaller-granularity write is followed by a
@@ -346,4 +513,11 @@ public:
   template <typename T> static T perform_transactional_read(T *addr) {
     return *addr;
   }
+
+  /// The bulk version of perform_transactional_read.  As above, we just copy,
+  /// and pretend there isn't a race.
+  static void perform_transactional_read_range(void *dst, const void *addr,
+                                               size_t len) {
+    memcpy(dst, addr, len);
+  }
 };
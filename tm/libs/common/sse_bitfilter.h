@@ -41,7 +41,7 @@ public:
     const uint32_t index = hash(val);
     const uint32_t block = index / WORD_SIZE;
     const uint32_t offset = index % WORD_SIZE;
-    word_filter[block] |= (1u << offset);
+    word_filter[block] |= ((uintptr_t)1 << offset);
   }
 
   /// Set a bit in the filter, based on a provided pointer, but do so with
@@ -50,7 +50,8 @@ public:
     const uint32_t index = hash(val);
     const uint32_t block = index / WORD_SIZE;
     const uint32_t offset = index % WORD_SIZE;
-    atomicswapptr(&word_filter[block], word_filter[block] | (1u << offset));
+    __atomic_fetch_or(&word_filter[block], (uintptr_t)1 << offset,
+                      __ATOMIC_SEQ_CST);
   }
 
   /// Test if the bit corresponding to a pointer is set
@@ -58,7 +59,7 @@ public:
     const uint32_t index = hash(val);
     const uint32_t block = index / WORD_SIZE;
     const uint32_t offset = index % WORD_SIZE;
-    return word_filter[block] & (1u << offset);
+    return word_filter[block] & ((uintptr_t)1 << offset);
   }
 
   /// Modify the SSEBitFilter by unioning it with the provided SSEBitFilter
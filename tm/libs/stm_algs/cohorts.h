@@ -20,10 +20,15 @@
 /// - Stack Frame (to bring some of the caller frame into tx scope)
 /// - Allocator (to employ captured memory optimizations)
 ///
-/// NB: Cohorts does not support irrevocability.  Also, note that the published
-///     cohorts algorithm has a "turbo mode", wherein a the last thread in a
-///     sealed cohort skips all instrumentation for the remainder of its
-///     transaction, and then commits first.  We do not yet support this.
+/// Cohorts also has a "turbo mode".  When a writer finds that it is the last
+/// running transaction in a sealed cohort, it knows that nothing will change
+/// memory until it finishes, and that it can serialize before the rest of the
+/// cohort.  It writes back its redo log, and then skips all instrumentation for
+/// the remainder of its transaction.  It never aborts, and does not take a
+/// commit order.  Instead, it forces the rest of the cohort to validate (even
+/// the first committer, which usually skips validation).
+///
+/// NB: Cohorts does not support irrevocability.
 template <class REDOLOG, class VALUELOG, class STACKFRAME, class ALLOCATOR>
 class Cohorts {
   /// Globals is a wrapper around all of the global variables used by Cohorts
@@ -36,6 +41,9 @@ class Cohorts {
 
     /// Counter for finished transactions
     pad_dword_t FINISHED;
+
+    /// Set when a transaction of the current cohort is in turbo mode
+    pad_dword_t TURBO;
   };
 
   /// All metadata shared among threads
@@ -47,6 +55,9 @@ class Cohorts {
   /// a cache of the cohort state when we began
   uint64_t start_time;
 
+  /// true if this transaction is in turbo mode
+  bool turbo = false;
+
   // a redolog, since this is a lazy TM
   REDOLOG redolog;
 
@@ -67,6 +78,12 @@ public:
   /// Set the current bottom of the transactional part of the stack
   void adjustStackBottom(void *addr) { frame.setBottom(addr); }
 
+  /// Prepare the descriptor to wait in the pool when its thread exits
+  void park() { frame.reset(); }
+
+  /// Prepare a pooled descriptor for use by a new thread
+  void unpark() {}
+
   /// construct a thread's transaction context
   Cohorts() {}
 
@@ -98,6 +115,21 @@ public:
   bool commitTx() {
     // onEnd == false -> flat nesting
     if (frame.onEnd()) {
+      // turbo mode: our writes are already in memory, and serialize before the
+      // rest of the cohort.  Since we took no commit order, we just need to
+      // leave, and then quiesce (as below) before freeing.
+      if (turbo) {
+        turbo = false;
+        uintptr_t seal_snap = globals.SEALED.val;
+        globals.STARTED.val--;
+        while (globals.FINISHED.val < seal_snap) {
+        }
+        allocator.onCommit();
+        deferredActions.onCommit();
+        frame.onCommit();
+        return true;
+      }
+
       // read-only fast path
       if (redolog.isEmpty()) {
         globals.STARTED.val--;
@@ -132,8 +164,16 @@ public:
       // only writeback if validation succeeds
       bool ret = false;
 
+      // If a turbo transaction wrote in place, everyone must validate.  The
+      // last committer resets the flag for the next cohort.
+      bool after_turbo = globals.TURBO.val;
+      if (after_turbo && my_order + 1 == seal_snap) {
+        globals.TURBO.val = 0;
+      }
+
       // No need to validate if first in cohort...
-      if ((my_order == start_time) || valuelog.validate_fastexit_nonatomic()) {
+      if ((my_order == start_time && !after_turbo) ||
+          valuelog.validate_fastexit_nonatomic()) {
         redolog.writeback_atomic();
         ret = true;
       }
@@ -225,7 +265,7 @@ public:
 
   /// Transactional write
   template <typename T> void write(T *ptr, T val) {
-    if (accessDirectly(ptr)) {
+    if (accessDirectly(ptr) || tryTurbo()) {
       *ptr = val;
     } else {
       redolog.insert(ptr, val);
@@ -241,9 +281,29 @@ public:
   }
 
 private:
+  /// Enter turbo mode if this is the only running transaction of a sealed
+  /// cohort.  No transaction can join a sealed cohort, and the rest of the
+  /// cohort waits for us before writing back, so memory has not changed since
+  /// we began, and our reads need no validation.
+  bool tryTurbo() {
+    if (globals.SEALED.val == globals.FINISHED.val ||
+        globals.STARTED.val != 1) {
+      return false;
+    }
+    globals.TURBO.val = 1;
+    turbo = true;
+    redolog.writeback_atomic();
+    redolog.reset();
+    valuelog.clear();
+    return true;
+  }
+
   /// Check if the given address is on the thread's stack or was allocated by
-  /// the thread, and hence does not need instrumentation
+  /// the thread, or if the thread is in turbo mode, and hence does not need
+  /// instrumentation
   bool accessDirectly(void *ptr) {
+    if (turbo)
+      return true;
     if (allocator.checkCaptured(ptr))
       return true;
     return frame.onStack(ptr);
@@ -1,9 +1,9 @@
 #pragma once
 
 #include <atomic>
-#include <setjmp.h>
 #include <x86intrin.h>
 
+#include "../common/checkpoint.h"
 #include "../common/deferred.h"
 #include "../common/pad_word.h"
 #include "../common/platform.h"
@@ -56,7 +56,7 @@ class HybridNOrecTwoCounter {
 
   /// Checkpoint lets us reset registers and the instruction pointer in the
   /// event of an abort
-  jmp_buf *checkpoint;
+  checkpoint_t *checkpoint;
 
   /// For managing thread IDs, Quiescence, and Irrevocability
   EPOCH epoch;
@@ -96,6 +96,15 @@ public:
   /// Set the current bottom of the transactional part of the stack
   void adjustStackBottom(void *addr) { frame.setBottom(addr); }
 
+  /// Prepare the descriptor to wait in the pool when its thread exits
+  void park() {
+    epoch.park();
+    frame.reset();
+  }
+
+  /// Prepare a pooled descriptor for use by a new thread
+  void unpark() { epoch.unpark(); }
+
   /// construct a thread's transaction context
   HybridNOrecTwoCounter() : epoch(globals.epoch), cm(), htm_path(false) {}
 
@@ -150,7 +159,7 @@ public:
   }
 
   /// Instrumentation to run at the beginning of an STM transaction
-  void beginSTM(jmp_buf *b) {
+  void beginSTM(checkpoint_t *b) {
     // onBegin == false -> flat nesting
     if (frame.onBegin()) {
       // Save the checkpoint and set the stack bottom
@@ -446,7 +455,7 @@ private:
     allocator.onAbort(); // this reclaims all mallocs
     deferredActions.onAbort();
     frame.onAbort();
-    longjmp(*checkpoint, 1); // Takes us back to calling beginTx()
+    restore_checkpoint(checkpoint); // Takes us back to calling beginTx()
   }
 
   /// Check if the given address is on the thread's stack, and hence does not
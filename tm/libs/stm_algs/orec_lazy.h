@@ -1,13 +1,14 @@
 #pragma once
 
 #include <atomic>
-#include <setjmp.h>
 
+#include "../common/checkpoint.h"
 #include "../common/deferred.h"
 #include "../common/minivector.h"
 #include "../common/orec_t.h"
 #include "../common/pad_word.h"
 #include "../common/platform.h"
+#include "../common/stats.h"
 
 /// OrecLazy is an STM algorithm with the following characteristics:
 /// - Uses orecs for commit-time write locking, optimistic read locking
@@ -16,13 +17,15 @@
 ///
 /// OrecLazy can be customized in the following ways:
 /// - Size of orec table
+/// - Read Set (e.g., to filter out duplicate orecs)
 /// - Redo Log (data structure and granularity of chunks)
 /// - EpochManager (quiescence and irrevocability)
 /// - Contention manager
 /// - Stack Frame (to bring some of the caller frame into tx scope)
 /// - Allocator (to become irrevocable on too many allocations)
-template <class ORECTABLE, class REDOLOG, class EPOCH, class CM,
-          class STACKFRAME, class ALLOCATOR>
+/// - Statistics (per-thread counters, or nothing)
+template <class ORECTABLE, class READSET, class REDOLOG, class EPOCH, class CM,
+          class STACKFRAME, class ALLOCATOR, class STATS>
 class OrecLazy {
   /// Globals is a wrapper around all of the global variables used by OrecLazy
   struct Globals {
@@ -34,6 +37,9 @@ class OrecLazy {
 
     /// Quiescence support
     typename EPOCH::Globals epoch;
+
+    /// Statistics aggregation
+    typename STATS::Globals stats;
   };
 
   /// All metadata shared among threads
@@ -41,7 +47,7 @@ class OrecLazy {
 
   /// Checkpoint lets us reset registers and the instruction pointer in the
   /// event of an abort
-  jmp_buf *checkpoint = nullptr;
+  checkpoint_t *checkpoint = nullptr;
 
   /// For managing thread IDs, Quiescence, and Irrevocability
   EPOCH epoch;
@@ -59,7 +65,7 @@ class OrecLazy {
   uint64_t my_lock;
 
   /// all of the orecs this transaction has read
-  MiniVector<orec_t *> readset;
+  READSET readset;
 
   /// all of the orecs this transaction has locked
   MiniVector<orec_t *> lockset;
@@ -67,6 +73,23 @@ class OrecLazy {
   /// a redolog, since this is a lazy TM
   REDOLOG redolog;
 
+  /// True when the transaction began read-only, in which case it has no redo
+  /// log to search, and a write upgrades it to a writer and restarts it
+  bool read_only = false;
+
+  /// The number of upcoming read-only transactions that run as writers.  When
+  /// a read-only transaction upgrades, the next RW_FALLBACK transactions that
+  /// begin read-only (starting with the restart) run as writers, so that a call
+  /// site that was wrongly launched as read-only pays for one restart every
+  /// RW_FALLBACK executions, rather than every time.  beginTx() does not know
+  /// the call site, so the fallback is per thread: read-only call sites that
+  /// run in the window merely lose the read-only fast path.
+  int rw_fallback = 0;
+
+  /// The length of the window in which read-only transactions run as writers
+  /// after an upgrade
+  static const int RW_FALLBACK = 64;
+
   /// The allocator manages malloc, free, and aligned alloc
   ALLOCATOR allocator;
 
@@ -74,6 +97,9 @@ class OrecLazy {
   /// commit.
   DeferredActionHandler deferredActions;
 
+  /// Per-thread statistics counters
+  STATS stats;
+
 public:
   /// Return the irrevocability state of the thread
   bool isIrrevoc() { return epoch.isIrrevoc(); }
@@ -81,22 +107,38 @@ public:
   /// Set the current bottom of the transactional part of the stack
   void adjustStackBottom(void *addr) { frame.setBottom(addr); }
 
+  /// Prepare the descriptor to wait in the pool when its thread exits
+  void park() {
+    epoch.park();
+    frame.reset();
+  }
+
+  /// Prepare a pooled descriptor for use by a new thread
+  void unpark() { epoch.unpark(); }
+
   /// construct a thread's transaction context by zeroing its nesting depth and
   /// giving it an ID.  We also cache its lock token.
-  OrecLazy() : epoch(globals.epoch), cm() {
+  OrecLazy() : epoch(globals.epoch), cm(), stats(globals.stats, epoch.id) {
     my_lock = ORECTABLE::make_lockword(epoch.id);
   }
 
-  /// Instrumentation to run at the beginning of a transaction boundary.
-  void beginTx(jmp_buf *b) {
+  /// Instrumentation to run at the beginning of a transaction boundary.  A
+  /// read-only transaction runs as a writer if a recent read-only transaction
+  /// had to upgrade.
+  void beginTx(checkpoint_t *b, bool ro = false) {
     // onBegin == false -> flat nesting
     if (frame.onBegin()) {
       // Save the checkpoint and set the stack bottom
       checkpoint = b;
       frame.setBottom(b);
+      read_only = ro && rw_fallback == 0;
+      if (ro && rw_fallback > 0) {
+        --rw_fallback;
+      }
 
       // Start logging allocations
       allocator.onBegin();
+      stats.onBegin();
 
       // Get the start time, and put it into the epoch.  epoch.onBegin will wait
       // until there are no irrevocable transactions.
@@ -119,6 +161,7 @@ public:
       if (epoch.isIrrevoc()) {
         epoch.onCommitIrrevoc(globals.epoch);
         cm.afterCommit(globals.cm);
+        stats.onCommitIrrevoc();
         deferredActions.onCommit();
         frame.onCommit();
         return;
@@ -126,6 +169,7 @@ public:
       // fast-path for read-only transactions must still quiesce before freeing
       if (lockset.empty()) {
         epoch.clearEpoch(globals.epoch);
+        stats.onCommit(readset.size(), 0);
         readset.clear();
         cm.afterCommit(globals.cm);
         epoch.quiesce(globals.epoch, start_time);
@@ -147,7 +191,7 @@ public:
         for (auto i : readset) {
           uint64_t v = i->curr;
           if (v > start_time && v != my_lock) {
-            abortTx();
+            abortTx(ABORT_VALIDATION, i);
           }
         }
       }
@@ -161,6 +205,7 @@ public:
       releaseLocks(end_time);
 
       // clear lists.  Quiesce before freeing
+      stats.onCommit(readset.size(), lockset.size());
       redolog.reset();
       lockset.clear();
       readset.clear();
@@ -198,7 +243,7 @@ public:
     // Lookup in redo log to populate ret.  Note that prior casting can lead to
     // ret having only some bytes properly set
     T ret;
-    int found_mask = redolog.find(addr, ret);
+    int found_mask = read_only ? 0 : redolog.find(addr, ret);
     // If we found all the bytes in the redo log, then it's easy
     int desired_mask = (1UL << sizeof(T)) - 1;
     if (desired_mask == found_mask) {
@@ -248,6 +293,9 @@ public:
     if (accessDirectly(addr)) {
       *addr = val;
     } else {
+      if (read_only) {
+        upgrade();
+      }
       redolog.insert(addr, val);
       // get the orec addr
       orec_t *o = globals.orecs.get(addr);
@@ -255,6 +303,97 @@ public:
     }
   }
 
+  /// Transactional bulk read: copy len bytes from addr into the private buffer
+  /// dst.  Each orec that the range covers is read and logged once, rather
+  /// than once per word.
+  void readRange(const void *addr, void *dst, size_t len) {
+    uintptr_t a = (uintptr_t)addr, end = a + len;
+    uint8_t *d = (uint8_t *)dst;
+    orec_t *last = nullptr;
+    while (a < end) {
+      // Work on the part of the range that maps to one orec
+      uintptr_t next = (a | (ORECTABLE::GRANULE - 1)) + 1;
+      next = next < end ? next : end;
+      size_t n = next - a;
+      bool first_direct = accessDirectly((void *)a);
+      bool last_direct = accessDirectly((void *)(next - 1));
+      if (first_direct && last_direct) {
+        memcpy(d, (void *)a, n);
+      } else if (first_direct != last_direct) {
+        // Part of the piece is captured: let read() decide for each byte
+        for (size_t i = 0; i < n; ++i) {
+          d[i] = read((uint8_t *)a + i);
+        }
+      } else {
+        // Read the orec, then the piece, then the orec, as in read()
+        orec_t *o = globals.orecs.get((void *)a);
+        while (true) {
+          local_orec_t pre, post;
+          pre.all = o->curr; // fenced read of o->curr
+          REDOLOG::perform_transactional_read_range(d, (void *)a, n);
+          post.all = o->curr; // fenced read of o->curr
+          if ((pre.all == post.all) && (pre.all <= start_time)) {
+            if (o != last) {
+              readset.push_back(o);
+              last = o;
+            }
+            break;
+          }
+          while (post.fields.lock) {
+            post.all = o->curr;
+          }
+          uintptr_t newts = globals.orecs.get_time_strong_ordering();
+          epoch.setEpoch(globals.epoch, newts);
+          validate();
+          start_time = newts;
+        }
+        // Overlay any bytes that this transaction already wrote
+        if (!redolog.isEmpty()) {
+          redolog.findRange((void *)a, d, n);
+        }
+      }
+      a = next;
+      d += n;
+    }
+  }
+
+  /// Transactional bulk write: copy len bytes from the private buffer src to
+  /// addr.  The redo log reserves each chunk once, and each orec that the range
+  /// covers is added to the lockset once.
+  void writeRange(void *addr, const void *src, size_t len) {
+    uintptr_t a = (uintptr_t)addr, end = a + len;
+    const uint8_t *s = (const uint8_t *)src;
+    orec_t *last = nullptr;
+    while (a < end) {
+      // Work on the part of the range that maps to one orec
+      uintptr_t next = (a | (ORECTABLE::GRANULE - 1)) + 1;
+      next = next < end ? next : end;
+      size_t n = next - a;
+      bool first_direct = accessDirectly((void *)a);
+      bool last_direct = accessDirectly((void *)(next - 1));
+      if (first_direct && last_direct) {
+        memcpy((void *)a, s, n);
+      } else if (first_direct != last_direct) {
+        // Part of the piece is captured: let write() decide for each byte
+        for (size_t i = 0; i < n; ++i) {
+          write((uint8_t *)a + i, s[i]);
+        }
+      } else {
+        if (read_only) {
+          upgrade();
+        }
+        redolog.insertRange((void *)a, s, n);
+        orec_t *o = globals.orecs.get((void *)a);
+        if (o != last) {
+          lockset.push_back(o);
+          last = o;
+        }
+      }
+      a = next;
+      s += n;
+    }
+  }
+
   /// Instrumentation to become irrevocable in-flight.  This is essentially an
   /// early commit
   void becomeIrrevocable() {
@@ -265,7 +404,7 @@ public:
 
     // try_irrevoc will return true only if we got the token and quiesced
     if (!epoch.tryIrrevoc(globals.epoch)) {
-      abortTx();
+      abortTx(ABORT_IRREVOC);
     }
 
     // now validate.  If it fails, release irrevocability so other transactions
@@ -275,12 +414,13 @@ public:
       lo.all = o->curr;
       if (lo.all > start_time) {
         epoch.onCommitIrrevoc(globals.epoch);
-        abortTx();
+        abortTx(ABORT_VALIDATION, o);
       }
     }
 
     // replay redo log
     redolog.writeback_nonatomic();
+    stats.onIrrevoc();
 
     // clear lists
     allocator.onCommit();
@@ -294,6 +434,9 @@ public:
     deferredActions.registerHandler(func, args);
   }
 
+  /// Print the statistics of all threads
+  static void reportStats() { globals.stats.report(); }
+
 private:
   /// Validation.  We need to make sure that all orecs that we've read
   /// have timestamps older than our start time, unless we locked those orecs.
@@ -310,19 +453,44 @@ private:
       to_abort |= (o->curr > start_time);
     }
     if (to_abort) {
-      abortTx();
+      // Find an offending orec, so that the abort can be attributed to it
+      for (auto o : readset) {
+        if (o->curr > start_time) {
+          abortTx(ABORT_VALIDATION, o);
+        }
+      }
+      abortTx(ABORT_VALIDATION);
     }
   }
 
   /// Abort the transaction.  We must handle mallocs and frees, and we need to
   /// ensure that the OrecLazy object is in an appropriate state for starting a
   /// new transaction.  Note that we *will* call beginTx again, unlike libITM.
-  void abortTx() {
+  ///
+  /// The cause of the abort, and the orec that caused it, are reported to the
+  /// StatsManager.
+  void abortTx(abort_cause_t cause, orec_t *o = nullptr) {
     // We can exit the Epoch right away, so that other threads don't have to
     // wait on this thread.
     epoch.clearEpoch(globals.epoch);
     cm.afterAbort(globals.cm, epoch.id);
+    stats.onAbort(cause, o ? globals.orecs.index_of(o) : NO_OREC);
+    rollback();
+  }
+
+  /// A read-only transaction tried to write: restart it as a writer.  This is
+  /// not a conflict, so unlike abortTx(), it does not notify the contention
+  /// manager (which would back off), and it is counted as an upgrade rather
+  /// than as an abort.
+  void upgrade() {
+    rw_fallback = RW_FALLBACK;
+    epoch.clearEpoch(globals.epoch);
+    stats.onUpgrade();
+    rollback();
+  }
 
+  /// Undo the effects of the current attempt, and go back to beginTx()
+  void rollback() {
     // release any locks held by this thread
     for (auto o : lockset) {
       if (o->curr == my_lock) {
@@ -337,7 +505,7 @@ private:
     allocator.onAbort(); // this reclaims all mallocs
     deferredActions.onAbort();
     frame.onAbort();
-    longjmp(*checkpoint, 1); // Takes us back to calling beginTx()
+    restore_checkpoint(checkpoint); // Takes us back to calling beginTx()
   }
 
   /// Check if the given address is on the thread's stack, and hence does not
@@ -361,13 +529,13 @@ private:
       // If lock unheld, acquire; abort on fail to acquire
       if (pre.all <= start_time) {
         if (!o->curr.compare_exchange_strong(pre.all, my_lock)) {
-          abortTx();
+          abortTx(ABORT_LOCK_CAS, o);
         }
         o->prev = pre.all;
       }
       // If lock is not held by me, abort
       else if (pre.all != my_lock) {
-        abortTx();
+        abortTx(pre.fields.lock ? ABORT_LOCKED : ABORT_TOO_NEW, o);
       }
     }
   }
@@ -1,13 +1,14 @@
 #pragma once
 
 #include <atomic>
-#include <setjmp.h>
 
+#include "../common/checkpoint.h"
 #include "../common/deferred.h"
 #include "../common/minivector.h"
 #include "../common/orec_t.h"
 #include "../common/pad_word.h"
 #include "../common/platform.h"
+#include "../common/stats.h"
 
 /// OrecMixed is an STM algorithm with the following characteristics:
 /// - Uses orecs for encounter-time locking, optimistic read locking
@@ -21,8 +22,9 @@
 /// - Contention manager
 /// - Stack Frame (to bring some of the caller frame into tx scope)
 /// - Allocator (become irrevocable on too many allocations / captured memory)
+/// - Statistics (per-thread counters, or nothing)
 template <class ORECTABLE, class REDOLOG, class EPOCH, class CM,
-          class STACKFRAME, class ALLOCATOR>
+          class STACKFRAME, class ALLOCATOR, class STATS>
 class OrecMixed {
   /// Globals is a wrapper around all of the global variables used by OrecMixed
   struct Globals {
@@ -34,6 +36,9 @@ class OrecMixed {
 
     /// Quiescence support
     typename EPOCH::Globals epoch;
+
+    /// Statistics aggregation
+    typename STATS::Globals stats;
   };
 
   /// All metadata shared among threads
@@ -41,7 +46,7 @@ class OrecMixed {
 
   /// Checkpoint lets us reset registers and the instruction pointer in the
   /// event of an abort
-  jmp_buf *checkpoint = nullptr;
+  checkpoint_t *checkpoint = nullptr;
 
   /// For managing thread IDs, Quiescence, and Irrevocability
   EPOCH epoch;
@@ -74,6 +79,9 @@ class OrecMixed {
   /// commit.
   DeferredActionHandler deferredActions;
 
+  /// Per-thread statistics counters
+  STATS stats;
+
 public:
   /// Return the irrevocability state of the thread
   bool isIrrevoc() { return epoch.isIrrevoc(); }
@@ -81,14 +89,23 @@ public:
   /// Set the current bottom of the transactional part of the stack
   void adjustStackBottom(void *addr) { frame.setBottom(addr); }
 
+  /// Prepare the descriptor to wait in the pool when its thread exits
+  void park() {
+    epoch.park();
+    frame.reset();
+  }
+
+  /// Prepare a pooled descriptor for use by a new thread
+  void unpark() { epoch.unpark(); }
+
   /// construct a thread's transaction context by zeroing its nesting depth and
   /// giving it an ID.  We also cache its lock token.
-  OrecMixed() : epoch(globals.epoch), cm() {
+  OrecMixed() : epoch(globals.epoch), cm(), stats(globals.stats, epoch.id) {
     my_lock = ORECTABLE::make_lockword(epoch.id);
   }
 
   /// Instrumentation to run at the beginning of a transaction boundary.
-  void beginTx(jmp_buf *b) {
+  void beginTx(checkpoint_t *b) {
     // onBegin == false -> flat nesting
     if (frame.onBegin()) {
       // Save the checkpoint and set the stack bottom
@@ -97,6 +114,7 @@ public:
 
       // Start logging allocations
       allocator.onBegin();
+      stats.onBegin();
 
       // Get the start time, and put it into the epoch.  epoch.onBegin will wait
       // until there are no irrevocable transactions.
@@ -119,6 +137,7 @@ public:
       if (epoch.isIrrevoc()) {
         epoch.onCommitIrrevoc(globals.epoch);
         cm.afterCommit(globals.cm);
+        stats.onCommitIrrevoc();
         deferredActions.onCommit();
         frame.onCommit();
         return;
@@ -126,6 +145,7 @@ public:
       // fast-path for read-only transactions must still quiesce before freeing
       if (lockset.empty()) {
         epoch.clearEpoch(globals.epoch);
+        stats.onCommit(readset.size(), 0);
         readset.clear();
         cm.afterCommit(globals.cm);
         epoch.quiesce(globals.epoch, start_time);
@@ -144,7 +164,7 @@ public:
         for (auto i : readset) {
           uint64_t v = i->curr;
           if (v > start_time && v != my_lock) {
-            abortTx();
+            abortTx(ABORT_VALIDATION, i);
           }
         }
       }
@@ -158,6 +178,7 @@ public:
       releaseLocks(end_time);
 
       // clear lists.  Quiesce before freeing
+      stats.onCommit(readset.size(), lockset.size());
       redolog.reset();
       lockset.clear();
       readset.clear();
@@ -229,7 +250,7 @@ public:
 
       // other threads locked this orec
       if (post.fields.lock) {
-        abortTx();
+        abortTx(ABORT_LOCKED, o);
       }
 
       // validate and then update start time, because orec is unlocked but too
@@ -264,7 +285,7 @@ public:
       // If lock unheld, acquire; abort on fail to acquire
       if (pre.all <= start_time) {
         if (!o->curr.compare_exchange_strong(pre.all, my_lock)) {
-          abortTx();
+          abortTx(ABORT_LOCK_CAS, o);
         }
         lockset.push_back(o);
         o->prev = pre.all; // for easy undo on abort... Cf. incarnation numbers
@@ -274,7 +295,7 @@ public:
       }
       // If lock held by other, abort
       else if (pre.fields.lock) {
-        abortTx();
+        abortTx(ABORT_LOCKED, o);
       }
       // Lock unheld, but too new... validate and then go to top
       else {
@@ -299,7 +320,7 @@ public:
 
     // try_irrevoc will return true only if we got the token and quiesced
     if (!epoch.tryIrrevoc(globals.epoch)) {
-      abortTx();
+      abortTx(ABORT_IRREVOC);
     }
 
     // now validate.  If it fails, release irrevocability so other transactions
@@ -309,12 +330,13 @@ public:
       lo.all = o->curr;
       if (lo.all > start_time && lo.all != my_lock) {
         epoch.onCommitIrrevoc(globals.epoch);
-        abortTx();
+        abortTx(ABORT_VALIDATION, o);
       }
     }
 
     // replay redo log
     redolog.writeback_nonatomic();
+    stats.onIrrevoc();
 
     // clear lists
     allocator.onCommit();
@@ -335,6 +357,9 @@ public:
     deferredActions.registerHandler(func, args);
   }
 
+  /// Print the statistics of all threads
+  static void reportStats() { globals.stats.report(); }
+
 private:
   /// Validation.  We need to make sure that all orecs that we've read
   /// have timestamps older than our start time, unless we locked those orecs.
@@ -353,16 +378,28 @@ private:
       to_abort |= (lo.all > start_time && lo.all != my_lock);
     }
     if (to_abort) {
-      abortTx();
+      // Find an offending orec, so that the abort can be attributed to it
+      for (auto o : readset) {
+        local_orec_t lo;
+        lo.all = o->curr;
+        if (lo.all > start_time && lo.all != my_lock) {
+          abortTx(ABORT_VALIDATION, o);
+        }
+      }
+      abortTx(ABORT_VALIDATION);
     }
   }
 
   /// Abort the transaction
-  void abortTx() {
+  ///
+  /// The cause of the abort, and the orec that caused it, are reported to the
+  /// StatsManager.
+  void abortTx(abort_cause_t cause, orec_t *o = nullptr) {
     // We can exit the Epoch right away, so that other threads don't have to
     // wait on this thread.
     epoch.clearEpoch(globals.epoch);
     cm.afterAbort(globals.cm, epoch.id);
+    stats.onAbort(cause, o ? globals.orecs.index_of(o) : NO_OREC);
 
     // release any locks held by this thread
     // NB: possible extra fences
@@ -379,7 +416,7 @@ private:
     allocator.onAbort(); // this reclaims all mallocs
     deferredActions.onAbort();
     frame.onAbort();
-    longjmp(*checkpoint, 1); // Takes us back to calling beginTx()
+    restore_checkpoint(checkpoint); // Takes us back to calling beginTx()
   }
 
   /// Check if the given address is on the thread's stack, and hence does not
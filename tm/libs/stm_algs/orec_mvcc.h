@@ -0,0 +1,617 @@
+#pragma once
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+#include "../common/checkpoint.h"
+#include "../common/deferred.h"
+#include "../common/minivector.h"
+#include "../common/orec_t.h"
+#include "../common/pad_word.h"
+#include "../common/platform.h"
+#include "../common/stats.h"
+
+/// OrecMVCC is an STM algorithm with the following characteristics:
+/// - Uses orecs for commit-time write locking, optimistic read locking
+/// - Uses a global clock (counter) to avoid validation
+/// - Performs speculative writes out of place (uses redo)
+/// - Keeps old versions of the words that writers overwrite, so that read-only
+///   transactions can read from a snapshot, and never abort
+///
+/// OrecMVCC can be customized in the following ways:
+/// - Size of orec table
+/// - Read Set (e.g., to filter out duplicate orecs)
+/// - Redo Log (data structure and granularity of chunks)
+/// - EpochManager (quiescence and irrevocability)
+/// - Contention manager
+/// - Stack Frame (to bring some of the caller frame into tx scope)
+/// - Allocator (to become irrevocable on too many allocations)
+/// - Statistics (per-thread counters, or nothing)
+///
+/// Each orec has a history: a list of versions, newest first.  When a writer
+/// commits at time T, then while it holds the orec, and before it writes back,
+/// it adds a version (T, word, old value) for each word that it will
+/// overwrite.  A transaction that has not written starts in read-only mode, and
+/// reads from its snapshot (its start time): if an orec is newer than the
+/// snapshot, the value is rebuilt from memory by applying the old values of all
+/// versions newer than the snapshot.  Such a read can't be validated, so if the
+/// transaction later writes, it aborts and restarts in update mode, where reads
+/// behave as in OrecLazy.  Reads in read-only mode are still logged, so that a
+/// transaction that never read an old version can upgrade without aborting.
+///
+/// Old versions are reclaimed using quiescence.  After a writer quiesces at its
+/// commit time T, no transaction can have a snapshot older than T, so every
+/// version with a time <= T is obsolete.  Writers advance a global "horizon" to
+/// T after quiescing.  When a later writer locks an orec, it unlinks the
+/// obsolete suffix of the orec's history, and frees it after its own
+/// quiescence, since concurrent readers may still be traversing it.  For this
+/// to work, a transaction's published epoch must never be newer than its
+/// snapshot, so beginTx re-reads the clock after publishing its epoch.
+///
+/// NB: Read-only transactions wait (rather than abort) when they find an orec
+///     locked by a committing writer.
+///
+/// NB: Versions are word-sized, so reads and writes that cross words are split
+///     into one access per word.  Irrevocable transactions write in place, but
+///     they run alone, so no snapshot can need the values they overwrite.
+template <class ORECTABLE, class READSET, class REDOLOG, class EPOCH, class CM,
+          class STACKFRAME, class ALLOCATOR, class STATS>
+class OrecMVCC {
+  /// An old version of a word
+  struct version_t {
+    /// The commit time of the writer that overwrote the word
+    uint64_t time;
+
+    /// The (8-byte aligned) address of the word
+    uintptr_t addr;
+
+    /// The value of the word before the writer overwrote it
+    uint64_t value;
+
+    /// The next (older) version of a word covered by the same orec
+    std::atomic<version_t *> next;
+  };
+
+  /// Globals is a wrapper around all of the global variables used by OrecMVCC
+  struct Globals {
+    /// The table of orecs for concurrency control
+    ORECTABLE orecs;
+
+    /// The heads of the orecs' histories, indexed like the orecs
+    std::atomic<version_t *> *history;
+
+    /// Versions with times up to the horizon are no longer needed by any
+    /// transaction
+    pad_dword_t horizon;
+
+    /// The contention management metadata
+    typename CM::Globals cm;
+
+    /// Quiescence support
+    typename EPOCH::Globals epoch;
+
+    /// Statistics aggregation
+    typename STATS::Globals stats;
+
+    /// Construct the Globals by allocating an empty history for each orec
+    Globals() {
+      history = static_cast<std::atomic<version_t *> *>(
+          calloc(orecs.size(), sizeof(std::atomic<version_t *>)));
+    }
+  };
+
+  /// All metadata shared among threads
+  static Globals globals;
+
+  /// Checkpoint lets us reset registers and the instruction pointer in the
+  /// event of an abort
+  checkpoint_t *checkpoint = nullptr;
+
+  /// For managing thread IDs, Quiescence, and Irrevocability
+  EPOCH epoch;
+
+  /// Contention manager
+  CM cm;
+
+  /// For managing the stack frame
+  STACKFRAME frame;
+
+  /// The value of the global clock when this transaction started/validated
+  typename ORECTABLE::time_snapshot_t start_time = 0;
+
+  /// The lock token used by this thread
+  uint64_t my_lock;
+
+  /// true if this transaction must run in update mode (i.e., it aborted
+  /// because it wrote after reading an old version)
+  bool update_mode = false;
+
+  /// true if this transaction read an old version in read-only mode
+  bool read_old = false;
+
+  /// all of the orecs this transaction has read
+  READSET readset;
+
+  /// all of the orecs this transaction has locked
+  MiniVector<orec_t *> lockset;
+
+  /// a redolog, since this is a lazy TM
+  REDOLOG redolog;
+
+  /// versions unlinked from histories, to free after the next quiescence
+  MiniVector<version_t *> limbo;
+
+  /// The allocator manages malloc, free, and aligned alloc
+  ALLOCATOR allocator;
+
+  /// deferredActions manages all functions that should run after transaction
+  /// commit.
+  DeferredActionHandler deferredActions;
+
+  /// Per-thread statistics counters
+  STATS stats;
+
+public:
+  /// Return the irrevocability state of the thread
+  bool isIrrevoc() { return epoch.isIrrevoc(); }
+
+  /// Set the current bottom of the transactional part of the stack
+  void adjustStackBottom(void *addr) { frame.setBottom(addr); }
+
+  /// Prepare the descriptor to wait in the pool when its thread exits
+  void park() {
+    epoch.park();
+    frame.reset();
+  }
+
+  /// Prepare a pooled descriptor for use by a new thread
+  void unpark() { epoch.unpark(); }
+
+  /// construct a thread's transaction context by zeroing its nesting depth and
+  /// giving it an ID.  We also cache its lock token.
+  OrecMVCC() : epoch(globals.epoch), cm(), stats(globals.stats, epoch.id) {
+    my_lock = ORECTABLE::make_lockword(epoch.id);
+  }
+
+  /// Instrumentation to run at the beginning of a transaction boundary.
+  void beginTx(checkpoint_t *b) {
+    // onBegin == false -> flat nesting
+    if (frame.onBegin()) {
+      // Save the checkpoint and set the stack bottom
+      checkpoint = b;
+      frame.setBottom(b);
+
+      // Start logging allocations
+      allocator.onBegin();
+      stats.onBegin();
+
+      // Get the start time, and put it into the epoch.  epoch.onBegin will wait
+      // until there are no irrevocable transactions.  Then make sure that the
+      // clock did not advance before the epoch was published: a writer that
+      // quiesced without seeing us must not reclaim versions that we need.
+      start_time = globals.orecs.get_time_strong_ordering();
+      epoch.onBegin(globals.epoch, start_time);
+      uintptr_t now;
+      while ((now = globals.orecs.get_time_strong_ordering()) != start_time) {
+        start_time = now;
+        epoch.setEpoch(globals.epoch, start_time);
+      }
+
+      // Notify CM of intention to start.  If return true, become irrevocable
+      if (cm.beforeBegin(globals.cm)) {
+        becomeIrrevocable();
+      }
+    }
+  }
+
+  /// Instrumentation to run at the end of a transaction boundary.
+  void commitTx() {
+    // onEnd == false -> flat nesting
+    if (frame.onEnd()) {
+      // Irrevocable commit is easy, because we reset the lists when we became
+      // irrevocable
+      if (epoch.isIrrevoc()) {
+        epoch.onCommitIrrevoc(globals.epoch);
+        cm.afterCommit(globals.cm);
+        stats.onCommitIrrevoc();
+        update_mode = false;
+        deferredActions.onCommit();
+        frame.onCommit();
+        return;
+      }
+      // fast-path for read-only transactions must still quiesce before freeing
+      if (lockset.empty()) {
+        epoch.clearEpoch(globals.epoch);
+        stats.onCommit(readset.size(), 0);
+        readset.clear();
+        read_old = false;
+        update_mode = false;
+        cm.afterCommit(globals.cm);
+        epoch.quiesce(globals.epoch, start_time);
+        allocator.onCommit();
+        deferredActions.onCommit();
+        frame.onCommit();
+        return;
+      }
+      // Commit a writer transaction:
+
+      // acquire all locks for the write set
+      acquireLocks();
+
+      // get a commit time (includes memory fence)
+      uint64_t end_time = globals.orecs.increment_get();
+      // validate if there were any intervening commits
+      if (end_time != start_time + 1) {
+        for (auto i : readset) {
+          uint64_t v = i->curr;
+          if (v > start_time && v != my_lock) {
+            abortTx(ABORT_VALIDATION, i);
+          }
+        }
+      }
+
+      // save the old versions of the words we will overwrite, then write back
+      saveVersions(end_time);
+      redolog.writeback_atomic();
+
+      // depart epoch table (fence) and then release locks
+      // NB: these stores may result in unnecessary fences
+      epoch.clearEpoch(globals.epoch);
+      releaseLocks(end_time);
+
+      // clear lists.  Quiesce before freeing
+      stats.onCommit(readset.size(), lockset.size());
+      redolog.reset();
+      lockset.clear();
+      readset.clear();
+      update_mode = false;
+      cm.afterCommit(globals.cm);
+      epoch.quiesce(globals.epoch, end_time);
+
+      // No snapshot is older than end_time anymore, so versions up to
+      // end_time are obsolete, and unlinked versions are unreachable
+      uintptr_t h = globals.horizon.val;
+      while (h < end_time &&
+             !globals.horizon.val.compare_exchange_weak(h, end_time)) {
+      }
+      for (auto v : limbo) {
+        free(v);
+      }
+      limbo.clear();
+      allocator.onCommit();
+      deferredActions.onCommit();
+      frame.onCommit();
+    }
+  }
+
+  /// To allocate memory, we must also log it, so we can reclaim it if the
+  /// transaction aborts
+  void *txAlloc(size_t size) {
+    return allocator.alloc(size, [&]() { becomeIrrevocable(); });
+  }
+
+  /// To allocate aligned memory, we must also log it, so we can reclaim it if
+  /// the transaction aborts
+  void *txAAlloc(size_t A, size_t size) {
+    return allocator.alignAlloc(A, size, [&]() { becomeIrrevocable(); });
+  }
+
+  /// To free memory, we simply wait until the transaction has committed, and
+  /// then we free.
+  void txFree(void *addr) { allocator.reclaim(addr); }
+
+  /// Transactional read:
+  template <typename T> T read(T *addr) {
+    // No instrumentation if on stack or we're irrevocable
+    if (accessDirectly(addr)) {
+      return *addr;
+    }
+
+    // In read-only mode, read from the snapshot
+    if (!update_mode && lockset.empty()) {
+      return readSnapshot(addr);
+    }
+
+    // Lookup in redo log to populate ret.  Note that prior casting can lead to
+    // ret having only some bytes properly set
+    T ret;
+    int found_mask = redolog.find(addr, ret);
+    // If we found all the bytes in the redo log, then it's easy
+    int desired_mask = (1UL << sizeof(T)) - 1;
+    if (desired_mask == found_mask) {
+      return ret;
+    }
+
+    // get the orec addr, then start loop to read a consistent value
+    orec_t *o = globals.orecs.get(addr);
+    T from_mem;
+    while (true) {
+      // read the orec, then location, then orec
+      local_orec_t pre, post;
+      pre.all = o->curr; // fenced read of o->curr
+      from_mem = REDOLOG::perform_transactional_read(addr);
+      post.all = o->curr; // fenced read of o->curr
+
+      // common case: new read to an unlocked, old location
+      if ((pre.all == post.all) && (pre.all <= start_time)) {
+        readset.push_back(o);
+        break;
+      }
+
+      // wait if locked
+      while (post.fields.lock) {
+        post.all = o->curr;
+      }
+
+      // validate and then update start time, because orec is unlocked but too
+      // new, then try again
+      uintptr_t newts = globals.orecs.get_time_strong_ordering();
+      epoch.setEpoch(globals.epoch, newts);
+      validate();
+      start_time = newts;
+    }
+
+    // If redolog was a partial hit, reconstruction is needed
+    if (!found_mask) {
+      return from_mem;
+    }
+    REDOLOG::reconstruct(from_mem, ret, found_mask);
+    return ret;
+  }
+
+  /// Transactional write
+  template <typename T> void write(T *addr, T val) {
+    // No instrumentation if on stack or we're irrevocable
+    if (accessDirectly(addr)) {
+      *addr = val;
+      return;
+    }
+    // Upgrading to update mode is only possible if every read so far saw the
+    // current version, since we can't validate reads of old versions
+    if (read_old) {
+      update_mode = true;
+      abortTx(ABORT_TOO_NEW);
+    }
+    redolog.insert(addr, val);
+    // get the orec addr
+    orec_t *o = globals.orecs.get(addr);
+    lockset.push_back(o);
+  }
+
+  /// Instrumentation to become irrevocable in-flight.  This is essentially an
+  /// early commit
+  void becomeIrrevocable() {
+    // Immediately return if we are already irrevocable
+    if (epoch.isIrrevoc()) {
+      return;
+    }
+
+    // A transaction that read old versions can't validate, so it must restart
+    if (read_old) {
+      update_mode = true;
+      abortTx(ABORT_TOO_NEW);
+    }
+
+    // try_irrevoc will return true only if we got the token and quiesced
+    if (!epoch.tryIrrevoc(globals.epoch)) {
+      abortTx(ABORT_IRREVOC);
+    }
+
+    // now validate.  If it fails, release irrevocability so other transactions
+    // can run.
+    for (auto o : readset) {
+      local_orec_t lo;
+      lo.all = o->curr;
+      if (lo.all > start_time) {
+        epoch.onCommitIrrevoc(globals.epoch);
+        abortTx(ABORT_VALIDATION, o);
+      }
+    }
+
+    // replay redo log
+    redolog.writeback_nonatomic();
+    stats.onIrrevoc();
+
+    // clear lists
+    allocator.onCommit();
+    readset.clear();
+    redolog.reset();
+    lockset.clear();
+  }
+
+  /// Register an action to run after transaction commit
+  void registerCommitHandler(void (*func)(void *), void *args) {
+    deferredActions.registerHandler(func, args);
+  }
+
+  /// Print the statistics of all threads
+  static void reportStats() { globals.stats.report(); }
+
+private:
+  /// Read a value from the transaction's snapshot, one word at a time
+  template <typename T> T readSnapshot(T *addr) {
+    uintptr_t a = (uintptr_t)addr;
+    uintptr_t first = a & ~(uintptr_t)7;
+    uintptr_t last = (a + sizeof(T) - 1) & ~(uintptr_t)7;
+    uint64_t words[(sizeof(T) + 14) / 8];
+    for (uintptr_t w = first, i = 0; w <= last; w += 8, ++i) {
+      words[i] = readWord(w);
+    }
+    T ret;
+    memcpy(&ret, (uint8_t *)words + (a - first), sizeof(T));
+    return ret;
+  }
+
+  /// Read the value that an aligned word had at the transaction's snapshot
+  uint64_t readWord(uintptr_t w) {
+    orec_t *o = globals.orecs.get((void *)w);
+    std::atomic<version_t *> &head = globals.history[globals.orecs.index_of(o)];
+    while (true) {
+      // read the orec, then the word and its history, then the orec
+      local_orec_t pre, post;
+      pre.all = o->curr; // fenced read of o->curr
+      uint64_t val = REDOLOG::perform_transactional_read((uint64_t *)w);
+      version_t *v = head.load();
+      post.all = o->curr; // fenced read of o->curr
+
+      // if a writer is committing, wait for it
+      if (pre.all != post.all || post.fields.lock) {
+        while (post.fields.lock) {
+          post.all = o->curr;
+        }
+        continue;
+      }
+
+      // common case: the word hasn't changed since the snapshot
+      if (pre.all <= start_time) {
+        readset.push_back(o);
+        return val;
+      }
+
+      // Otherwise roll the word back: the oldest version newer than the
+      // snapshot holds the value at the snapshot.
+      read_old = true;
+      for (; v != nullptr && v->time > start_time; v = v->next.load()) {
+        if (v->addr == w) {
+          val = v->value;
+        }
+      }
+      return val;
+    }
+  }
+
+  /// During commit, after locking, save the current value of each word that
+  /// writeback will modify, as a version with time end_time
+  void saveVersions(uint64_t end_time) {
+    uint64_t horizon = globals.horizon.val;
+    redolog.forEachWord([&](uintptr_t w) {
+      orec_t *o = globals.orecs.get((void *)w);
+      std::atomic<version_t *> &head =
+          globals.history[globals.orecs.index_of(o)];
+      trim(head, horizon);
+      version_t *v = static_cast<version_t *>(malloc(sizeof(version_t)));
+      v->time = end_time;
+      v->addr = w;
+      v->value = REDOLOG::perform_transactional_read((uint64_t *)w);
+      v->next.store(head.load(std::memory_order_relaxed),
+                    std::memory_order_relaxed);
+      head.store(v);
+    });
+  }
+
+  /// Unlink the versions of a locked orec's history that are not newer than
+  /// the horizon, and put them in the limbo list
+  void trim(std::atomic<version_t *> &head, uint64_t horizon) {
+    std::atomic<version_t *> *link = &head;
+    version_t *v = link->load(std::memory_order_relaxed);
+    while (v != nullptr && v->time > horizon) {
+      link = &v->next;
+      v = link->load(std::memory_order_relaxed);
+    }
+    if (v == nullptr) {
+      return;
+    }
+    link->store(nullptr);
+    for (; v != nullptr; v = v->next.load(std::memory_order_relaxed)) {
+      limbo.push_back(v);
+    }
+  }
+
+  /// Validation.  We need to make sure that all orecs that we've read
+  /// have timestamps older than our start time, unless we locked those orecs.
+  /// If we locked the orec, we did so when the time was smaller than our start
+  /// time, so we're sure to be OK.
+  void validate() {
+    // NB: on relaxed architectures, we may have unnecessary fences here
+
+    // NB: The common case is "no abort", so we don't put the branches inside
+    //     the loop.  If we end up aborting, the extra orec checks are kind of
+    //     like backoff.
+    bool to_abort = false;
+    for (auto o : readset) {
+      to_abort |= (o->curr > start_time);
+    }
+    if (to_abort) {
+      // Find an offending orec, so that the abort can be attributed to it
+      for (auto o : readset) {
+        if (o->curr > start_time) {
+          abortTx(ABORT_VALIDATION, o);
+        }
+      }
+      abortTx(ABORT_VALIDATION);
+    }
+  }
+
+  /// Abort the transaction.  We must handle mallocs and frees, and we need to
+  /// ensure that the OrecMVCC object is in an appropriate state for starting a
+  /// new transaction.  Note that we *will* call beginTx again, unlike libITM.
+  ///
+  /// The cause of the abort, and the orec that caused it, are reported to the
+  /// StatsManager.
+  void abortTx(abort_cause_t cause, orec_t *o = nullptr) {
+    // We can exit the Epoch right away, so that other threads don't have to
+    // wait on this thread.
+    epoch.clearEpoch(globals.epoch);
+    cm.afterAbort(globals.cm, epoch.id);
+    stats.onAbort(cause, o ? globals.orecs.index_of(o) : NO_OREC);
+
+    // release any locks held by this thread
+    for (auto o : lockset) {
+      if (o->curr == my_lock) {
+        o->curr.store(o->prev);
+      }
+    }
+
+    // reset all lists
+    readset.clear();
+    redolog.reset();
+    lockset.clear();
+    read_old = false;
+    allocator.onAbort(); // this reclaims all mallocs
+    deferredActions.onAbort();
+    frame.onAbort();
+    restore_checkpoint(checkpoint); // Takes us back to calling beginTx()
+  }
+
+  /// Check if the given address is on the thread's stack, and hence does not
+  /// need instrumentation.  Note that if the thread is irrevocable, we also say
+  /// that instrumentation is not needed.  Also, the allocator may suggest
+  /// skipping instrumentation.
+  bool accessDirectly(void *ptr) {
+    if (epoch.isIrrevoc())
+      return true;
+    if (allocator.checkCaptured(ptr))
+      return true;
+    return frame.onStack(ptr);
+  }
+
+  /// During commit, the transaction acquires all locks for its write set
+  void acquireLocks() {
+    for (auto o : lockset) {
+      local_orec_t pre;
+      pre.all = o->curr;
+
+      // If lock unheld, acquire; abort on fail to acquire
+      if (pre.all <= start_time) {
+        if (!o->curr.compare_exchange_strong(pre.all, my_lock)) {
+          abortTx(ABORT_LOCK_CAS, o);
+        }
+        o->prev = pre.all;
+      }
+      // If lock is not held by me, abort
+      else if (pre.all != my_lock) {
+        abortTx(pre.fields.lock ? ABORT_LOCKED : ABORT_TOO_NEW, o);
+      }
+    }
+  }
+
+  /// Release the locks held by this transaction
+  void releaseLocks(uint64_t end_time) {
+    // NB: there may be unnecessary fences in this loop
+    for (auto o : lockset) {
+      if (o->curr == my_lock)
+        o->curr = end_time;
+    }
+  }
+};
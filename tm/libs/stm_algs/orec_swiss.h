@@ -0,0 +1,503 @@
+#pragma once
+
+#include <atomic>
+#include <cstdlib>
+
+#include "../common/checkpoint.h"
+#include "../common/deferred.h"
+#include "../common/minivector.h"
+#include "../common/orec_t.h"
+#include "../common/pad_word.h"
+#include "../common/platform.h"
+#include "../common/stats.h"
+
+/// OrecSwiss is an STM algorithm in the style of SwissTM, with the following
+/// characteristics:
+/// - Uses orecs for commit-time "read" locking, optimistic read locking
+/// - Uses per-orec "write" locks for encounter-time write locking
+/// - Uses a global clock (counter) to avoid validation
+/// - Performs speculative writes out of place (uses redo)
+///
+/// OrecSwiss can be customized in the following ways:
+/// - Size of orec table
+/// - Redo Log (data structure and granularity of chunks)
+/// - EpochManager (quiescence and irrevocability)
+/// - Contention manager (must provide the interface of TwoPhaseCM)
+/// - Stack Frame (to bring some of the caller frame into tx scope)
+/// - Allocator (become irrevocable on too many allocations / captured memory)
+/// - Statistics (per-thread counters, or nothing)
+///
+/// OrecSwiss sits between OrecMixed and OrecLazy.  Each stripe has two locks:
+/// the orec, which readers check, and a write lock, which they ignore.  A
+/// writer acquires the write lock at encounter time, so write/write conflicts
+/// are detected eagerly, and are resolved by the contention manager (e.g., the
+/// two-phase CM of SwissTM).  The orec is only locked during commit, so
+/// readers can keep reading the old value of a location while another
+/// transaction speculatively writes it, and read/write conflicts are detected
+/// lazily, by validation.
+///
+/// NB: When the CM decides that a transaction should wait for the owner of a
+///     write lock, the transaction also aborts if a thread tries to become
+///     irrevocable, since that thread may be waiting for it to quiesce.
+template <class ORECTABLE, class REDOLOG, class EPOCH, class CM,
+          class STACKFRAME, class ALLOCATOR, class STATS>
+class OrecSwiss {
+  /// Globals is a wrapper around all of the global variables used by OrecSwiss
+  struct Globals {
+    /// The table of orecs for concurrency control
+    ORECTABLE orecs;
+
+    /// The write locks, indexed like the orecs.  Each holds 0, or 1 + the ID
+    /// of the thread that owns it.
+    std::atomic<uintptr_t> *wlocks;
+
+    /// The contention management metadata
+    typename CM::Globals cm;
+
+    /// Quiescence support
+    typename EPOCH::Globals epoch;
+
+    /// Statistics aggregation
+    typename STATS::Globals stats;
+
+    /// Construct the Globals by allocating an unheld write lock for each orec
+    Globals() {
+      wlocks = static_cast<std::atomic<uintptr_t> *>(
+          calloc(orecs.size(), sizeof(std::atomic<uintptr_t>)));
+    }
+  };
+
+  /// All metadata shared among threads
+  static Globals globals;
+
+  /// Checkpoint lets us reset registers and the instruction pointer in the
+  /// event of an abort
+  checkpoint_t *checkpoint = nullptr;
+
+  /// For managing thread IDs, Quiescence, and Irrevocability
+  EPOCH epoch;
+
+  /// Contention manager
+  CM cm;
+
+  /// For managing the stack frame
+  STACKFRAME frame;
+
+  /// The value of the global clock when this transaction started/validated
+  uint64_t start_time = 0;
+
+  /// The lock token used by this thread
+  uint64_t my_lock;
+
+  /// The value this thread stores in the write locks it owns
+  uintptr_t my_wlock;
+
+  /// all of the orecs this transaction has read
+  MiniVector<orec_t *> readset;
+
+  /// all of the orecs whose write locks this transaction holds
+  MiniVector<orec_t *> lockset;
+
+  /// a redolog, since this is a lazy TM
+  REDOLOG redolog;
+
+  /// The allocator manages malloc, free, and aligned alloc
+  ALLOCATOR allocator;
+
+  /// deferredActions manages all functions that should run after transaction
+  /// commit.
+  DeferredActionHandler deferredActions;
+
+  /// Per-thread statistics counters
+  STATS stats;
+
+public:
+  /// Return the irrevocability state of the thread
+  bool isIrrevoc() { return epoch.isIrrevoc(); }
+
+  /// Set the current bottom of the transactional part of the stack
+  void adjustStackBottom(void *addr) { frame.setBottom(addr); }
+
+  /// Prepare the descriptor to wait in the pool when its thread exits
+  void park() {
+    epoch.park();
+    frame.reset();
+  }
+
+  /// Prepare a pooled descriptor for use by a new thread
+  void unpark() { epoch.unpark(); }
+
+  /// construct a thread's transaction context by zeroing its nesting depth and
+  /// giving it an ID.  We also cache its lock tokens.
+  OrecSwiss() : epoch(globals.epoch), cm(), stats(globals.stats, epoch.id) {
+    my_lock = ORECTABLE::make_lockword(epoch.id);
+    my_wlock = epoch.id + 1;
+  }
+
+  /// Instrumentation to run at the beginning of a transaction boundary.
+  void beginTx(checkpoint_t *b) {
+    // onBegin == false -> flat nesting
+    if (frame.onBegin()) {
+      // Save the checkpoint and set the stack bottom
+      checkpoint = b;
+      frame.setBottom(b);
+
+      // Start logging allocations
+      allocator.onBegin();
+      stats.onBegin();
+
+      // Get the start time, and put it into the epoch.  epoch.onBegin will wait
+      // until there are no irrevocable transactions.
+      start_time = globals.orecs.get_time();
+      epoch.onBegin(globals.epoch, start_time);
+
+      // Notify CM of intention to start.  If return true, become irrevocable
+      if (cm.beforeBegin(globals.cm)) {
+        becomeIrrevocable();
+      }
+    }
+  }
+
+  /// Instrumentation to run at the end of a transaction boundary.
+  void commitTx() {
+    // onEnd == false -> flat nesting
+    if (frame.onEnd()) {
+      // Irrevocable commit is easy, because we reset the lists when we became
+      // irrevocable
+      if (epoch.isIrrevoc()) {
+        epoch.onCommitIrrevoc(globals.epoch);
+        cm.afterCommit(globals.cm);
+        stats.onCommitIrrevoc();
+        deferredActions.onCommit();
+        frame.onCommit();
+        return;
+      }
+      // fast-path for read-only transactions must still quiesce before freeing
+      if (lockset.empty()) {
+        epoch.clearEpoch(globals.epoch);
+        stats.onCommit(readset.size(), 0);
+        readset.clear();
+        cm.afterCommit(globals.cm);
+        epoch.quiesce(globals.epoch, start_time);
+        allocator.onCommit();
+        deferredActions.onCommit();
+        frame.onCommit();
+        return;
+      }
+      // Commit a writer transaction:
+
+      // Last chance to honor a request to abort: once the orecs are locked,
+      // the CM of another thread may be waiting for this one to finish
+      checkAbortRequest();
+
+      // lock the orecs.  Holding the write locks means no CAS is needed.
+      for (auto o : lockset) {
+        o->prev = o->curr;
+        o->curr = my_lock;
+      }
+
+      // get a commit time (includes memory fence)
+      uint64_t end_time = globals.orecs.increment_get();
+
+      // validate if there were any intervening commits
+      if (end_time != start_time + 1) {
+        for (auto i : readset) {
+          uint64_t v = i->curr;
+          if (v > start_time && v != my_lock) {
+            abortTx(ABORT_VALIDATION, i);
+          }
+        }
+      }
+
+      // replay redo log and write back
+      redolog.writeback_atomic();
+
+      // depart epoch table (fence) and then release locks
+      // NB: these stores may result in unnecessary fences
+      epoch.clearEpoch(globals.epoch);
+      releaseLocks(end_time);
+
+      // clear lists.  Quiesce before freeing
+      stats.onCommit(readset.size(), lockset.size());
+      redolog.reset();
+      lockset.clear();
+      readset.clear();
+      cm.afterCommit(globals.cm);
+      epoch.quiesce(globals.epoch, end_time);
+      allocator.onCommit();
+      deferredActions.onCommit();
+      frame.onCommit();
+    }
+  }
+
+  /// To allocate memory, we must also log it, so we can reclaim it if the
+  /// transaction aborts
+  void *txAlloc(size_t size) {
+    return allocator.alloc(size, [&]() { becomeIrrevocable(); });
+  }
+
+  /// To allocate aligned memory, we must also log it, so we can reclaim it if
+  /// the transaction aborts
+  void *txAAlloc(size_t A, size_t size) {
+    return allocator.alignAlloc(A, size, [&]() { becomeIrrevocable(); });
+  }
+
+  /// To free memory, we simply wait until the transaction has committed, and
+  /// then we free.
+  void txFree(void *addr) { allocator.reclaim(addr); }
+
+  /// Transactional read
+  template <typename T> T read(T *addr) {
+    // No instrumentation if on stack or we're irrevocable
+    if (accessDirectly(addr)) {
+      return *addr;
+    }
+    checkAbortRequest();
+
+    orec_t *o = globals.orecs.get(addr);
+    int found_mask = 0;
+    T ret;
+    if (wlockOf(o) == my_wlock) {
+      // Lookup in redo log to populate ret.  Note that prior casting can lead
+      // to ret having only some bytes properly set
+      found_mask = redolog.find(addr, ret);
+      // If we found all the bytes in the redo log, then it's easy
+      int desired_mask = (1UL << sizeof(T)) - 1;
+      if (desired_mask == found_mask) {
+        return ret;
+      }
+
+      // Fast path: nobody else can commit to this orec, and we checked that it
+      // was not newer than start_time when we got the write lock
+      if (found_mask == 0)
+        return REDOLOG::perform_transactional_read(addr);
+    }
+
+    // start loop to read a consistent value
+    T from_mem;
+    while (true) {
+      // read the orec, then location, then orec
+      local_orec_t pre, post;
+      pre.all = o->curr; // fenced read of o->curr
+      from_mem = REDOLOG::perform_transactional_read(addr);
+      post.all = o->curr; // fenced read of o->curr
+
+      // common case: new read to an unlocked, old location
+      if ((pre.all == post.all) && (pre.all <= start_time)) {
+        readset.push_back(o);
+        break;
+      }
+
+      // wait if locked, since a committing writer can't be waiting on us
+      while (post.fields.lock) {
+        post.all = o->curr;
+      }
+
+      // validate and then update start time, because orec is unlocked but too
+      // new, then try again
+      extend();
+    }
+
+    // If redolog was a partial hit, reconstruction is needed
+    if (!found_mask) {
+      return from_mem;
+    }
+    REDOLOG::reconstruct(from_mem, ret, found_mask);
+    return ret;
+  }
+
+  /// Transactional write
+  template <typename T> void write(T *addr, T val) {
+    // No instrumentation if on stack or we're irrevocable
+    if (accessDirectly(addr)) {
+      *addr = val;
+      return;
+    }
+    checkAbortRequest();
+
+    // get the orec addr, and acquire its write lock if we don't have it
+    orec_t *o = globals.orecs.get(addr);
+    std::atomic<uintptr_t> &wlock = wlockOf(o);
+    if (wlock != my_wlock) {
+      acquireWriteLock(o, wlock);
+    }
+    redolog.insert(addr, val);
+  }
+
+  /// Instrumentation to become irrevocable in-flight.  This is essentially an
+  /// early commit
+  void becomeIrrevocable() {
+    // Immediately return if we are already irrevocable
+    if (epoch.isIrrevoc()) {
+      return;
+    }
+
+    // try_irrevoc will return true only if we got the token and quiesced
+    if (!epoch.tryIrrevoc(globals.epoch)) {
+      abortTx(ABORT_IRREVOC);
+    }
+
+    // now validate.  If it fails, release irrevocability so other transactions
+    // can run.
+    for (auto o : readset) {
+      local_orec_t lo;
+      lo.all = o->curr;
+      if (lo.all > start_time) {
+        epoch.onCommitIrrevoc(globals.epoch);
+        abortTx(ABORT_VALIDATION, o);
+      }
+    }
+
+    // replay redo log
+    redolog.writeback_nonatomic();
+    stats.onIrrevoc();
+
+    // clear lists
+    allocator.onCommit();
+    readset.clear();
+    redolog.reset();
+
+    // release the write locks held by this thread
+    for (auto o : lockset) {
+      wlockOf(o).store(0, std::memory_order_release);
+    }
+    lockset.clear();
+  }
+
+  /// Register an action to run after transaction commit
+  void registerCommitHandler(void (*func)(void *), void *args) {
+    deferredActions.registerHandler(func, args);
+  }
+
+  /// Print the statistics of all threads
+  static void reportStats() { globals.stats.report(); }
+
+private:
+  /// Return the write lock that corresponds to an orec
+  std::atomic<uintptr_t> &wlockOf(orec_t *o) {
+    return globals.wlocks[globals.orecs.index_of(o)];
+  }
+
+  /// Acquire the write lock of orec o.  On a conflict, the CM decides whether
+  /// to wait for the owner or to abort.
+  void acquireWriteLock(orec_t *o, std::atomic<uintptr_t> &wlock) {
+    while (true) {
+      uintptr_t owner = wlock;
+      if (owner == 0) {
+        if (wlock.compare_exchange_strong(owner, my_wlock)) {
+          break;
+        }
+        continue;
+      }
+      if (!cm.resolve(globals.cm, epoch.id, owner - 1)) {
+        abortTx(ABORT_LOCKED, o);
+      }
+      // The owner has been asked to abort, so wait for it
+      while (wlock == owner) {
+        checkAbortRequest();
+        if (epoch.existIrrevoc(globals.epoch)) {
+          abortTx(ABORT_IRREVOC);
+        }
+        spin64();
+      }
+    }
+    lockset.push_back(o);
+    cm.onWrite(globals.cm, epoch.id);
+
+    // Reads of this orec will go straight to memory, so the orec must not have
+    // changed since start_time.  If it did, extend (it can't change again).
+    if (o->curr > start_time) {
+      extend();
+    }
+  }
+
+  /// Abort if the CM of another thread has asked this thread to abort
+  void checkAbortRequest() {
+    if (cm.abortRequested(globals.cm, epoch.id)) {
+      abortTx(ABORT_LOCKED);
+    }
+  }
+
+  /// Move the transaction's start time forward, if it is still valid
+  void extend() {
+    uintptr_t newts = globals.orecs.get_time();
+    epoch.setEpoch(globals.epoch, newts);
+    validate();
+    start_time = newts;
+  }
+
+  /// Validation.  We need to make sure that all orecs that we've read
+  /// have timestamps older than our start time.  Orecs are only locked during
+  /// commit, so outside of commit we never hold the lock on one.
+  void validate() {
+    // NB: on relaxed architectures, we may have unnecessary fences here
+
+    // NB: The common case is "no abort", so we don't put the branches inside
+    // the loop.  If we end up aborting, the extra orec checks are kind of like
+    // backoff.
+    bool to_abort = false;
+    for (auto o : readset) {
+      to_abort |= (o->curr > start_time);
+    }
+    if (to_abort) {
+      // Find an offending orec, so that the abort can be attributed to it
+      for (auto o : readset) {
+        if (o->curr > start_time) {
+          abortTx(ABORT_VALIDATION, o);
+        }
+      }
+      abortTx(ABORT_VALIDATION);
+    }
+  }
+
+  /// Abort the transaction
+  ///
+  /// The cause of the abort, and the orec that caused it, are reported to the
+  /// StatsManager.
+  void abortTx(abort_cause_t cause, orec_t *o = nullptr) {
+    // We can exit the Epoch right away, so that other threads don't have to
+    // wait on this thread.
+    epoch.clearEpoch(globals.epoch);
+    stats.onAbort(cause, o ? globals.orecs.index_of(o) : NO_OREC);
+
+    // release any orecs locked during commit, and then the write locks
+    // NB: possible extra fences
+    for (auto o : lockset) {
+      if (o->curr == my_lock) {
+        o->curr.store(o->prev);
+      }
+      wlockOf(o).store(0, std::memory_order_release);
+    }
+
+    // reset all lists
+    readset.clear();
+    redolog.reset();
+    lockset.clear();
+    cm.afterAbort(globals.cm, epoch.id);
+    allocator.onAbort(); // this reclaims all mallocs
+    deferredActions.onAbort();
+    frame.onAbort();
+    restore_checkpoint(checkpoint); // Takes us back to calling beginTx()
+  }
+
+  /// Check if the given address is on the thread's stack, and hence does not
+  /// need instrumentation.  Note that if the thread is irrevocable, we also say
+  /// that instrumentation is not needed.  Also, the allocator may suggest
+  /// skipping instrumentation.
+  bool accessDirectly(void *ptr) {
+    if (epoch.isIrrevoc())
+      return true;
+    if (allocator.checkCaptured(ptr))
+      return true;
+    return frame.onStack(ptr);
+  }
+
+  /// Release the locks held by this transaction
+  void releaseLocks(uint64_t end_time) {
+    // NB: possible extra fences
+    for (auto o : lockset) {
+      o->curr = end_time;
+      wlockOf(o).store(0, std::memory_order_release);
+    }
+  }
+};
@@ -1,8 +1,8 @@
 #pragma once
 
 #include <atomic>
-#include <setjmp.h>
 
+#include "../common/checkpoint.h"
 #include "../common/deferred.h"
 #include "../common/pad_word.h"
 #include "../common/platform.h"
@@ -21,8 +21,9 @@
 /// - Contention manager
 /// - Stack Frame (to bring some of the caller frame into tx scope)
 /// - Allocator (to become irrevocable on too many allocations)
+/// - Statistics (per-thread counters, or nothing)
 template <int RING_ELEMENTS, class BITFILTER, class REDOLOG, class EPOCH,
-          class CM, class STACKFRAME, class ALLOCATOR>
+          class CM, class STACKFRAME, class ALLOCATOR, class STATS>
 class RingSW {
   /// Globals is a wrapper around all of the global variables used by RingSW
   struct Globals {
@@ -45,6 +46,9 @@ class RingSW {
 
     /// Quiescence support
     typename EPOCH::Globals epoch;
+
+    /// Statistics aggregation
+    typename STATS::Globals stats;
   };
 
   /// All metadata shared among threads
@@ -52,7 +56,7 @@ class RingSW {
 
   /// Checkpoint lets us reset registers and the instruction pointer in the
   /// event of an abort
-  jmp_buf *checkpoint;
+  checkpoint_t *checkpoint;
 
   /// For managing thread IDs, Quiescence, and Irrevocability
   EPOCH epoch;
@@ -82,6 +86,9 @@ class RingSW {
   /// commit.
   DeferredActionHandler deferredActions;
 
+  /// Per-thread statistics counters
+  STATS stats;
+
 public:
   /// Return the irrevocability state of the thread
   bool isIrrevoc() { return epoch.isIrrevoc(); }
@@ -89,9 +96,18 @@ public:
   /// Set the current bottom of the transactional part of the stack
   void adjustStackBottom(void *addr) { frame.setBottom(addr); }
 
+  /// Prepare the descriptor to wait in the pool when its thread exits
+  void park() {
+    epoch.park();
+    frame.reset();
+  }
+
+  /// Prepare a pooled descriptor for use by a new thread
+  void unpark() { epoch.unpark(); }
+
   /// construct a thread's transaction context by zeroing its nesting depth and
   /// giving it an ID.
-  RingSW() : epoch(globals.epoch), cm() {
+  RingSW() : epoch(globals.epoch), cm(), stats(globals.stats, epoch.id) {
     // NB: this allocation strategy is necessary since (optional) SSE introduces
     // alignment requirements
     wf = (BITFILTER *)BITFILTER::filter_alloc(sizeof(BITFILTER));
@@ -101,7 +117,7 @@ public:
   }
 
   /// Instrumentation to run at the beginning of a transaction boundary.
-  void beginTx(jmp_buf *b) {
+  void beginTx(checkpoint_t *b) {
     // onBegin == false -> flat nesting
     if (frame.onBegin()) {
       // Save the checkpoint and set the stack bottom
@@ -110,6 +126,7 @@ public:
 
       // Start logging allocations
       allocator.onBegin();
+      stats.onBegin();
 
       // Start time is when the last txn completed
       start_time = globals.last_complete.val;
@@ -131,12 +148,15 @@ public:
       if (epoch.isIrrevoc()) {
         epoch.onCommitIrrevoc(globals.epoch);
         cm.afterCommit(globals.cm);
+        stats.onCommitIrrevoc();
         deferredActions.onCommit();
         frame.onCommit();
         return;
       }
       // fast-path for read-only transactions must still quiesce before freeing
       if (redolog.isEmpty()) {
+        // NB: the read set is a filter, so we cannot report its size
+        stats.onCommit(0, 0);
         rf->clear();
         epoch.clearEpoch(globals.epoch);
         cm.afterCommit(globals.cm);
@@ -194,6 +214,7 @@ public:
       globals.last_complete.val = end_time + 1;
 
       // clear lists.  Quiesce before freeing
+      stats.onCommit(0, redolog.size());
       redolog.reset();
       rf->clear();
       wf->clear();
@@ -291,6 +312,7 @@ public:
 
     // replay redo log
     redolog.writeback_nonatomic();
+    stats.onIrrevoc();
 
     // clear lists
     allocator.onCommit();
@@ -304,6 +326,9 @@ public:
     deferredActions.registerHandler(func, args);
   }
 
+  /// Print the statistics of all threads
+  static void reportStats() { globals.stats.report(); }
+
 private:
   /// Check the validity of a transaction by doing bitfilter intersections
   bool check_valid(uint64_t my_index) {
@@ -337,6 +362,7 @@ private:
     // wait on this thread.
     epoch.clearEpoch(globals.epoch);
     cm.afterAbort(globals.cm, epoch.id);
+    stats.onAbort();
 
     // reset all lists
     redolog.reset();
@@ -345,7 +371,7 @@ private:
     allocator.onAbort(); // this reclaims all mallocs
     deferredActions.onAbort();
     frame.onAbort();
-    longjmp(*checkpoint, 1); // Takes us back to calling beginTx()
+    restore_checkpoint(checkpoint); // Takes us back to calling beginTx()
   }
 
   /// Check if the given address is on the thread's stack, and hence does not
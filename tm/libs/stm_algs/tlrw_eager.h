@@ -2,9 +2,9 @@
 
 #include <atomic>
 #include <exception>
-#include <setjmp.h>
 
 #include "../common/bytelock_t.h"
+#include "../common/checkpoint.h"
 #include "../common/deferred.h"
 #include "../common/minivector.h"
 #include "../common/pad_word.h"
@@ -19,17 +19,20 @@
 /// - Inherently privatization safe and validation-free
 ///
 /// TLRWEager can be customized in the following ways:
-/// - Size of bytelock table (and bytelock size / max thread count)
+/// - Bytelock table (size, and slotted readers only or slotted and unslotted)
 /// - EpochManager (just for irrevocability... quiescence isn't needed)
 /// - Contention manager
 /// - Stack Frame (to bring some of the caller frame into tx scope)
 /// - Allocator (to become irrevocable on too many allocations)
+/// - Statistics (per-thread counters, or nothing)
 /// - Deadlock avoidance tuning (read tries, read spins, write tries, write
 ///   spins)
 ///
 /// Note that the published TLRW algorithm has bytelock support for up to some
 /// fixed number of transactions, and all other transactions use a fall-back.
-/// Our implementation simply forbids more transactions than there are slots
+/// With a BytelockTable, our implementation simply forbids more transactions
+/// than there are slots.  With an OverflowBytelockTable, the extra transactions
+/// share a reader counter in each bytelock, as in the published algorithm.
 ///
 /// Also, please be warned that TLRW is *extremely* succeptible to deadlock.
 /// The four integer tuning parameters can have a tremendous impact on overall
@@ -43,7 +46,7 @@
 /// without racing.
 template <class BYTELOCKTABLE, class EPOCH, class CM, class STACKFRAME,
           class ALLOCATOR, int READ_TRIES, int READ_SPINS, int WRITE_TRIES,
-          int WRITE_SPINS>
+          int WRITE_SPINS, class STATS>
 class TLRWEager {
   /// Globals is a wrapper around all of the global variables used by TLRWEager
   struct Globals {
@@ -55,6 +58,9 @@ class TLRWEager {
 
     /// Quiescence support
     typename EPOCH::Globals epoch;
+
+    /// Statistics aggregation
+    typename STATS::Globals stats;
   };
 
   /// All metadata shared among threads
@@ -62,7 +68,7 @@ class TLRWEager {
 
   /// Checkpoint lets us reset registers and the instruction pointer in the
   /// event of an abort
-  jmp_buf *checkpoint = nullptr;
+  checkpoint_t *checkpoint = nullptr;
 
   /// For managing thread Ids, Quiescence, and Irrevocability
   EPOCH epoch;
@@ -92,6 +98,9 @@ class TLRWEager {
   /// commit.
   DeferredActionHandler deferredActions;
 
+  /// Per-thread statistics counters
+  STATS stats;
+
 public:
   /// Return the irrevocability state of the thread
   bool isIrrevoc() { return epoch.isIrrevoc(); }
@@ -99,16 +108,25 @@ public:
   /// Set the current bottom of the transactional part of the stack
   void adjustStackBottom(void *addr) { frame.setBottom(addr); }
 
+  /// Prepare the descriptor to wait in the pool when its thread exits
+  void park() {
+    epoch.park();
+    frame.reset();
+  }
+
+  /// Prepare a pooled descriptor for use by a new thread
+  void unpark() { epoch.unpark(); }
+
   /// construct a thread's transaction context by zeroing its nesting depth and
   /// giving it an ID.  We also cache its lock token.
-  TLRWEager() : epoch(globals.epoch), cm() {
+  TLRWEager() : epoch(globals.epoch), cm(), stats(globals.stats, epoch.id) {
     my_slot = epoch.id;
     // crash immediately if we have an invalid bytelock
     globals.bytelocks.validate_id(my_slot);
   }
 
   /// Instrumentation to run at the beginning of a transaction boundary.
-  void beginTx(jmp_buf *b) {
+  void beginTx(checkpoint_t *b) {
     // onBegin == false -> flat nesting
     if (frame.onBegin()) {
       // Save the checkpoint and set the stack bottom
@@ -117,6 +135,7 @@ public:
 
       // Start logging allocations
       allocator.onBegin();
+      stats.onBegin();
 
       // Wait until there are no irrevocable transactions.
       epoch.onBegin(globals.epoch, 1);
@@ -137,6 +156,7 @@ public:
       if (epoch.isIrrevoc()) {
         epoch.onCommitIrrevoc(globals.epoch);
         cm.afterCommit(globals.cm);
+        stats.onCommitIrrevoc();
         deferredActions.onCommit();
         frame.onCommit();
         return;
@@ -152,9 +172,10 @@ public:
       }
       // Drop all read locks
       for (auto bl : readset) {
-        bl->readers[my_slot].store(0, std::memory_order_relaxed);
+        BYTELOCKTABLE::removeReader(bl, my_slot);
       }
       // clear lists
+      stats.onCommit(readset.size(), lockset.size());
       undolog.clear();
       lockset.clear();
       readset.clear();
@@ -191,29 +212,29 @@ public:
 
     // Get the bytelock addr, and check the easy cases
     auto bl = globals.bytelocks.get(addr);
-    if (bl->readers[my_slot] != 0 || bl->owner == (my_slot + 1)) {
+    if (BYTELOCKTABLE::isReader(bl, my_slot) || bl->owner == (my_slot + 1)) {
       return *addr;
     }
 
-    // We might as well log the lock now.  If we abort, releasing won't be an
-    // issue.
-    readset.push_back(bl);
-
     // Do read acquisition in a loop, because we might need to try multiple
     // times
     int tries = 0;
     while (true) {
       // In the best case, we write to the readers slot, and then see that there
       // is no owner.
-      bl->readers[my_slot] = 1; // NB: this involves a fence!
-      if (bl->owner == 0) {     // NB: this may produce an unnecessary fence
+      BYTELOCKTABLE::addReader(bl, my_slot); // NB: this involves a fence!
+      if (bl->owner == 0) { // NB: this may produce an unnecessary fence
+        // Only log the lock once we hold it: abortTx releases every lock in
+        // the readset, and an unslotted reader's release is a decrement, so
+        // releasing a lock that we don't hold would corrupt the counter.
+        readset.push_back(bl);
         return *addr;
       }
 
       // In the best case, the owner is about to finish, and isn't waiting
       // on this thread, so if we release the lock and wait a bit, things
       // clear up
-      bl->readers[my_slot] = 0;
+      BYTELOCKTABLE::removeReader(bl, my_slot);
       if (++tries == READ_TRIES) {
         abortTx();
       }
@@ -242,23 +263,28 @@ public:
 
     // For deadlock avoidance, we abort immediately if we can't get the
     // owner field
-    uintptr_t unheld = 0;
+    typename BYTELOCKTABLE::owner_t unheld = 0;
     if (!bl->owner.compare_exchange_strong(unheld, (my_slot + 1))) {
       abortTx();
     }
     lockset.push_back(bl);
 
-    // Drop our read lock, to make the checks easier
-    bl->readers[my_slot] = 0;
+    // Drop our read lock, to make the checks easier.  If we aren't slotted, we
+    // can't drop our share of the reader count without also dropping it from
+    // the read set, so instead we count it, and expect to see it.
+    uintptr_t mine = 0;
+    if (BYTELOCKTABLE::isReader(bl, my_slot)) {
+      BYTELOCKTABLE::removeReader(bl, my_slot);
+    } else {
+      for (auto r : readset) {
+        mine += (r == bl);
+      }
+    }
     // Having the lock isn't enough... We need to wait for readers to drain out
     int tries = 0;
     while (true) {
       uintptr_t count = globals.epoch.getThreads();
-      unsigned char conflicts = 0;
-      for (uintptr_t i = 0; i < count; ++i) {
-        conflicts |= bl->readers[i];
-      }
-      if (!conflicts) {
+      if (!BYTELOCKTABLE::hasReaders(bl, count, mine)) {
         break;
       }
       if (++tries == WRITE_TRIES) {
@@ -292,8 +318,10 @@ public:
       bl->owner.store(0, std::memory_order_relaxed);
     }
     for (auto bl : readset) {
-      bl->readers[my_slot].store(0, std::memory_order_relaxed);
+      BYTELOCKTABLE::removeReader(bl, my_slot);
     }
+    stats.onIrrevoc();
+
     // clear lists
     allocator.onCommit();
     readset.clear();
@@ -306,6 +334,9 @@ public:
     deferredActions.registerHandler(func, args);
   }
 
+  /// Print the statistics of all threads
+  static void reportStats() { globals.stats.report(); }
+
 private:
   /// Abort the transaction. We must handle mallocs and frees, and we need to
   /// ensure that the TLRWEager object is in an appropriate state for starting a
@@ -318,10 +349,11 @@ private:
     // wait on this thread
     epoch.clearEpoch(globals.epoch);
     cm.afterAbort(globals.cm, epoch.id);
+    stats.onAbort();
 
     // Drop all read locks
     for (auto bl : readset) {
-      bl->readers[my_slot].store(0, std::memory_order_relaxed);
+      BYTELOCKTABLE::removeReader(bl, my_slot);
     }
     // Drop all write locks
     for (auto bl : lockset) {
@@ -335,7 +367,7 @@ private:
     allocator.onAbort();
     deferredActions.onAbort();
     frame.onAbort();
-    longjmp(*checkpoint, 1);
+    restore_checkpoint(checkpoint);
   }
 
   /// Check if the given address is on the thread's stack, and hence does not
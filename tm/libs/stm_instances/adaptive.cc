@@ -0,0 +1,90 @@
+/// Instantiate the Adaptive algorithm with the following configuration:
+/// - NOrec, for low thread counts
+/// - OrecLazy, for high thread counts
+/// - CGL (std::mutex), for workloads where everything conflicts
+/// - Irrevocability for mode switches
+///
+/// NOrec and OrecLazy are configured as in norec_quiescence_safe and
+/// orec_lazy_quiescence_safe
+
+// The algorithm we are using:
+#include "../stm_algs/adaptive.h"
+#include "../stm_algs/cgl.h"
+#include "../stm_algs/norec.h"
+#include "../stm_algs/orec_lazy.h"
+
+// The templates we are using
+#include "../common/alloc.h"
+#include "../common/cm.h"
+#include "../common/epochs.h"
+#include "../common/locks.h"
+#include "../common/orec_t.h"
+#include "../common/redolog_atomic.h"
+#include "../common/stackframe.h"
+#include "../common/valuelog_atomic.h"
+
+// The API generators
+#include "../api/clone.h"
+#include "../api/execute.h"
+#include "../api/frame.h"
+#include "../api/loadstore.h"
+#include "../api/mem.h"
+#include "../api/stats.h"
+
+// Common constants when instantiating
+#include "../api/constants.h"
+
+/// The algorithm for low thread counts
+typedef NOrec<RedoLog_Atomic<32>, ValueLog_Atomic,
+              IrrevocQuiesceEpochManager<MAX_THREADS>, NoopCM,
+              OptimizedStackFrameManager,
+              BoundedAllocationManager<MALLOC_THRESHOLD, true>, DefaultStats>
+    LowThreadsAlg;
+
+/// The algorithm for high thread counts
+typedef OrecLazy<
+    DynamicOrecTable<NUM_STRIPES, OREC_COVERAGE, CounterTimesource>,
+    MiniVector<orec_t *>,
+    RedoLog_Atomic<2 << OREC_COVERAGE>,
+    IrrevocQuiesceEpochManager<MAX_THREADS>,
+    ExpBackoffCM<BACKOFF_MIN, BACKOFF_MAX>,
+    OptimizedStackFrameManager,
+    BoundedAllocationManager<MALLOC_THRESHOLD, true>, DefaultStats>
+    HighThreadsAlg;
+
+/// The algorithm for when everything conflicts
+typedef CGL<wrapped_mutex, BasicStackFrameManager, ImmediateAllocationManager>
+    SerialAlg;
+
+/// TxThread is a shorthand for the instantiated version of the TM algorithm, so
+/// that we can use common macros to define the API:
+typedef Adaptive<LowThreadsAlg, HighThreadsAlg, SerialAlg,
+                 IrrevocEpochManager<MAX_THREADS>, ADAPT_INTERVAL, ADAPT_BATCH,
+                 ADAPT_EXPLOIT>
+    TxThread;
+
+/// Define the Globals of each algorithm.  Note that defining them this way
+/// ensures they are initialized before any threads are created.
+template <class R, class V, class E, class C, class S, class A, class T>
+typename NOrec<R, V, E, C, S, A, T>::Globals
+    NOrec<R, V, E, C, S, A, T>::globals;
+template <class O, class RS, class R, class E, class C, class S, class A,
+          class T>
+typename OrecLazy<O, RS, R, E, C, S, A, T>::Globals
+    OrecLazy<O, RS, R, E, C, S, A, T>::globals;
+template <class L, class S, class A>
+typename CGL<L, S, A>::Globals CGL<L, S, A>::globals;
+template <class A0, class A1, class A2, class E, int I, int B, int X>
+typename Adaptive<A0, A1, A2, E, I, B, X>::Globals
+    Adaptive<A0, A1, A2, E, I, B, X>::globals;
+
+/// Initialize the API
+API_TM_DESCRIPTOR;
+API_TM_MALLOC_FREE;
+API_TM_MEMFUNCS_GENERIC;
+API_TM_LOADFUNCS;
+API_TM_STOREFUNCS;
+API_TM_STATS_REPORT;
+API_TM_EXECUTE_NOEXCEPT;
+API_TM_CLONES_CONCURRENT;
+API_TM_STACKFRAME_OPT;
@@ -1,10 +1,12 @@
 /// Instantiate the OrecLazy algorithm with the following configuration:
-/// - An orec table with 2^20 entries and a coverage of 16 bytes
+/// - A huge-page orec table with 2^20 entries (by default, see
+///   DynamicOrecTable) and a coverage of 16 bytes
 /// - A redo log sized according to orec granularity
 /// - Irrevocability and Quiescence
 /// - Exponential Backoff for contention management
 /// - Support for dynamic stack frame optimizations
 /// - Irrevocability after 128 mallocs, and dynamic captured memory support
+/// - Bulk instrumentation of memcpy, memset, and memmove
 
 // The algorithm we are using:
 #include "../stm_algs/orec_lazy.h"
@@ -30,27 +32,30 @@
 
 /// TxThread is a shorthand for the instantiated version of the TM algorithm, so
 /// that we can use common macros to define the API:
-typedef OrecLazy<OrecTable<NUM_STRIPES, OREC_COVERAGE, CounterTimesource>,
-                 RedoLog_Atomic<2 << OREC_COVERAGE>,
-                 IrrevocQuiesceEpochManager<MAX_THREADS>,
-                 ExpBackoffCM<BACKOFF_MIN, BACKOFF_MAX>,
-                 OptimizedStackFrameManager,
-                 BoundedAllocationManager<MALLOC_THRESHOLD, true>>
+typedef OrecLazy<
+    DynamicOrecTable<NUM_STRIPES, OREC_COVERAGE, CounterTimesource>,
+    MiniVector<orec_t *>,
+    RedoLog_Atomic<2 << OREC_COVERAGE>,
+    IrrevocQuiesceEpochManager<MAX_THREADS>,
+    ExpBackoffCM<BACKOFF_MIN, BACKOFF_MAX>,
+    OptimizedStackFrameManager,
+    BoundedAllocationManager<MALLOC_THRESHOLD, true>, DefaultStats>
     TxThread;
 
 /// Define TxThread::Globals.  Note that defining it this way ensures it is
 /// initialized before any threads are created.
-template <class O, class R, class E, class C, class S, class A>
-typename OrecLazy<O, R, E, C, S, A>::Globals
-    OrecLazy<O, R, E, C, S, A>::globals;
+template <class O, class RS, class R, class E, class C, class S, class A,
+          class T>
+typename OrecLazy<O, RS, R, E, C, S, A, T>::Globals
+    OrecLazy<O, RS, R, E, C, S, A, T>::globals;
 
 /// Initialize the API
 API_TM_DESCRIPTOR;
 API_TM_MALLOC_FREE;
-API_TM_MEMFUNCS_GENERIC;
+API_TM_MEMFUNCS_BULK;
 API_TM_LOADFUNCS;
 API_TM_STOREFUNCS;
-API_TM_STATS_NOP;
+API_TM_STATS_REPORT;
 API_TM_EXECUTE_NOEXCEPT;
-API_TM_CLONES_THREAD_UNSAFE;
+API_TM_CLONES_CONCURRENT;
 API_TM_STACKFRAME_OPT;
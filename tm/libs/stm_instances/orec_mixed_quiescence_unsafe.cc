@@ -1,5 +1,6 @@
 /// Instantiate the OrecMixed algorithm with the following configuration:
-/// - An orec table with 2^20 entries and a coverage of 16 bytes
+/// - A huge-page orec table with 2^20 entries (by default, see
+///   DynamicOrecTable) and a coverage of 16 bytes
 /// - Redo log with orec granularity
 /// - Irrevocability and Quiescence
 /// - Hourglass contention management, since we don't have irrevocability
@@ -30,18 +31,20 @@
 
 /// TxThread is a shorthand for the instantiated version of the TM algorithm, so
 /// that we can use common macros to define the API:
-typedef OrecMixed<OrecTable<NUM_STRIPES, OREC_COVERAGE, CounterTimesource>,
-                  RedoLog_Nonatomic<2 << OREC_COVERAGE>,
-                  IrrevocQuiesceEpochManager<MAX_THREADS>,
-                  HourglassCM<ABORTS_THRESHOLD>, OptimizedStackFrameManager,
-                  BoundedAllocationManager<MALLOC_THRESHOLD, true>>
+typedef OrecMixed<
+    DynamicOrecTable<NUM_STRIPES, OREC_COVERAGE, CounterTimesource>,
+    RedoLog_Nonatomic<2 << OREC_COVERAGE>,
+    IrrevocQuiesceEpochManager<MAX_THREADS>,
+    HourglassCM<ABORTS_THRESHOLD>, OptimizedStackFrameManager,
+    BoundedAllocationManager<MALLOC_THRESHOLD, true>,
+    DefaultStats>
     TxThread;
 
 /// Define TxThread::Globals.  Note that defining it this way ensures it is
 /// initialized before any threads are created.
-template <class O, class R, class E, class C, class S, class A>
-typename OrecMixed<O, R, E, C, S, A>::Globals
-    OrecMixed<O, R, E, C, S, A>::globals;
+template <class O, class R, class E, class C, class S, class A, class T>
+typename OrecMixed<O, R, E, C, S, A, T>::Globals
+    OrecMixed<O, R, E, C, S, A, T>::globals;
 
 /// Initialize the API
 API_TM_DESCRIPTOR;
@@ -49,7 +52,7 @@ API_TM_MALLOC_FREE;
 API_TM_MEMFUNCS_GENERIC;
 API_TM_LOADFUNCS;
 API_TM_STOREFUNCS;
-API_TM_STATS_NOP;
+API_TM_STATS_REPORT;
 API_TM_EXECUTE_NOEXCEPT;
-API_TM_CLONES_THREAD_UNSAFE;
+API_TM_CLONES_CONCURRENT;
 API_TM_STACKFRAME_OPT;
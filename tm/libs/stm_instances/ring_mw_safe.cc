@@ -34,14 +34,14 @@ typedef RingMW<RING_SIZE, SSEBitFilter<RING_FILTER_SIZE, RING_COVERAGE>,
                RedoLog_Atomic<2 << RING_COVERAGE>,
                IrrevocQuiesceEpochManager<MAX_THREADS>, NoopCM,
                OptimizedStackFrameManager,
-               BoundedAllocationManager<MALLOC_THRESHOLD, true>>
+               BoundedAllocationManager<MALLOC_THRESHOLD, true>, DefaultStats>
     TxThread;
 
 /// Define TxThread::Globals.  Note that defining it this way ensures it is
 /// initialized before any threads are created.
-template <int Z, class F, class R, class E, class C, class S, class A>
-typename RingMW<Z, F, R, E, C, S, A>::Globals
-    RingMW<Z, F, R, E, C, S, A>::globals;
+template <int Z, class F, class R, class E, class C, class S, class A, class T>
+typename RingMW<Z, F, R, E, C, S, A, T>::Globals
+    RingMW<Z, F, R, E, C, S, A, T>::globals;
 
 /// Initialize the API
 API_TM_DESCRIPTOR;
@@ -49,7 +49,7 @@ API_TM_MALLOC_FREE;
 API_TM_MEMFUNCS_GENERIC;
 API_TM_LOADFUNCS;
 API_TM_STOREFUNCS;
-API_TM_STATS_NOP;
+API_TM_STATS_REPORT;
 API_TM_EXECUTE_NOEXCEPT;
-API_TM_CLONES_THREAD_UNSAFE;
+API_TM_CLONES_CONCURRENT;
 API_TM_STACKFRAME_OPT;
@@ -0,0 +1,105 @@
+// Test of TLRW with unbounded readers
+//
+// A reader without a bytelock slot shares the bytelock's overflow counter.  If
+// it gives up on a read lock after READ_TRIES attempts, its abort must not
+// release the lock a second time.  Otherwise the counter drifts, and a later
+// writer sees readers that do not exist.
+
+#include "../../stm_instances/tlrw_eager_unbounded.cc"
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace {
+/// The location that the reader and the writers contend on
+uint32_t x = 0;
+
+/// The number of times the reader's transaction has started
+std::atomic<int> read_attempts(0);
+
+/// The number of times the last writer's transaction has started
+std::atomic<int> write_attempts(0);
+
+/// Set once the first writer holds the lock on x
+std::atomic<bool> locked(false);
+
+/// The number of helper threads that have a descriptor
+std::atomic<int> ready(0);
+
+/// Set when the helper threads may exit
+std::atomic<bool> done(false);
+
+/// An empty transaction, which gives the calling thread a descriptor
+void empty(void *, TM_OPAQUE *) {}
+
+/// Lock x for writing, and then keep the lock until the reader has aborted
+void hold(void *, TM_OPAQUE *desc) {
+  TM_STORE_U4_DESC(desc, 1, &x);
+  locked = true;
+  while (read_attempts < 2) {
+  }
+}
+
+/// Read x, counting how many times this transaction starts
+void read(void *out, TM_OPAQUE *desc) {
+  ++read_attempts;
+  *static_cast<uint32_t *>(out) = TM_LOAD_U4_DESC(desc, &x);
+}
+
+/// Write x, counting how many times this transaction starts
+void write(void *, TM_OPAQUE *desc) {
+  ++write_attempts;
+  TM_STORE_U4_DESC(desc, 2, &x);
+}
+} // namespace
+
+int main() {
+  // The main thread takes slot 0.  Helpers take the rest of the slots, and
+  // keep their descriptors until the end of the test, so that the reader will
+  // not get a slot.
+  TM_EXECUTE_C_INTERNAL(nullptr, nullptr, empty);
+  std::vector<std::thread> helpers;
+  for (int i = 1; i < BYTELOCK_MAX_THREADS; ++i) {
+    helpers.emplace_back([]() {
+      TM_EXECUTE_C_INTERNAL(nullptr, nullptr, empty);
+      ++ready;
+      while (!done) {
+        std::this_thread::yield();
+      }
+    });
+  }
+  while (ready < BYTELOCK_MAX_THREADS - 1) {
+    std::this_thread::yield();
+  }
+
+  // The unslotted reader gives up on x at least once, while the main thread
+  // holds it
+  uint32_t seen = 0;
+  std::thread reader([&]() {
+    while (!locked) {
+      std::this_thread::yield();
+    }
+    TM_EXECUTE_C_INTERNAL(nullptr, &seen, read);
+  });
+  TM_EXECUTE_C_INTERNAL(nullptr, nullptr, hold);
+  reader.join();
+
+  // The reader is gone, so a writer should get x on its first try
+  TM_EXECUTE_C_INTERNAL(nullptr, nullptr, write);
+  done = true;
+  for (auto &t : helpers) {
+    t.join();
+  }
+
+  bool ok = seen == 1 && x == 2 && write_attempts == 1;
+  printf("%-15s%-95s%10s\n", "[tlrw_001]",
+         "Unslotted readers that abort do not leak read locks",
+         ok ? "[OK]" : "[FAILED]");
+  if (!ok) {
+    printf("\t read {%u}, x {%u}, write attempts {%d}\n", seen, x,
+           write_attempts.load());
+  }
+  return ok ? 0 : 1;
+}
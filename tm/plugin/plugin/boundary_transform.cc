@@ -1,3 +1,4 @@
+#include "llvm/IR/Constants.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
@@ -16,11 +17,17 @@ void tm_plugin::convert_region_begin_c_api(llvm::Module &M) {
     for (BasicBlock &B : (*fn)) {
       BasicBlock::iterator I = B.begin();
       while (I != B.end()) {
-        // If we find a callsite to TM_EXECUTE_C, we can translate it
+        // If we find a callsite to TM_EXECUTE_C or TM_EXECUTE_C_RO, we can
+        // translate it to the matching internal function
         CallSite CS(cast<Value>(I));
         if (CS) {
           if (Function *Callee = CS.getCalledFunction()) {
-            if (Callee->getName() == TM_EXECUTE_C_STR) {
+            signatures::FuncNames target = signatures::FN_COUNT;
+            if (Callee->getName() == TM_EXECUTE_C_STR)
+              target = signatures::CAPI;
+            else if (Callee->getName() == TM_EXECUTE_C_RO_STR)
+              target = signatures::CAPI_RO;
+            if (target != signatures::FN_COUNT) {
               // Find the called function (arg 1) and the clone version of it.
               //
               // NB: If we get a function pointer, then we don't transform the
@@ -28,21 +35,29 @@ void tm_plugin::convert_region_begin_c_api(llvm::Module &M) {
               //     in this case.
               if (Function *Orig = dyn_cast<Function>(CS.getArgOperand(1))) {
                 if (Function *ClonedFunc = get_clone(Orig)) {
+                  // If the function never writes, the transaction can be
+                  // read-only
+                  if (is_read_only(Orig))
+                    target = signatures::CAPI_RO;
                   // Create the replacement call instruction... it can be a call
                   // or an invoke
+                  //
+                  // NB: The clone takes the descriptor as a hidden last
+                  //     parameter, which the library will provide, so we cast
+                  //     it to the type of the original
                   SmallVector<Value *, 3> Args(CS.arg_begin() + 1,
                                                CS.arg_end());
-                  Args.push_back(dyn_cast<Value>(ClonedFunc));
+                  Args.push_back(
+                      ConstantExpr::getBitCast(ClonedFunc, Orig->getType()));
                   Instruction *NewCI;
                   if (CS.isInvoke()) {
                     InvokeInst *invokeinst = dyn_cast<InvokeInst>(I);
-                    NewCI = InvokeInst::Create(sigs.get_func(signatures::CAPI),
+                    NewCI = InvokeInst::Create(sigs.get_func(target),
                                                invokeinst->getNormalDest(),
                                                invokeinst->getUnwindDest(),
                                                Args, "");
                   } else {
-                    NewCI = CallInst::Create(sigs.get_func(signatures::CAPI),
-                                             Args, "");
+                    NewCI = CallInst::Create(sigs.get_func(target), Args, "");
                   }
                   // Replace the instruction, and update the iterator
                   ReplaceInstWithInst(dyn_cast<Instruction>(&*I), NewCI);
@@ -101,9 +116,54 @@ void tm_plugin::convert_lambdas_cxx_api(Module &M) {
     Value *NEQ = builder.CreateICmpNE(opaque, opaque_null);
     builder.CreateCondBr(NEQ, iftrue, BB);
 
-    // Build the "if true" block... it just calls the clone and returns
+    // Build the "if true" block... it just calls the clone and returns.  The
+    // library passes the descriptor as the opaque pointer, so we also pass it
+    // as the clone's hidden descriptor parameter.
     builder.SetInsertPoint(iftrue);
-    builder.CreateCall(clone->second.clone, {obj, opaque});
+    SmallVector<Value *, 3> clone_args = {obj, opaque};
+    if (clone->second.takes_desc)
+      clone_args.push_back(
+          builder.CreateBitCast(opaque, sigs.get_type(signatures::OPAQUE)));
+    builder.CreateCall(clone->second.clone, clone_args);
     builder.CreateRetVoid();
   }
-}
\ No newline at end of file
+}
+
+/// Change the boundaries of lambda and RAII regions that never write, so that
+/// they begin read-only transactions.  For lambdas, the call to TM_EXECUTE_FN
+/// that passes a read-only thunk becomes a call to TM_EXECUTE_RO_FN.  For RAII,
+/// the ctor's read-only argument becomes true.
+void tm_plugin::convert_read_only_regions(Module &M) {
+  // TM_EXECUTE_FN is only in the module if the lambda API is in use
+  if (Function *ExecFn = M.getFunction(TM_EXECUTE_FN_STR)) {
+    Value *ExecRoFn =
+        M.getOrInsertFunction(TM_EXECUTE_RO_FN_STR, ExecFn->getFunctionType(),
+                              ExecFn->getAttributes())
+            .getCallee();
+    // Changing the callee changes ExecFn's users, so find the calls first
+    SmallVector<CallSite, 16> calls;
+    for (User *U : ExecFn->users()) {
+      CallSite CS(U);
+      if (CS && CS.getCalledFunction() == ExecFn) {
+        calls.push_back(CS);
+      }
+    }
+    for (CallSite CS : calls) {
+      // Operand 1 is the thunk, which is one of our lambdas
+      if (Function *Thunk =
+              dyn_cast<Function>(CS.getArgOperand(1)->stripPointerCasts())) {
+        if (is_read_only(Thunk)) {
+          CS.setCalledFunction(ExecRoFn);
+        }
+      }
+    }
+  }
+
+  // Operand 3 of the RAII ctor says if the transaction is read-only
+  for (auto &cfg : raii_regions) {
+    if (cfg.read_only) {
+      CallSite(cfg.ctor_inst)
+          .setArgument(3, ConstantInt::getTrue(M.getContext()));
+    }
+  }
+}
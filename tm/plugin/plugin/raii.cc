@@ -622,7 +622,7 @@ void tm_plugin::instrument_raii_instruction(BasicBlock::iterator inst,
   if (callsite) {
     // If transform_callsite returns an instruction, then we should
     // use that instruction instead of the one we had
-    if (Instruction *new_inst = transform_callsite(callsite, inst)) {
+    if (Instruction *new_inst = transform_callsite(callsite, inst, nullptr)) {
       ReplaceInstWithValue(bb->getInstList(), inst, new_inst);
     }
   }
@@ -639,7 +639,7 @@ void tm_plugin::instrument_raii_instruction(BasicBlock::iterator inst,
   // stores)
   else if (isa<StoreInst>(inst)) {
     StoreInst *store = dyn_cast<StoreInst>(&*inst);
-    if (CallInst *new_store = convert_store(store)) {
+    if (CallInst *new_store = convert_store(store, nullptr)) {
       ReplaceInstWithInst(store, new_store);
     } else {
       prefix_with_unsafe(inst);
@@ -655,7 +655,7 @@ void tm_plugin::instrument_raii_instruction(BasicBlock::iterator inst,
     // convert_load returns nullptr, then we need to prefix with unsafe, because
     // it's a volatile or atomic, which is not supported.
     if (instrument_reads) {
-      if (Instruction *new_load = convert_load(load)) {
+      if (Instruction *new_load = convert_load(load, nullptr)) {
         ReplaceInstWithInst(load, new_load);
       } else {
         prefix_with_unsafe(inst);
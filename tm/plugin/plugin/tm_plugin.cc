@@ -39,6 +39,10 @@ bool tm_plugin::runOnModule(Module &M) {
   // Find all functions reachable from any of the above roots
   discover_reachable_funcs();
 
+  // Find the functions and RAII regions that never write, so that their
+  // transactions can be read-only.  This must run before any instrumentation.
+  discover_read_only();
+
   // Cloning functions and instrument clone bodies
   create_clones();
   instrument_function_bodies();
@@ -47,6 +51,9 @@ bool tm_plugin::runOnModule(Module &M) {
   convert_region_begin_c_api(M);
   convert_lambdas_cxx_api(M);
 
+  // Boundary instrumentation for read-only lambda and RAII regions
+  convert_read_only_regions(M);
+
   // Boundary and scoped body instrumentation for RAII API
   instrument_raii_regions(M);
 
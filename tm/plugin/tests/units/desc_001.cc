@@ -0,0 +1,40 @@
+// Test of passing the transaction descriptor through clones
+//
+// Make sure that a chain of calls from a lambda, through a clone in the same
+// TU, to a clone in another TU (via TM_TRANSLATE), still instruments every
+// access
+
+#ifdef TEST_DRIVER
+#include "../include/harness.h"
+int desc_chain_test();
+int main() {
+  report<int>("desc_001",
+              "Descriptor passes through direct and translated calls",
+              {{desc_chain_test(), 42}},
+              {{TM_STATS_LOAD_U4, 2},
+               {TM_STATS_STORE_U4, 1},
+               {TM_STATS_UNSAFE, 0},
+               {TM_STATS_TRANSLATE_FOUND, 1}});
+}
+#endif
+
+#ifdef TEST_OFILE1
+#include "../../../common/tm_api.h"
+int a = 40;
+int result = 0;
+TX_SAFE int desc_other_tu(int i);
+__attribute__((noinline)) TX_SAFE int desc_same_tu(int i) {
+  return desc_other_tu(i + a);
+}
+int desc_chain_test() {
+  TX_BEGIN { result = desc_same_tu(0); }
+  TX_END;
+  return result;
+}
+#endif
+
+#ifdef TEST_OFILE2
+#include "../../../common/tm_api.h"
+int b = 2;
+TX_SAFE int desc_other_tu(int i) { return i + b; }
+#endif
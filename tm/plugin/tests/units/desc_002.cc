@@ -0,0 +1,48 @@
+// Test of passing the transaction descriptor through clones
+//
+// Clones of varargs functions cannot take the descriptor as a hidden
+// parameter.  Make sure that they, and the clones they call, are still
+// instrumented.
+//
+// NB: va_arg accesses the (instrumented) va_list with int and pointer loads and
+//     stores, so we only count the double accesses
+
+#ifdef TEST_DRIVER
+#include "../include/harness.h"
+double desc_varargs_test();
+int main() {
+  report<double>("desc_002", "Varargs clones get and pass on a descriptor",
+                 {{desc_varargs_test(), 17.5}},
+                 {{TM_STATS_LOAD_D, 3},
+                  {TM_STATS_STORE_D, 1},
+                  {TM_STATS_UNSAFE, 0}});
+}
+#endif
+
+#ifdef TEST_OFILE1
+#include <cstdarg>
+
+#include "../../../common/tm_api.h"
+double vals[2] = {5, 7.5};
+double total = 0;
+__attribute__((noinline)) TX_SAFE double desc_callee(double d) {
+  return d + vals[1];
+}
+__attribute__((noinline)) TX_SAFE double desc_varargs(int count, ...) {
+  va_list args;
+  va_start(args, count);
+  double sum = vals[0];
+  for (int i = 0; i < count; ++i)
+    sum += va_arg(args, int);
+  va_end(args);
+  return desc_callee(sum);
+}
+double desc_varargs_test() {
+  TX_BEGIN { total = desc_varargs(2, 2, 3) - total; }
+  TX_END;
+  return total;
+}
+#endif
+
+#ifdef TEST_OFILE2
+#endif
@@ -0,0 +1,33 @@
+// Test of C++ lambdas for transaction boundaries
+//
+// TX_BEGIN_RO should launch the transaction through the read-only entry point,
+// and still give the lambda an instrumented body
+
+#ifdef TEST_DRIVER
+#include "../include/harness.h"
+int read_only_test();
+int main() {
+  report<int>("lambda_009", "Read-only transaction via lambda is instrumented",
+              {{read_only_test(), 66}}, {{TM_STATS_BEGIN_OUTER, 1},
+              {TM_STATS_END_OUTER, 1},
+              {TM_STATS_READONLY, 1},
+              {TM_STATS_UNSAFE, 0},
+              {TM_STATS_LOAD_U4, 1},
+              {TM_STATS_STORE_U4, 0}});
+}
+#endif
+
+#ifdef TEST_OFILE1
+#include "../../../common/tm_api.h"
+int x;
+int read_only_test() {
+  x = 66;
+  int tmp = 0;
+  TX_BEGIN_RO { tmp = x; }
+  TX_END;
+  return tmp;
+}
+#endif
+
+#ifdef TEST_OFILE2
+#endif
@@ -0,0 +1,41 @@
+// Test of C++ lambdas for transaction boundaries
+//
+// A transaction that launches a nested transaction which writes is not
+// read-only, even though the nested TX_BEGIN is a call to a pure function.
+
+#ifdef TEST_DRIVER
+#include "../include/harness.h"
+int nested_writer_test();
+int main() {
+  report<int>("lambda_011", "Lambdas with nested writers are not read-only",
+              {{nested_writer_test(), 9}}, {{TM_STATS_BEGIN_OUTER, 1},
+              {TM_STATS_END_OUTER, 1},
+              {TM_STATS_BEGIN_INNER, 1},
+              {TM_STATS_END_INNER, 1},
+              {TM_STATS_READONLY, 0},
+              {TM_STATS_UNSAFE, 0},
+              {TM_STATS_LOAD_U4, 2},
+              {TM_STATS_STORE_U4, 1}});
+}
+#endif
+
+#ifdef TEST_OFILE1
+#include "../../../common/tm_api.h"
+int x;
+int seen;
+// Pure, so its store is not instrumented, and does not make the caller write
+TX_PURE __attribute__((noinline)) void see(int v) { seen = v; }
+int nested_writer_test() {
+  x = 4;
+  TX_BEGIN {
+    see(x);
+    TX_BEGIN { x = x + 1; }
+    TX_END;
+  }
+  TX_END;
+  return seen + x;
+}
+#endif
+
+#ifdef TEST_OFILE2
+#endif
@@ -0,0 +1,37 @@
+// Test of C++ lambdas for transaction boundaries
+//
+// A volatile load makes the transaction irrevocable, so a lambda that does one
+// is not read-only, even though it never writes.
+
+#ifdef TEST_DRIVER
+#include "../include/harness.h"
+int volatile_load_test();
+int main() {
+  report<int>("lambda_013", "Lambdas with volatile loads are not read-only",
+              {{volatile_load_test(), 19}}, {{TM_STATS_BEGIN_OUTER, 1},
+              {TM_STATS_END_OUTER, 1},
+              {TM_STATS_READONLY, 0},
+              {TM_STATS_UNSAFE, 1},
+              {TM_STATS_LOAD_U4, 1},
+              {TM_STATS_STORE_U4, 0}});
+}
+#endif
+
+#ifdef TEST_OFILE1
+#include "../../../common/tm_api.h"
+int x;
+volatile int v;
+int seen;
+// Pure, so its store is not instrumented, and does not make the caller write
+TX_PURE __attribute__((noinline)) void see(int val) { seen = val; }
+int volatile_load_test() {
+  x = 12;
+  v = 7;
+  TX_BEGIN { see(x + v); }
+  TX_END;
+  return seen;
+}
+#endif
+
+#ifdef TEST_OFILE2
+#endif